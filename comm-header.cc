@@ -60,7 +60,12 @@ CommHeader::GetInstanceTypeId (void) const
 
 CommHeader::CommHeader() : m_sentTime (0),
                            m_packetType (0),
-                           m_packetAnalyzed (0)
+                           m_packetAnalyzed (0),
+                           m_trafficClass (0),
+                           m_seq (0),
+                           m_key (0),
+                           m_fragmentIndex (0),
+                           m_fragmentCount (1)
 {
   //cstrctr
 }
@@ -73,24 +78,39 @@ CommHeader::~CommHeader()
 void  
 CommHeader::Print (std::ostream &os) const
 {
-  os << " Packet Genarated Time: " << m_sentTime << std::endl;
+  os << " Packet Genarated Time: " << m_sentTime 
+     << " Traffic Class: " << (uint32_t) m_trafficClass
+     << " Sequence Number: " << m_seq
+     << " Key: " << m_key
+     << " Fragment: " << m_fragmentIndex << "/" << m_fragmentCount << std::endl;
 } 
 
 uint32_t  
 CommHeader::GetSerializedSize (void) const 
 {
 	return (sizeof(uint8_t) + 
-	        sizeof(uint32_t) + 
-	        sizeof(uint8_t));
-}//6;
+	        sizeof(uint64_t) + 
+	        sizeof(uint8_t) +
+	        sizeof(uint8_t) +
+	        sizeof(uint32_t) +
+	        sizeof(uint32_t) +
+	        sizeof(uint16_t) +
+	        sizeof(uint16_t));
+}//23;
 
 void
 CommHeader::Serialize (Buffer::Iterator start) const
 {
 	Buffer::Iterator i = start;
-	i.WriteU32 ((uint32_t)(m_sentTime.GetSeconds() * 1000 + 0.5));
+	// full time step (ns) precision: ms rounding hides sub-ms RTTs
+	i.WriteU64 ((uint64_t) m_sentTime.GetTimeStep ());
 	i.WriteU8 (m_packetType);
 	i.WriteU8(m_packetAnalyzed);
+	i.WriteU8(m_trafficClass);
+	i.WriteU32(m_seq);
+	i.WriteU32(m_key);
+	i.WriteU16(m_fragmentIndex);
+	i.WriteU16(m_fragmentCount);
 }
 
 uint32_t
@@ -98,9 +118,14 @@ CommHeader::Deserialize (Buffer::Iterator start)
 {
 	Buffer::Iterator i = start;
 	
-	m_sentTime = Seconds( ((double) i.ReadU32 ()) / 1000.0 );
+	m_sentTime = Time ((int64_t) i.ReadU64 ());
 	m_packetType = i.ReadU8();
 	m_packetAnalyzed = i.ReadU8();
+	m_trafficClass = i.ReadU8();
+	m_seq = i.ReadU32();
+	m_key = i.ReadU32();
+	m_fragmentIndex = i.ReadU16();
+	m_fragmentCount = i.ReadU16();
 	
 	return GetSerializedSize();
 }
@@ -64,7 +64,7 @@ enum PacketStaus {
    * \param time the time
    * \return the time the packet is generated
    */
-	Time GetSentTime(void)
+	Time GetSentTime(void) const
 	{
 		return m_sentTime;
 	}
@@ -101,6 +101,76 @@ enum PacketStaus {
 		return PacketStaus (m_packetAnalyzed);
 	}	
 
+  /**
+   * \brief Get and Set the traffic class (priority) of the request
+   * \param trafficClass the class, 0 being the highest priority
+   * \return the traffic class of the packet
+   */
+	void SetTrafficClass(uint8_t trafficClass)
+	{
+		m_trafficClass = trafficClass;
+	}
+	uint8_t GetTrafficClass(void) const
+	{
+		return m_trafficClass;
+	}
+
+  /**
+   * \brief Get and Set the sequence number the client gave to the request
+   * \param seq the sequence number
+   * \return the sequence number of the packet
+   */
+	void SetSequenceNumber(uint32_t seq)
+	{
+		m_seq = seq;
+	}
+	uint32_t GetSequenceNumber(void) const
+	{
+		return m_seq;
+	}
+
+  /**
+   * \brief Get and Set the key of the requested object, used by the server cache
+   * \param key the key, 0 being no key (never cached)
+   * \return the key of the packet
+   */
+	void SetKey(uint32_t key)
+	{
+		m_key = key;
+	}
+	uint32_t GetKey(void) const
+	{
+		return m_key;
+	}
+
+  /**
+   * \brief Get and Set the index of the reply fragment, 0 being the first
+   * \param index the fragment index
+   * \return the fragment index of the packet
+   */
+	void SetFragmentIndex(uint16_t index)
+	{
+		m_fragmentIndex = index;
+	}
+	uint16_t GetFragmentIndex(void) const
+	{
+		return m_fragmentIndex;
+	}
+
+  /**
+   * \brief Get and Set the number of fragments of the reply
+   * \param count the number of fragments, 1 for a reply in a single packet
+   * \return the number of fragments of the reply
+   */
+	void SetFragmentCount(uint16_t count)
+	{
+		m_fragmentCount = count;
+	}
+	uint16_t GetFragmentCount(void) const
+	{
+		return m_fragmentCount;
+	}
+
   static TypeId GetTypeId (void);
   virtual TypeId GetInstanceTypeId (void) const;
   virtual void Print (std::ostream &os) const;
@@ -113,6 +183,11 @@ enum PacketStaus {
 	Time m_sentTime;
 	uint8_t m_packetType;
 	uint8_t m_packetAnalyzed;
+	uint8_t m_trafficClass;
+	uint32_t m_seq;
+	uint32_t m_key;
+	uint16_t m_fragmentIndex;
+	uint16_t m_fragmentCount;
 	
 };// end of the Comm header
 /**
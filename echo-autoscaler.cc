@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+
+#include "echo-autoscaler.h"
+
+namespace ns3 {
+
+EchoAutoscaler::Parameters::Parameters ()
+  : mode (OFF),
+    scaleUpThreshold (0.8),
+    scaleDownThreshold (0.3),
+    smoothing (0.5),
+    minChannels (1),
+    maxChannels (1),
+    frequencyStep (0.25),
+    minFrequency (0.5),
+    maxFrequency (2.0)
+{
+}
+
+EchoAutoscaler::EchoAutoscaler ()
+{
+  Configure (Parameters (), 1, Time ());
+}
+
+void
+EchoAutoscaler::Configure (const Parameters &parameters, uint32_t channels, Time now)
+{
+  m_parameters = parameters;
+  m_channels = channels;
+  m_frequency = 1.0;
+  m_smoothedLoad = 0.0;
+  m_lastScaleTime = now;
+  m_provisioning = false;
+  m_scaleUps = 0;
+  m_scaleDowns = 0;
+}
+
+EchoAutoscaler::Action
+EchoAutoscaler::Evaluate (double load, Time now)
+{
+  const Parameters &p = m_parameters;
+  m_smoothedLoad = p.smoothing * load + (1.0 - p.smoothing) * m_smoothedLoad;
+
+  Time sinceScale = now - m_lastScaleTime;
+  bool channels = (p.mode == CHANNELS);
+  if (m_smoothedLoad > p.scaleUpThreshold && !m_provisioning && sinceScale >= p.scaleUpCooldown &&
+      (channels ? m_channels < p.maxChannels : m_frequency < p.maxFrequency))
+    {
+      // the capacity arrives after the provisioning delay; the cooldown
+      // runs from the decision
+      m_provisioning = true;
+      m_lastScaleTime = now;
+      return PROVISION;
+    }
+  if (m_smoothedLoad < p.scaleDownThreshold && !m_provisioning && sinceScale >= p.scaleDownCooldown &&
+      (channels ? m_channels > p.minChannels : m_frequency > p.minFrequency))
+    {
+      m_lastScaleTime = now;
+      m_scaleDowns++;
+      if (channels)
+        {
+          m_channels--;
+        }
+      else
+        {
+          m_frequency = std::max (m_frequency - p.frequencyStep, p.minFrequency);
+        }
+      return SCALE_DOWN;
+    }
+  return NONE;
+}
+
+void
+EchoAutoscaler::ScaleUp (void)
+{
+  m_provisioning = false;
+  m_scaleUps++;
+  if (m_parameters.mode == CHANNELS)
+    {
+      m_channels++;
+    }
+  else
+    {
+      m_frequency = std::min (m_frequency + m_parameters.frequencyStep, m_parameters.maxFrequency);
+    }
+}
+
+} // namespace ns3
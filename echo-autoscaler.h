@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_AUTOSCALER_H
+#define ECHO_AUTOSCALER_H
+
+#include <stdint.h>
+
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief the scaling decisions of a server.
+ *
+ * The owner measures the load of every evaluation interval (the busy
+ * fraction of the active channels, or the waiting requests per active
+ * channel) and passes it to Evaluate, which smooths it exponentially.
+ * Above the scale up threshold a scale up is provisioned: the owner calls
+ * ScaleUp once the provisioning delay elapsed, and no other action is
+ * taken meanwhile. Below the scale down threshold the capacity drops at
+ * once. The cooldowns run from the last decision. The autoscaler keeps
+ * the number of active channels and the frequency (service rate
+ * multiplier) and does not schedule anything itself.
+ */
+class EchoAutoscaler
+{
+public:
+  /**
+   * \brief What the autoscaler changes
+   */
+  enum Mode
+  {
+    OFF, //!< fixed capacity
+    CHANNELS, //!< add and remove channels
+    FREQUENCY, //!< step the service rate of every channel (DVFS)
+  };
+
+  /**
+   * \brief The load measure the autoscaler follows
+   */
+  enum Metric
+  {
+    UTILIZATION, //!< fraction of the active channels which are busy
+    QUEUE_LENGTH, //!< waiting requests per active channel
+  };
+
+  /**
+   * \brief The outcome of an evaluation
+   */
+  enum Action
+  {
+    NONE, //!< the capacity stays
+    PROVISION, //!< a scale up started, call ScaleUp after the provisioning delay
+    SCALE_DOWN, //!< the capacity was decreased
+  };
+
+  /**
+   * \brief the configuration of the autoscaler
+   */
+  struct Parameters
+  {
+    Parameters ();
+    Mode mode; //!< what the autoscaler changes
+    double scaleUpThreshold; //!< smoothed load above which the capacity is increased
+    double scaleDownThreshold; //!< smoothed load below which the capacity is decreased
+    double smoothing; //!< weight of the last interval in the smoothed load
+    Time scaleUpCooldown; //!< minimum time from a scaling action to a scale up
+    Time scaleDownCooldown; //!< minimum time from a scaling action to a scale down
+    uint32_t minChannels; //!< fewest active channels
+    uint32_t maxChannels; //!< most active channels
+    double frequencyStep; //!< frequency change of a scaling action
+    double minFrequency; //!< lowest frequency
+    double maxFrequency; //!< highest frequency
+  };
+
+  EchoAutoscaler ();
+
+  /**
+   * \brief reset the state and the counters
+   * \param parameters the configuration
+   * \param channels the active channels to start with
+   * \param now the current time, the cooldowns start from it
+   */
+  void Configure (const Parameters &parameters, uint32_t channels, Time now);
+
+  /**
+   * \brief smooth the load of the last interval and scale if it crossed
+   * a threshold
+   * \param load the load of the interval
+   * \param now the current time
+   * \return the action taken
+   */
+  Action Evaluate (double load, Time now);
+
+  /**
+   * \brief add the capacity of the provisioned scale up
+   */
+  void ScaleUp (void);
+
+  /**
+   * \return true if the autoscaler changes the capacity at all
+   */
+  bool IsEnabled (void) const
+  {
+    return m_parameters.mode != OFF;
+  }
+
+  /**
+   * \return the number of active channels
+   */
+  uint32_t GetChannels (void) const
+  {
+    return m_channels;
+  }
+
+  /**
+   * \return the service rate multiplier of the channels
+   */
+  double GetFrequency (void) const
+  {
+    return m_frequency;
+  }
+
+  /**
+   * \return the exponentially smoothed load
+   */
+  double GetSmoothedLoad (void) const
+  {
+    return m_smoothedLoad;
+  }
+
+  /**
+   * \return the number of scale ups
+   */
+  uint32_t GetScaleUps (void) const
+  {
+    return m_scaleUps;
+  }
+
+  /**
+   * \return the number of scale downs
+   */
+  uint32_t GetScaleDowns (void) const
+  {
+    return m_scaleDowns;
+  }
+
+private:
+  Parameters m_parameters; //!< the configuration
+  uint32_t m_channels; //!< number of active channels
+  double m_frequency; //!< service rate multiplier of the channels
+  double m_smoothedLoad; //!< exponentially smoothed load of the intervals
+  Time m_lastScaleTime; //!< time of the last scaling decision
+  bool m_provisioning; //!< a scale up is being provisioned
+  uint32_t m_scaleUps; //!< number of scale ups
+  uint32_t m_scaleDowns; //!< number of scale downs
+};
+
+} // namespace ns3
+
+#endif /* ECHO_AUTOSCALER_H */
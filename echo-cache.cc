@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "echo-cache.h"
+
+namespace ns3 {
+
+EchoCache::EchoCache (uint32_t capacity, Policy policy)
+{
+  Configure (capacity, policy);
+}
+
+void
+EchoCache::Configure (uint32_t capacity, Policy policy)
+{
+  m_capacity = capacity;
+  m_policy = policy;
+  Clear ();
+}
+
+void
+EchoCache::Clear (void)
+{
+  m_entries.clear ();
+  m_order.clear ();
+  m_clock = 0;
+  m_hits = 0;
+  m_misses = 0;
+  m_evictions = 0;
+}
+
+bool
+EchoCache::Lookup (uint32_t key)
+{
+  std::map<uint32_t, Order>::iterator it = m_entries.find (key);
+  if (it == m_entries.end ())
+    {
+      m_misses++;
+      return false;
+    }
+  m_hits++;
+  m_order.erase (it->second);
+  it->second = Order (it->second.first + (m_policy == LFU ? 1 : 0), ++m_clock);
+  m_order[it->second] = key;
+  return true;
+}
+
+void
+EchoCache::Insert (uint32_t key)
+{
+  if (m_capacity == 0 || m_entries.find (key) != m_entries.end ())
+    {
+      return;
+    }
+  if (m_entries.size () >= m_capacity)
+    {
+      std::map<Order, uint32_t>::iterator victim = m_order.begin ();
+      m_entries.erase (victim->second);
+      m_order.erase (victim);
+      m_evictions++;
+    }
+  Order order (m_policy == LFU ? 1 : 0, ++m_clock);
+  m_entries[key] = order;
+  m_order[order] = key;
+}
+
+} // namespace ns3
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_CACHE_H
+#define ECHO_CACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief a bounded set of keys with LRU or LFU eviction.
+ *
+ * Every cached key holds a rank (use count under LFU, zero under LRU) and
+ * the stamp of its last use; the keys are ordered on (rank, stamp), so the
+ * first one is the victim: the least recently used under LRU and the
+ * least frequently used, ties going to the least recent, under LFU. A
+ * lookup and an insertion cost O (log n).
+ */
+class EchoCache
+{
+public:
+  /**
+   * \brief the eviction policy
+   */
+  enum Policy
+  {
+    LRU, //!< evict the least recently used key
+    LFU, //!< evict the least frequently used key
+  };
+
+  /**
+   * \param capacity the number of keys held, 0 disables the cache
+   * \param policy the eviction policy
+   */
+  EchoCache (uint32_t capacity = 0, Policy policy = LRU);
+
+  /**
+   * \brief empty the cache and change its size and policy
+   * \param capacity the number of keys held, 0 disables the cache
+   * \param policy the eviction policy
+   */
+  void Configure (uint32_t capacity, Policy policy);
+
+  /**
+   * \brief look a key up, counting a hit or a miss; a hit is a use
+   * \param key the key
+   * \return true on a hit
+   */
+  bool Lookup (uint32_t key);
+
+  /**
+   * \brief cache a key, evicting the victim if the cache is full; a key
+   * already cached is left as it is
+   * \param key the key
+   */
+  void Insert (uint32_t key);
+
+  /**
+   * \brief remove all the keys and reset the counters
+   */
+  void Clear (void);
+
+  /**
+   * \return true if the cache holds keys at all
+   */
+  bool IsEnabled (void) const
+  {
+    return m_capacity != 0;
+  }
+
+  /**
+   * \return the number of cached keys
+   */
+  uint32_t GetSize (void) const
+  {
+    return m_entries.size ();
+  }
+
+  /**
+   * \return the number of keys held
+   */
+  uint32_t GetCapacity (void) const
+  {
+    return m_capacity;
+  }
+
+  /**
+   * \return the number of lookups that hit
+   */
+  uint64_t GetHits (void) const
+  {
+    return m_hits;
+  }
+
+  /**
+   * \return the number of lookups that missed
+   */
+  uint64_t GetMisses (void) const
+  {
+    return m_misses;
+  }
+
+  /**
+   * \return the number of evicted keys
+   */
+  uint64_t GetEvictions (void) const
+  {
+    return m_evictions;
+  }
+
+  /**
+   * \return the hits over the lookups, or zero before any lookup
+   */
+  double GetHitRatio (void) const
+  {
+    return (m_hits + m_misses) ? (double) m_hits / (m_hits + m_misses) : 0.0;
+  }
+
+private:
+  typedef std::pair<uint64_t, uint64_t> Order; //!< (rank, stamp) of a key
+
+  uint32_t m_capacity; //!< number of keys held
+  Policy m_policy; //!< eviction policy
+  std::map<uint32_t, Order> m_entries; //!< order of every cached key
+  std::map<Order, uint32_t> m_order; //!< cached keys, the victim first
+  uint64_t m_clock; //!< stamp of the last use
+  uint64_t m_hits; //!< lookups that hit
+  uint64_t m_misses; //!< lookups that missed
+  uint64_t m_evictions; //!< evicted keys
+};
+
+} // namespace ns3
+
+#endif /* ECHO_CACHE_H */
@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "echo-fanout.h"
+
+namespace ns3 {
+
+EchoFanOut::EchoFanOut ()
+{
+  Configure (0, 0, 0, 0);
+}
+
+void
+EchoFanOut::Configure (uint32_t backends, uint32_t fanOut, uint32_t quorum, uint32_t maxPending)
+{
+  m_backends = backends;
+  m_fanOut = (fanOut == 0) ? backends : std::min (fanOut, backends);
+  m_quorum = (quorum == 0) ? m_fanOut : std::min (quorum, m_fanOut);
+  // the table is allocated once; the free list is used as a stack
+  m_slots.assign (maxPending, Slot ());
+  m_freeSlots.clear ();
+  for (uint32_t i = maxPending; i > 0; i--)
+    {
+      m_freeSlots.push_back (i - 1);
+    }
+  m_nextBackend = 0;
+  m_completed = 0;
+  m_timeouts = 0;
+  m_dropped = 0;
+  m_lateSubReplies = 0;
+  m_subRequestRtt.Clear ();
+  m_latency.Clear ();
+}
+
+bool
+EchoFanOut::Start (const ServerQueueEntry &request, Time now, uint32_t &slot, uint32_t &tag, uint32_t &firstBackend)
+{
+  if (m_freeSlots.empty () || m_backends == 0)
+    {
+      m_dropped++;
+      return false;
+    }
+  slot = m_freeSlots.back ();
+  m_freeSlots.pop_back ();
+
+  Slot &s = m_slots[slot];
+  s.request = request;
+  s.tag = (((s.tag >> 16) + 1) << 16) | slot;
+  s.received = 0;
+  s.start = now;
+  s.busy = true;
+  tag = s.tag;
+
+  firstBackend = m_nextBackend;
+  m_nextBackend = (m_nextBackend + m_fanOut) % m_backends;
+  return true;
+}
+
+bool
+EchoFanOut::Receive (uint32_t tag, Time rtt, uint32_t &slot)
+{
+  m_subRequestRtt.Add (rtt.GetSeconds ());
+
+  slot = tag & 0xffff;
+  if (slot >= m_slots.size () || !m_slots[slot].busy || m_slots[slot].tag != tag)
+    {
+      // the request was completed by the quorum or the timeout
+      m_lateSubReplies++;
+      return false;
+    }
+  return ++m_slots[slot].received == m_quorum;
+}
+
+ServerQueueEntry
+EchoFanOut::Complete (uint32_t slot, Time now, bool timedOut)
+{
+  Slot &s = m_slots[slot];
+  m_latency.Add ((now - s.start).GetSeconds ());
+  if (timedOut)
+    {
+      m_timeouts++;
+    }
+  else
+    {
+      m_completed++;
+    }
+
+  ServerQueueEntry request = s.request;
+  s.request = ServerQueueEntry ();
+  s.busy = false;
+  m_freeSlots.push_back (slot);
+  return request;
+}
+
+double
+EchoFanOut::QuorumQuantile (double q, uint32_t quorum, uint32_t fanOut)
+{
+  // the probability is increasing in p, so bisect
+  double low = 0.0;
+  double high = 1.0;
+  for (uint32_t i = 0; i < 60; i++)
+    {
+      double p = (low + high) / 2.0;
+      double probability = 0.0;
+      for (uint32_t j = quorum; j <= fanOut; j++)
+        {
+          probability += std::exp (lgamma (fanOut + 1.0) - lgamma (j + 1.0) - lgamma (fanOut - j + 1.0) +
+                                   j * std::log (p) + (fanOut - j) * std::log1p (-p));
+        }
+      if (probability < q)
+        {
+          low = p;
+        }
+      else
+        {
+          high = p;
+        }
+    }
+  return (low + high) / 2.0;
+}
+
+} // namespace ns3
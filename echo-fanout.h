@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_FANOUT_H
+#define ECHO_FANOUT_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "ns3/nstime.h"
+
+#include "server-packet-queue.h"
+#include "echo-sketch.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief the pending table of an aggregator.
+ *
+ * A request fanned out to the backends takes a slot of a preallocated
+ * table until "quorum" of its sub-requests answered or the owner times it
+ * out. The sub-requests carry the tag of the slot, generation << 16 |
+ * slot index, so a sub-reply to a completed request is recognized as late
+ * even when its slot was reused. With fewer sub-requests than backends
+ * the backends take turns. The owner sends the sub-requests and keeps
+ * the timeouts; the table keeps the counters and the latencies.
+ */
+class EchoFanOut
+{
+public:
+  EchoFanOut ();
+
+  /**
+   * \brief empty the table, reset the counters and change its size
+   * \param backends the number of backends
+   * \param fanOut sub-requests per request, 0 means all the backends
+   * \param quorum sub-replies completing a request, 0 means all
+   * \param maxPending the number of slots
+   */
+  void Configure (uint32_t backends, uint32_t fanOut, uint32_t quorum, uint32_t maxPending);
+
+  /**
+   * \brief take a slot for a request, or count it as dropped if the
+   * table is full
+   * \param request the client request
+   * \param now the time the sub-requests are sent
+   * \param slot the index of the slot taken
+   * \param tag the sequence number of the sub-requests
+   * \param firstBackend the backend of the first sub-request; sub-request
+   * i goes to backend (firstBackend + i) modulo the backends
+   * \return false if the request was dropped
+   */
+  bool Start (const ServerQueueEntry &request, Time now, uint32_t &slot, uint32_t &tag, uint32_t &firstBackend);
+
+  /**
+   * \brief account a sub-reply
+   * \param tag the sequence number of the sub-reply
+   * \param rtt the round trip time of the sub-request
+   * \param slot the index of the slot of its request
+   * \return true if the sub-reply completed the quorum of a pending
+   * request; Complete it then
+   */
+  bool Receive (uint32_t tag, Time rtt, uint32_t &slot);
+
+  /**
+   * \brief free the slot of a request
+   * \param slot the index of the slot
+   * \param now the current time
+   * \param timedOut the quorum was not reached in time
+   * \return the client request
+   */
+  ServerQueueEntry Complete (uint32_t slot, Time now, bool timedOut);
+
+  /**
+   * \return the number of slots
+   */
+  uint32_t GetMaxPending (void) const
+  {
+    return m_slots.size ();
+  }
+
+  /**
+   * \return the sub-requests of a request
+   */
+  uint32_t GetFanOut (void) const
+  {
+    return m_fanOut;
+  }
+
+  /**
+   * \return the sub-replies completing a request
+   */
+  uint32_t GetQuorum (void) const
+  {
+    return m_quorum;
+  }
+
+  /**
+   * \return the number of requests completed with the quorum
+   */
+  uint32_t GetCompleted (void) const
+  {
+    return m_completed;
+  }
+
+  /**
+   * \return the number of requests completed at the timeout
+   */
+  uint32_t GetTimeouts (void) const
+  {
+    return m_timeouts;
+  }
+
+  /**
+   * \return the number of requests dropped as the table was full
+   */
+  uint32_t GetDropped (void) const
+  {
+    return m_dropped;
+  }
+
+  /**
+   * \return the number of sub-replies received after their request completed
+   */
+  uint32_t GetLateSubReplies (void) const
+  {
+    return m_lateSubReplies;
+  }
+
+  /**
+   * \return the RTTs of the sub-requests (s)
+   */
+  const EchoSketch &GetSubRequestRtt (void) const
+  {
+    return m_subRequestRtt;
+  }
+
+  /**
+   * \return the fan-out to completion times (s)
+   */
+  const EchoSketch &GetLatency (void) const
+  {
+    return m_latency;
+  }
+
+  /**
+   * \brief the sub-request quantile giving a fan-out quantile with
+   * independent backends: the quorum-th fastest of fanOut independent
+   * sub-requests is below the p quantile of one with probability
+   * sum_{j >= quorum} C (fanOut, j) p^j (1 - p)^(fanOut - j)
+   * \param q the fan-out quantile (0 to 1)
+   * \param quorum the sub-replies completing a request
+   * \param fanOut the sub-requests of a request
+   * \return the p for which that probability is q
+   */
+  static double QuorumQuantile (double q, uint32_t quorum, uint32_t fanOut);
+
+private:
+  /**
+   * \brief a slot of the pending table
+   */
+  struct Slot
+  {
+    Slot () : tag (0), received (0), busy (false) {}
+    ServerQueueEntry request; //!< the client request
+    uint32_t tag; //!< sequence number of the sub-requests: generation << 16 | slot index
+    uint32_t received; //!< sub-replies received
+    Time start; //!< time the sub-requests were sent
+    bool busy; //!< the slot holds a request
+  };
+
+  uint32_t m_backends; //!< number of backends
+  uint32_t m_fanOut; //!< sub-requests per request
+  uint32_t m_quorum; //!< sub-replies completing a request
+  std::vector<Slot> m_slots; //!< the pending table
+  std::vector<uint32_t> m_freeSlots; //!< indices of the free slots
+  uint32_t m_nextBackend; //!< backend the next fan-out starts from
+  uint32_t m_completed; //!< requests completed with the quorum
+  uint32_t m_timeouts; //!< requests completed at the timeout
+  uint32_t m_dropped; //!< requests dropped as the table was full
+  uint32_t m_lateSubReplies; //!< sub-replies received after their request completed
+  EchoSketch m_subRequestRtt; //!< RTTs of the sub-requests (s)
+  EchoSketch m_latency; //!< fan-out to completion times (s)
+};
+
+} // namespace ns3
+
+#endif /* ECHO_FANOUT_H */
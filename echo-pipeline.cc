@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+#include "echo-pipeline.h"
+
+namespace ns3 {
+
+EchoPipeline::EchoPipeline ()
+{
+}
+
+void
+EchoPipeline::Configure (const std::string &work, const std::string &workers, const std::string &buffers,
+                         const std::string &distributions, bool deterministic)
+{
+  Stop ();
+  m_stages.clear ();
+  m_startTime = Simulator::Now ();
+  std::istringstream workList (work);
+  std::string token;
+  while (std::getline (workList, token, ':'))
+    {
+      Stage stage;
+      stage.work = std::atof (token.c_str ());
+      NS_ABORT_MSG_IF (stage.work <= 0.0, "EchoPipeline: stage work shares must be positive");
+      stage.deterministic = deterministic;
+      m_stages.push_back (stage);
+    }
+
+  std::istringstream workerList (workers);
+  std::vector<uint32_t> counts;
+  while (std::getline (workerList, token, ':'))
+    {
+      uint32_t count = std::atoi (token.c_str ());
+      NS_ABORT_MSG_IF (count == 0, "EchoPipeline: stage workers must be positive integers");
+      counts.push_back (count);
+    }
+  for (uint32_t i = 0; i < m_stages.size (); i++)
+    {
+      m_stages[i].workers.assign (i < counts.size () ? counts[i] : 1, Worker ());
+    }
+
+  // the buffer in front of the first stage is the owner's
+  std::istringstream bufferList (buffers);
+  uint32_t i = 1;
+  while (std::getline (bufferList, token, ':') && i < m_stages.size ())
+    {
+      m_stages[i++].queueSize = std::atoi (token.c_str ());
+    }
+
+  std::istringstream distributionList (distributions);
+  i = 0;
+  while (std::getline (distributionList, token, ':') && i < m_stages.size ())
+    {
+      NS_ABORT_MSG_IF (token != "Exponential" && token != "Deterministic",
+                       "EchoPipeline: unknown stage distribution " << token);
+      m_stages[i++].deterministic = (token == "Deterministic");
+    }
+}
+
+void
+EchoPipeline::SetSource (Callback<bool, ServerQueueEntry &, double &> source)
+{
+  m_source = source;
+}
+
+void
+EchoPipeline::SetServiceTime (Callback<Time, double, bool> serviceTime)
+{
+  m_serviceTime = serviceTime;
+}
+
+void
+EchoPipeline::SetSink (Callback<void, const ServerQueueEntry &> sink)
+{
+  m_sink = sink;
+}
+
+void
+EchoPipeline::Dispatch (void)
+{
+  if (!m_stages.empty ())
+    {
+      Dispatch (0);
+    }
+}
+
+void
+EchoPipeline::Stop (void)
+{
+  for (uint32_t i = 0; i < m_stages.size (); i++)
+    {
+      for (uint32_t w = 0; w < m_stages[i].workers.size (); w++)
+        {
+          Simulator::Cancel (m_stages[i].workers[w].completeEvent);
+        }
+    }
+}
+
+void
+EchoPipeline::RecordSourceLength (uint32_t length)
+{
+  if (!m_stages.empty ())
+    {
+      m_stages[0].maxQueueLength = std::max (m_stages[0].maxQueueLength, length);
+    }
+}
+
+void
+EchoPipeline::Dispatch (uint32_t stage)
+{
+  Stage &st = m_stages[stage];
+  Time now = Simulator::Now ();
+  while (st.occupied < st.workers.size ())
+    {
+      Entry request;
+      if (stage == 0)
+        {
+          if (!m_source (request.entry, request.cost))
+            {
+              break;
+            }
+          request.enter = request.entry.GetEnqueueTime ();
+        }
+      else
+        {
+          if (st.queue.empty ())
+            {
+              break;
+            }
+          request = st.queue.front ();
+          st.queue.pop_front ();
+          st.queueAverage.Update (now, st.queue.size ());
+        }
+
+      uint32_t w = 0;
+      while (st.workers[w].busy)
+        {
+          w++;
+        }
+      Worker &worker = st.workers[w];
+      worker.request = request;
+      worker.busy = true;
+      st.occupied++;
+      st.busyAverage.Update (now, st.occupied - st.blockedWorkers);
+
+      // the stage takes its share of the service time of the request
+      Time serviceTime = m_serviceTime (st.work * request.cost, st.deterministic);
+      worker.completeEvent = Simulator::Schedule (serviceTime, &EchoPipeline::Complete, this, stage, w);
+
+      // a slot of the buffer freed up
+      if (stage > 0)
+        {
+          Unblock (stage - 1);
+        }
+    }
+}
+
+bool
+EchoPipeline::HasRoom (uint32_t stage) const
+{
+  const Stage &st = m_stages[stage];
+  return st.occupied < st.workers.size () || st.queueSize == 0 || st.queue.size () < st.queueSize;
+}
+
+void
+EchoPipeline::Complete (uint32_t stage, uint32_t worker)
+{
+  Stage &st = m_stages[stage];
+  if (stage + 1 < m_stages.size () && !HasRoom (stage + 1))
+    {
+      // blocking after service: the worker holds the request
+      Time now = Simulator::Now ();
+      st.workers[worker].blocked = true;
+      st.blocked.push_back (worker);
+      st.blockedWorkers++;
+      st.busyAverage.Update (now, st.occupied - st.blockedWorkers);
+      st.blockedAverage.Update (now, st.blockedWorkers);
+      return;
+    }
+
+  Advance (stage, worker);
+  if (stage + 1 < m_stages.size ())
+    {
+      Dispatch (stage + 1);
+    }
+  Dispatch (stage);
+}
+
+void
+EchoPipeline::Advance (uint32_t stage, uint32_t worker)
+{
+  Stage &st = m_stages[stage];
+  Worker &w = st.workers[worker];
+  Time now = Simulator::Now ();
+  Entry request = w.request;
+
+  st.latency.Add ((now - request.enter).GetSeconds ());
+  st.served++;
+  w.request = Entry ();
+  w.busy = false;
+  w.blocked = false;
+  st.occupied--;
+  st.busyAverage.Update (now, st.occupied - st.blockedWorkers);
+  st.blockedAverage.Update (now, st.blockedWorkers);
+
+  if (stage + 1 < m_stages.size ())
+    {
+      Stage &next = m_stages[stage + 1];
+      request.enter = now;
+      next.queue.push_back (request);
+      next.maxQueueLength = std::max<uint32_t> (next.maxQueueLength, next.queue.size ());
+      next.queueAverage.Update (now, next.queue.size ());
+      return;
+    }
+  m_sink (request.entry);
+}
+
+void
+EchoPipeline::Unblock (uint32_t stage)
+{
+  Stage &st = m_stages[stage];
+  bool released = false;
+  while (!st.blocked.empty () && HasRoom (stage + 1))
+    {
+      uint32_t worker = st.blocked.front ();
+      st.blocked.pop_front ();
+      st.blockedWorkers--;
+      Advance (stage, worker);
+      released = true;
+    }
+
+  // the released workers take new requests, which may unblock the stage before
+  if (released)
+    {
+      Dispatch (stage);
+    }
+}
+
+double
+EchoPipeline::GetMeanQueueLength (uint32_t stage) const
+{
+  return m_stages[stage].queueAverage.Get (m_startTime, Simulator::Now ());
+}
+
+double
+EchoPipeline::GetUtilization (uint32_t stage) const
+{
+  const Stage &st = m_stages[stage];
+  return st.busyAverage.Get (m_startTime, Simulator::Now ()) / st.workers.size ();
+}
+
+double
+EchoPipeline::GetBlocking (uint32_t stage) const
+{
+  const Stage &st = m_stages[stage];
+  return st.blockedAverage.Get (m_startTime, Simulator::Now ()) / st.workers.size ();
+}
+
+} // namespace ns3
@@ -0,0 +1,246 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_PIPELINE_H
+#define ECHO_PIPELINE_H
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/callback.h"
+
+#include "server-packet-queue.h"
+#include "echo-sketch.h"
+#include "echo-time-average.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief a tandem pipeline of service stages (e.g., parse, compute,
+ * respond).
+ *
+ * Stage i takes its share of the service time of a request, has its own
+ * workers and service distribution, and a bounded buffer in front of it.
+ * A worker whose next stage is full keeps its request (blocking after
+ * service) until a slot frees up, so a slow stage backs up the stages
+ * before it. The owner's buffers are the buffer of the first stage: the
+ * source callback hands the next request over, the service time callback
+ * turns a share of the work in to a service time, and the sink callback
+ * takes the requests which left the last stage.
+ */
+class EchoPipeline
+{
+public:
+  /**
+   * \brief a request in a stage
+   */
+  struct Entry
+  {
+    Entry () : cost (1.0) {}
+    ServerQueueEntry entry; //!< the request
+    Time enter; //!< time the request entered the stage
+    double cost; //!< service time over the one of a cache miss
+  };
+
+  /**
+   * \brief a worker of a stage
+   */
+  struct Worker
+  {
+    Worker () : busy (false), blocked (false) {}
+    Entry request; //!< the request served or held
+    bool busy; //!< serving or holding a request
+    bool blocked; //!< done, waiting for room in the next stage
+    EventId completeEvent; //!< Event to complete the service
+  };
+
+  /**
+   * \brief a stage and its statistics
+   */
+  struct Stage
+  {
+    Stage () : work (1.0), queueSize (0), deterministic (false),
+               occupied (0), blockedWorkers (0), maxQueueLength (0), served (0) {}
+    double work; //!< share of the service time of a request
+    uint32_t queueSize; //!< buffer in front of the stage (0 means unlimited)
+    bool deterministic; //!< constant instead of exponential service times
+    std::deque<Entry> queue; //!< requests waiting for a worker
+    std::vector<Worker> workers; //!< the workers
+    std::deque<uint32_t> blocked; //!< blocked workers, in the order they blocked
+    uint32_t occupied; //!< busy or blocked workers
+    uint32_t blockedWorkers; //!< blocked workers
+    uint32_t maxQueueLength; //!< the longest observed buffer
+    uint64_t served; //!< requests which left the stage
+    EchoTimeAverage queueAverage; //!< time average of the buffer length
+    EchoTimeAverage busyAverage; //!< time average of the serving workers
+    EchoTimeAverage blockedAverage; //!< time average of the blocked workers
+    EchoSketch latency; //!< stage entry to stage exit times (s)
+  };
+
+  EchoPipeline ();
+
+  /**
+   * \brief parse the stages from colon separated lists, e.g. "1:2:1"; an
+   * empty work list disables the pipeline. The statistics start now.
+   * \param work the shares of the service time of the stages
+   * \param workers the workers of the stages (1 if not listed)
+   * \param buffers the buffers between the stages (unlimited if not listed)
+   * \param distributions the service distributions of the stages,
+   * "Exponential" or "Deterministic"
+   * \param deterministic the distribution of the stages not listed
+   */
+  void Configure (const std::string &work, const std::string &workers, const std::string &buffers,
+                  const std::string &distributions, bool deterministic);
+
+  /**
+   * \brief set the callback taking the next request out of the owner's
+   * buffers: it returns false if they are empty, else the request and its
+   * service time over the one of a cache miss
+   * \param source the callback
+   */
+  void SetSource (Callback<bool, ServerQueueEntry &, double &> source);
+
+  /**
+   * \brief set the callback drawing a service time from its mean cost and
+   * its distribution (true if deterministic)
+   * \param serviceTime the callback
+   */
+  void SetServiceTime (Callback<Time, double, bool> serviceTime);
+
+  /**
+   * \brief set the callback taking the requests which left the last stage
+   * \param sink the callback
+   */
+  void SetSink (Callback<void, const ServerQueueEntry &> sink);
+
+  /**
+   * \brief start the idle workers of the first stage on the requests of
+   * the source
+   */
+  void Dispatch (void);
+
+  /**
+   * \brief cancel the services in progress
+   */
+  void Stop (void);
+
+  /**
+   * \brief account the length of the owner's buffers, the buffer of the
+   * first stage, in its longest observed buffer; their time average is
+   * the owner's
+   * \param length the number of waiting requests
+   */
+  void RecordSourceLength (uint32_t length);
+
+  /**
+   * \return true if the requests go through the pipeline
+   */
+  bool IsEnabled (void) const
+  {
+    return !m_stages.empty ();
+  }
+
+  /**
+   * \return the number of stages
+   */
+  uint32_t GetStageCount (void) const
+  {
+    return m_stages.size ();
+  }
+
+  /**
+   * \param stage the stage index
+   * \return the stage
+   */
+  const Stage &GetStage (uint32_t stage) const
+  {
+    return m_stages[stage];
+  }
+
+  /**
+   * \param stage the stage index
+   * \return the time average of the buffer of the stage since the start
+   * (0 for the first stage, whose buffer is the owner's)
+   */
+  double GetMeanQueueLength (uint32_t stage) const;
+
+  /**
+   * \param stage the stage index
+   * \return the time average of the fraction of the workers of the stage
+   * serving a request
+   */
+  double GetUtilization (uint32_t stage) const;
+
+  /**
+   * \param stage the stage index
+   * \return the time average of the fraction of the workers of the stage
+   * blocked by the next stage
+   */
+  double GetBlocking (uint32_t stage) const;
+
+private:
+  /**
+   * \brief start the idle workers of a stage on the waiting requests
+   * \param stage the stage index
+   */
+  void Dispatch (uint32_t stage);
+
+  /**
+   * \brief a worker of a stage finished its request
+   * \param stage the stage index
+   * \param worker the worker index
+   */
+  void Complete (uint32_t stage, uint32_t worker);
+
+  /**
+   * \param stage the stage index
+   * \return a request can enter the stage: a worker is idle or its buffer
+   * has room
+   */
+  bool HasRoom (uint32_t stage) const;
+
+  /**
+   * \brief release the request of a worker to the next stage, or to the
+   * sink after the last stage
+   * \param stage the stage index
+   * \param worker the worker index
+   */
+  void Advance (uint32_t stage, uint32_t worker);
+
+  /**
+   * \brief pass the requests of the blocked workers of a stage to the
+   * next stage while it has room
+   * \param stage the stage index
+   */
+  void Unblock (uint32_t stage);
+
+  std::vector<Stage> m_stages; //!< the stages, empty if the pipeline is disabled
+  Callback<bool, ServerQueueEntry &, double &> m_source; //!< takes the next request of the first stage
+  Callback<Time, double, bool> m_serviceTime; //!< draws a service time
+  Callback<void, const ServerQueueEntry &> m_sink; //!< takes the requests which left the last stage
+  Time m_startTime; //!< time the statistics started
+};
+
+} // namespace ns3
+
+#endif /* ECHO_PIPELINE_H */
@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+
+#include "ns3/assert.h"
+#include "echo-sketch.h"
+
+namespace ns3 {
+
+EchoSketch::EchoSketch (double relativeAccuracy, uint32_t maxBins)
+  : m_maxBins (std::max<uint32_t> (maxBins, 1)),
+    m_offset (0),
+    m_zeroCount (0),
+    m_count (0),
+    m_sum (0.0),
+    m_min (0.0),
+    m_max (0.0)
+{
+  NS_ASSERT (relativeAccuracy > 0.0 && relativeAccuracy < 1.0);
+  m_gamma = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+  m_multiplier = 1.0 / std::log (m_gamma);
+}
+
+void
+EchoSketch::Extend (int32_t low, int32_t high)
+{
+  if (!m_bins.empty ())
+    {
+      low = std::min (low, m_offset);
+      high = std::max (high, m_offset + (int32_t) m_bins.size () - 1);
+    }
+  if (high - low + 1 > (int32_t) m_maxBins)
+    {
+      low = high - (int32_t) m_maxBins + 1;
+    }
+
+  std::vector<uint64_t> bins (high - low + 1, 0);
+  for (uint32_t i = 0; i < m_bins.size (); i++)
+    {
+      bins[std::max (m_offset + (int32_t) i, low) - low] += m_bins[i];
+    }
+  m_bins.swap (bins);
+  m_offset = low;
+}
+
+void
+EchoSketch::Merge (const EchoSketch &other)
+{
+  NS_ASSERT_MSG (m_gamma == other.m_gamma, "EchoSketch: merging sketches of different accuracies");
+
+  if (other.m_count == 0)
+    {
+      return;
+    }
+  if (!other.m_bins.empty ())
+    {
+      Extend (other.m_offset, other.m_offset + (int32_t) other.m_bins.size () - 1);
+      for (uint32_t i = 0; i < other.m_bins.size (); i++)
+        {
+          m_bins[std::max (other.m_offset + (int32_t) i, m_offset) - m_offset] += other.m_bins[i];
+        }
+    }
+  m_min = (m_count == 0 || other.m_min < m_min) ? other.m_min : m_min;
+  m_max = (m_count == 0 || other.m_max > m_max) ? other.m_max : m_max;
+  m_zeroCount += other.m_zeroCount;
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+}
+
+void
+EchoSketch::Clear (void)
+{
+  // the bins are kept, the index range of the next values is likely the same
+  std::fill (m_bins.begin (), m_bins.end (), 0);
+  m_zeroCount = 0;
+  m_count = 0;
+  m_sum = 0.0;
+  m_min = 0.0;
+  m_max = 0.0;
+}
+
+double
+EchoSketch::GetQuantile (double q) const
+{
+  if (m_count == 0)
+    {
+      return 0.0;
+    }
+
+  double rank = std::min (std::max (q, 0.0), 1.0) * (m_count - 1);
+  uint64_t seen = m_zeroCount;
+  if (rank < seen)
+    {
+      return m_min;
+    }
+  for (uint32_t i = 0; i < m_bins.size (); i++)
+    {
+      seen += m_bins[i];
+      if (rank < seen)
+        {
+          // the bin (gamma^(k-1), gamma^k] is represented by 2 gamma^k / (gamma + 1)
+          double value = 2.0 * std::exp ((m_offset + (int32_t) i) / m_multiplier) / (m_gamma + 1.0);
+          return std::min (std::max (value, m_min), m_max);
+        }
+    }
+  return m_max;
+}
+
+} // namespace ns3
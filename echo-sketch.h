@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_SKETCH_H
+#define ECHO_SKETCH_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief a mergeable quantile sketch of positive values (DDSketch).
+ *
+ * A value v is counted in the bin ceil (log_gamma (v)) with
+ * gamma = (1 + a) / (1 - a), so every quantile is returned with a relative
+ * error of at most a. The bins are a dense array over the observed index
+ * range; when it exceeds the maximum number of bins the lowest bins are
+ * collapsed, which keeps the memory bounded and the upper quantiles exact
+ * to a. Sketches with the same accuracy merge by adding their bins.
+ * Values at or below zero are counted apart as zeros.
+ */
+class EchoSketch
+{
+public:
+  /**
+   * \param relativeAccuracy the relative error a of the quantiles
+   * \param maxBins the maximum number of bins
+   */
+  EchoSketch (double relativeAccuracy = 0.01, uint32_t maxBins = 2048);
+
+  /**
+   * \brief add a value
+   * \param value the value
+   */
+  void Add (double value)
+  {
+    m_count++;
+    m_sum += value;
+    m_min = (m_count == 1 || value < m_min) ? value : m_min;
+    m_max = (m_count == 1 || value > m_max) ? value : m_max;
+    if (value <= 0.0)
+      {
+        m_zeroCount++;
+        return;
+      }
+    int32_t index = Index (value);
+    if (m_bins.empty () || index < m_offset || index >= m_offset + (int32_t) m_bins.size ())
+      {
+        Extend (index, index);
+      }
+    m_bins[std::max (index, m_offset) - m_offset]++;
+  }
+
+  /**
+   * \brief add the values of another sketch of the same accuracy
+   * \param other the other sketch
+   */
+  void Merge (const EchoSketch &other);
+
+  /**
+   * \brief remove all the values
+   */
+  void Clear (void);
+
+  /**
+   * \param q the quantile (0 to 1)
+   * \return the estimate of the q-th quantile, or zero if the sketch is empty
+   */
+  double GetQuantile (double q) const;
+
+  /**
+   * \return the number of values
+   */
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  /**
+   * \return the mean of the values, or zero if the sketch is empty
+   */
+  double GetMean (void) const
+  {
+    return m_count ? m_sum / m_count : 0.0;
+  }
+
+  /**
+   * \return the smallest value, or zero if the sketch is empty
+   */
+  double GetMin (void) const
+  {
+    return m_min;
+  }
+
+  /**
+   * \return the largest value, or zero if the sketch is empty
+   */
+  double GetMax (void) const
+  {
+    return m_max;
+  }
+
+private:
+  /**
+   * \param value a positive value
+   * \return the index of the bin of the value
+   */
+  int32_t Index (double value) const
+  {
+    return (int32_t) std::ceil (std::log (value) * m_multiplier);
+  }
+
+  /**
+   * \brief extend the bins to cover the index range, collapsing the lowest
+   * bins if the range is wider than the maximum number of bins
+   * \param low the lowest index to cover
+   * \param high the highest index to cover
+   */
+  void Extend (int32_t low, int32_t high);
+
+  double m_gamma; //!< (1 + a) / (1 - a)
+  double m_multiplier; //!< 1 / ln (gamma)
+  uint32_t m_maxBins; //!< maximum number of bins
+  std::vector<uint64_t> m_bins; //!< counts of the bins m_offset, m_offset + 1, ...
+  int32_t m_offset; //!< index of the first bin
+  uint64_t m_zeroCount; //!< number of values at or below zero
+  uint64_t m_count; //!< number of values
+  double m_sum; //!< sum of the values
+  double m_min; //!< smallest value
+  double m_max; //!< largest value
+};
+
+} // namespace ns3
+
+#endif /* ECHO_SKETCH_H */
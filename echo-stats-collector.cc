@@ -0,0 +1,369 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+
+#include <sstream>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/application.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "echo-stats-collector.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EchoStatsCollector");
+NS_OBJECT_ENSURE_REGISTERED (EchoStatsCollector);
+
+TypeId
+EchoStatsCollector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EchoStatsCollector")
+    .SetParent<Object> ()
+    .AddConstructor<EchoStatsCollector> ()
+    .AddAttribute ("SnapshotInterval",
+                   "Simulated time between two snapshots",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&EchoStatsCollector::m_snapshotInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("FileName",
+                   "Columnar snapshot file (empty disables the snapshots)",
+                   StringValue (""),
+                   MakeStringAccessor (&EchoStatsCollector::m_fileName),
+                   MakeStringChecker ())
+    .AddAttribute ("BufferRows",
+                   "Number of snapshot rows buffered before they are written",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&EchoStatsCollector::m_bufferRows),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RelativeAccuracy",
+                   "Relative error of the quantiles of the sketches",
+                   DoubleValue (0.01),
+                   MakeDoubleAccessor (&EchoStatsCollector::m_accuracy),
+                   MakeDoubleChecker<double> (0.0001, 0.5))
+    .AddAttribute ("MaxBins",
+                   "Maximum number of bins of a sketch; the lowest bins are collapsed beyond",
+                   UintegerValue (2048),
+                   MakeUintegerAccessor (&EchoStatsCollector::m_maxBins),
+                   MakeUintegerChecker<uint32_t> (16))
+  ;
+  return tid;
+}
+
+EchoStatsCollector::EchoStatsCollector ()
+  : m_file (0),
+    m_started (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+EchoStatsCollector::~EchoStatsCollector ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_file != 0)
+    {
+      Flush ();
+      fclose (m_file);
+    }
+}
+
+void
+EchoStatsCollector::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_snapshotEvent);
+  if (m_file != 0)
+    {
+      Flush ();
+      fclose (m_file);
+      m_file = 0;
+    }
+  Object::DoDispose ();
+}
+
+uint32_t
+EchoStatsCollector::InternGroup (std::string name)
+{
+  for (uint32_t g = 0; g < m_groups.size (); g++)
+    {
+      if (m_groups[g].name == name)
+        {
+          return g;
+        }
+    }
+  NS_ABORT_MSG_IF (m_started, "EchoStatsCollector: add the applications before Start");
+
+  Group group;
+  group.name = name;
+  group.sources[ECHO_STATS_RTT] = 0;
+  group.sources[ECHO_STATS_SOJOURN] = 0;
+  group.sent = 0;
+  group.total.assign (ECHO_STATS_SOJOURN + 1, EchoSketch (m_accuracy, m_maxBins));
+  m_groups.push_back (group);
+  return m_groups.size () - 1;
+}
+
+uint32_t
+EchoStatsCollector::AddSource (EchoStatsMetric metric, std::string group)
+{
+  InternGroup ("all");
+  Source source;
+  source.group = InternGroup (group);
+  source.metric = metric;
+  source.sketch = EchoSketch (m_accuracy, m_maxBins);
+  m_sources.push_back (source);
+  m_groups[0].sources[metric]++;
+  m_groups[source.group].sources[metric]++;
+  return m_sources.size () - 1;
+}
+
+void
+EchoStatsCollector::AddClient (Ptr<Application> client, std::string group)
+{
+  NS_LOG_FUNCTION (this << client << group);
+
+  if (group.empty ())
+    {
+      UintegerValue trafficClass;
+      client->GetAttribute ("TrafficClass", trafficClass);
+      std::ostringstream name;
+      name << "class " << trafficClass.Get ();
+      group = name.str ();
+    }
+  uint32_t source = AddSource (ECHO_STATS_RTT, group);
+  client->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&EchoStatsCollector::RecordLatency, this, source));
+  client->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&EchoStatsCollector::RecordSent, this, source));
+}
+
+void
+EchoStatsCollector::AddServer (Ptr<Application> server, std::string group)
+{
+  NS_LOG_FUNCTION (this << server << group);
+
+  if (group.empty ())
+    {
+      std::ostringstream name;
+      name << "server " << server->GetNode ()->GetId ();
+      group = name.str ();
+    }
+  uint32_t source = AddSource (ECHO_STATS_SOJOURN, group);
+  server->TraceConnectWithoutContext ("Sojourn", MakeBoundCallback (&EchoStatsCollector::RecordLatency, this, source));
+}
+
+void
+EchoStatsCollector::RecordLatency (EchoStatsCollector *collector, uint32_t source, Time latency)
+{
+  collector->m_sources[source].sketch.Add (latency.GetSeconds ());
+}
+
+void
+EchoStatsCollector::RecordSent (EchoStatsCollector *collector, uint32_t source, Ptr<const Packet> /* packet */)
+{
+  collector->m_groups[0].sent++;
+  collector->m_groups[collector->m_sources[source].group].sent++;
+}
+
+void
+EchoStatsCollector::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  InternGroup ("all");
+  m_started = true;
+  if (m_fileName.empty () || m_snapshotInterval.IsZero ())
+    {
+      return;
+    }
+
+  m_file = fopen (m_fileName.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_LOG_WARN ("Cannot open the snapshot file " << m_fileName);
+      return;
+    }
+
+  EchoStatsFileHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, ECHO_STATS_MAGIC, sizeof (header.magic));
+  header.columns = ECHO_STATS_COLUMNS;
+  header.groups = m_groups.size ();
+  fwrite (&header, sizeof (header), 1, m_file);
+  for (uint32_t g = 0; g < m_groups.size (); g++)
+    {
+      uint32_t length = m_groups[g].name.size ();
+      fwrite (&length, sizeof (length), 1, m_file);
+      fwrite (m_groups[g].name.data (), 1, length, m_file);
+    }
+
+  for (uint32_t c = 0; c < ECHO_STATS_COLUMNS; c++)
+    {
+      m_columns[c].reserve (m_bufferRows);
+    }
+  m_snapshotEvent = Simulator::Schedule (m_snapshotInterval, &EchoStatsCollector::Snapshot, this);
+}
+
+void
+EchoStatsCollector::Snapshot (void)
+{
+  NS_LOG_FUNCTION (this);
+  Collect ();
+  m_snapshotEvent = Simulator::Schedule (m_snapshotInterval, &EchoStatsCollector::Snapshot, this);
+}
+
+void
+EchoStatsCollector::Collect (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // merge the sketches of the interval per group and metric
+  uint32_t metrics = ECHO_STATS_SOJOURN + 1;
+  std::vector<EchoSketch> interval (m_groups.size () * metrics, EchoSketch (m_accuracy, m_maxBins));
+  for (std::vector<Source>::iterator it = m_sources.begin (); it != m_sources.end (); ++it)
+    {
+      if (it->sketch.GetCount () == 0)
+        {
+          continue;
+        }
+      interval[it->metric].Merge (it->sketch);
+      if (it->group != 0)
+        {
+          interval[it->group * metrics + it->metric].Merge (it->sketch);
+        }
+      it->sketch.Clear ();
+    }
+
+  for (uint32_t g = 0; g < m_groups.size (); g++)
+    {
+      for (uint32_t m = 0; m < metrics; m++)
+        {
+          if (m_groups[g].sources[m] == 0)
+            {
+              continue;
+            }
+          const EchoSketch &sketch = interval[g * metrics + m];
+          m_groups[g].total[m].Merge (sketch);
+          if (m_file != 0)
+            {
+              AppendRow (g, (EchoStatsMetric) m, sketch);
+            }
+        }
+    }
+}
+
+void
+EchoStatsCollector::AppendRow (uint32_t group, EchoStatsMetric metric, const EchoSketch &sketch)
+{
+  m_columns[ECHO_STATS_TIME].push_back (Simulator::Now ().GetSeconds ());
+  m_columns[ECHO_STATS_GROUP].push_back (group);
+  m_columns[ECHO_STATS_METRIC].push_back (metric);
+  m_columns[ECHO_STATS_COUNT].push_back (sketch.GetCount ());
+  m_columns[ECHO_STATS_MEAN].push_back (sketch.GetMean ());
+  m_columns[ECHO_STATS_P50].push_back (sketch.GetQuantile (0.50));
+  m_columns[ECHO_STATS_P90].push_back (sketch.GetQuantile (0.90));
+  m_columns[ECHO_STATS_P99].push_back (sketch.GetQuantile (0.99));
+  m_columns[ECHO_STATS_MAX].push_back (sketch.GetMax ());
+  if (m_columns[ECHO_STATS_TIME].size () >= m_bufferRows)
+    {
+      Flush ();
+    }
+}
+
+void
+EchoStatsCollector::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t rows = m_columns[ECHO_STATS_TIME].size ();
+  if (m_file == 0 || rows == 0)
+    {
+      return;
+    }
+  EchoStatsBlockHeader block;
+  block.rows = rows;
+  block.reserved = 0;
+  fwrite (&block, sizeof (block), 1, m_file);
+  for (uint32_t c = 0; c < ECHO_STATS_COLUMNS; c++)
+    {
+      fwrite (&m_columns[c][0], sizeof (double), rows, m_file);
+      m_columns[c].clear ();
+    }
+  fflush (m_file);
+}
+
+EchoSketch
+EchoStatsCollector::GetSketch (EchoStatsMetric metric, std::string group)
+{
+  EchoSketch sketch (m_accuracy, m_maxBins);
+  for (uint32_t g = 0; g < m_groups.size (); g++)
+    {
+      if (m_groups[g].name != group)
+        {
+          continue;
+        }
+      // the totals and the samples since the last snapshot
+      sketch.Merge (m_groups[g].total[metric]);
+      for (std::vector<Source>::const_iterator it = m_sources.begin (); it != m_sources.end (); ++it)
+        {
+          if (it->metric == metric && (g == 0 || it->group == g))
+            {
+              sketch.Merge (it->sketch);
+            }
+        }
+    }
+  return sketch;
+}
+
+void
+EchoStatsCollector::Print (std::ostream &os)
+{
+  NS_LOG_FUNCTION (this);
+
+  static const char *metricNames[] = {"rtt", "sojourn"};
+  for (uint32_t g = 0; g < m_groups.size (); g++)
+    {
+      for (uint32_t m = 0; m <= ECHO_STATS_SOJOURN; m++)
+        {
+          if (m_groups[g].sources[m] == 0)
+            {
+              continue;
+            }
+          EchoSketch sketch = GetSketch ((EchoStatsMetric) m, m_groups[g].name);
+          os << m_groups[g].name << " " << metricNames[m] << ": " <<
+                "apps: " << m_groups[g].sources[m];
+          if (m == ECHO_STATS_RTT)
+            {
+              os << " sent: " << m_groups[g].sent;
+            }
+          os << " samples: " << sketch.GetCount () <<
+                " mean: " << sketch.GetMean () <<
+                " p50/p90/p99/p99.9: " << sketch.GetQuantile (0.50) <<
+                " " << sketch.GetQuantile (0.90) <<
+                " " << sketch.GetQuantile (0.99) <<
+                " " << sketch.GetQuantile (0.999) <<
+                " max: " << sketch.GetMax () << std::endl;
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_STATS_COLLECTOR_H
+#define ECHO_STATS_COLLECTOR_H
+
+#include <stdio.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+
+#include "echo-sketch.h"
+#include "echo-stats-record.h"
+
+namespace ns3 {
+
+class Application;
+class Packet;
+
+/**
+ * \ingroup udpecho
+ * \brief collects the latencies of all the echo applications in mergeable
+ * sketches.
+ *
+ * Clients (RTTs, "Rtt" trace source) and servers (sojourn times, "Sojourn"
+ * trace source) are added to a group, by default the traffic class of a
+ * client and the node of a server. Every application records in its own
+ * EchoSketch; every snapshot interval the sketches are merged in to the
+ * group totals and one row per group and metric (plus the "all" group) is
+ * appended to a column buffer, which is written to the snapshot file when
+ * it is full and when the collector is disposed. Nothing is written per
+ * packet and the memory does not grow with the number of packets.
+ */
+class EchoStatsCollector : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  EchoStatsCollector ();
+  virtual ~EchoStatsCollector ();
+
+  /**
+   * \brief collect the RTTs of a UdpEchoClient
+   * \param client the client
+   * \param group the group name, "class <TrafficClass>" if empty
+   */
+  void AddClient (Ptr<Application> client, std::string group = "");
+
+  /**
+   * \brief collect the sojourn times of a UdpEchoServer
+   * \param server the server
+   * \param group the group name, "server <node id>" if empty
+   */
+  void AddServer (Ptr<Application> server, std::string group = "");
+
+  /**
+   * \brief open the snapshot file and schedule the first snapshot.
+   * Add the applications before.
+   */
+  void Start (void);
+
+  /**
+   * \brief write the buffered snapshot rows to the file
+   */
+  void Flush (void);
+
+  /**
+   * \param metric the metric
+   * \param group the group name, "all" for every application
+   * \return the sketch of all the samples of the group so far
+   */
+  EchoSketch GetSketch (EchoStatsMetric metric, std::string group = "all");
+
+  /**
+   * \brief print the global and the per-group summaries
+   * \param os the output stream
+   */
+  void Print (std::ostream &os);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * \brief an application added to the collector
+   */
+  struct Source
+  {
+    uint32_t group; //!< index of the group
+    EchoStatsMetric metric; //!< the metric recorded
+    EchoSketch sketch; //!< samples since the last snapshot
+  };
+
+  /**
+   * \brief the totals of a group
+   */
+  struct Group
+  {
+    std::string name; //!< the group name
+    uint32_t sources[ECHO_STATS_SOJOURN + 1]; //!< applications per metric
+    uint64_t sent; //!< requests sent by the clients
+    std::vector<EchoSketch> total; //!< all the samples per metric
+  };
+
+  /**
+   * \brief get the index of a group, adding it if it is new
+   * \param name the group name
+   * \return the group index
+   */
+  uint32_t InternGroup (std::string name);
+
+  /**
+   * \brief add an application
+   * \return the source index
+   */
+  uint32_t AddSource (EchoStatsMetric metric, std::string group);
+
+  /**
+   * \brief merge the per-application sketches in to the group totals and
+   * append the rows of the interval
+   */
+  void Collect (void);
+
+  /**
+   * \brief append a row to the column buffer
+   */
+  void AppendRow (uint32_t group, EchoStatsMetric metric, const EchoSketch &sketch);
+
+  /**
+   * \brief collect and schedule the next snapshot
+   */
+  void Snapshot (void);
+
+  static void RecordLatency (EchoStatsCollector *collector, uint32_t source, Time latency);
+  static void RecordSent (EchoStatsCollector *collector, uint32_t source, Ptr<const Packet> packet);
+
+  Time m_snapshotInterval; //!< period of the snapshots (0 disables them)
+  std::string m_fileName; //!< snapshot file ("" disables the snapshots)
+  uint32_t m_bufferRows; //!< rows buffered before they are written
+  double m_accuracy; //!< relative accuracy of the sketches
+  uint32_t m_maxBins; //!< maximum number of bins per sketch
+  std::vector<Source> m_sources; //!< the applications
+  std::vector<Group> m_groups; //!< the groups, 0 is "all"
+  std::vector<double> m_columns[ECHO_STATS_COLUMNS]; //!< buffered snapshot rows
+  FILE *m_file; //!< the snapshot file
+  EventId m_snapshotEvent; //!< next snapshot
+  bool m_started; //!< Start was called
+};
+
+} // namespace ns3
+
+#endif /* ECHO_STATS_COLLECTOR_H */
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_STATS_RECORD_H
+#define ECHO_STATS_RECORD_H
+
+#include <stdint.h>
+
+/**
+ * \brief the binary snapshot file format of EchoStatsCollector, shared
+ * with the offline decoder (echo-trace-decode.cc), which does not depend
+ * on ns-3.
+ *
+ * A file is an EchoStatsFileHeader, the group names (a uint32_t length
+ * and the characters each, group 0 being "all"), and then blocks. A block
+ * is an EchoStatsBlockHeader followed by its columns: for every
+ * EchoStatsColumn in order, "rows" doubles. Everything is in the byte
+ * order of the host which wrote it.
+ */
+
+#define ECHO_STATS_MAGIC "ECHOSTS1" //!< first 8 bytes of a snapshot file
+
+/**
+ * \brief the columns of a snapshot block, one row per group, metric and
+ * snapshot interval
+ */
+enum EchoStatsColumn {
+  ECHO_STATS_TIME = 0, //!< end of the interval (s)
+  ECHO_STATS_GROUP, //!< index of the group
+  ECHO_STATS_METRIC, //!< EchoStatsMetric
+  ECHO_STATS_COUNT, //!< number of samples in the interval
+  ECHO_STATS_MEAN, //!< mean (s)
+  ECHO_STATS_P50, //!< median (s)
+  ECHO_STATS_P90, //!< 90th percentile (s)
+  ECHO_STATS_P99, //!< 99th percentile (s)
+  ECHO_STATS_MAX, //!< maximum (s)
+  ECHO_STATS_COLUMNS //!< number of columns
+};
+
+/**
+ * \brief the metrics of the snapshots
+ */
+enum EchoStatsMetric {
+  ECHO_STATS_RTT = 0, //!< client round trip time
+  ECHO_STATS_SOJOURN = 1, //!< server arrival to reply time
+};
+
+/**
+ * \brief the snapshot file header
+ */
+struct EchoStatsFileHeader
+{
+  char magic[8]; //!< ECHO_STATS_MAGIC
+  uint32_t columns; //!< ECHO_STATS_COLUMNS
+  uint32_t groups; //!< number of group names following the header
+};
+
+/**
+ * \brief the header of a block of rows
+ */
+struct EchoStatsBlockHeader
+{
+  uint32_t rows; //!< number of rows of the block
+  uint32_t reserved; //!< zero
+};
+
+#endif /* ECHO_STATS_RECORD_H */
@@ -0,0 +1,311 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/application.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "echo-stopping-rule.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EchoStoppingRule");
+NS_OBJECT_ENSURE_REGISTERED (EchoStoppingRule);
+
+TypeId
+EchoStoppingRule::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EchoStoppingRule")
+    .SetParent<Object> ()
+    .AddConstructor<EchoStoppingRule> ()
+    .AddAttribute ("CheckInterval",
+                   "Simulated time between two precision checks",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&EchoStoppingRule::m_checkInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxTime",
+                   "The simulation stops at this time even if the estimates are not precise enough",
+                   TimeValue (Seconds (1000)),
+                   MakeTimeAccessor (&EchoStoppingRule::m_maxTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("RelativePrecision",
+                   "Target confidence interval half width, relative to the estimate",
+                   DoubleValue (0.05),
+                   MakeDoubleAccessor (&EchoStoppingRule::m_precision),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Batches",
+                   "Number of batches of the batch means method",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&EchoStoppingRule::m_batches),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("Quantile",
+                   "The tail latency quantile which has to be precise as well",
+                   DoubleValue (0.99),
+                   MakeDoubleAccessor (&EchoStoppingRule::m_quantile),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+  ;
+  return tid;
+}
+
+EchoStoppingRule::EchoStoppingRule ()
+  : m_converged (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+EchoStoppingRule::~EchoStoppingRule ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+EchoStoppingRule::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_checkEvent);
+  Object::DoDispose ();
+}
+
+void
+EchoStoppingRule::AddClient (Ptr<Application> client)
+{
+  NS_LOG_FUNCTION (this << client);
+  client->TraceConnectWithoutContext ("Rtt", MakeCallback (&EchoStoppingRule::RecordRtt, this));
+}
+
+void
+EchoStoppingRule::AddServer (Ptr<Application> server)
+{
+  NS_LOG_FUNCTION (this << server);
+  server->TraceConnectWithoutContext ("Sojourn", MakeCallback (&EchoStoppingRule::RecordSojourn, this));
+}
+
+void
+EchoStoppingRule::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_checkEvent = Simulator::Schedule (m_checkInterval, &EchoStoppingRule::Check, this);
+  Simulator::Stop (m_maxTime);
+}
+
+bool
+EchoStoppingRule::IsConverged (void) const
+{
+  return m_converged;
+}
+
+EchoStoppingRule::Estimate
+EchoStoppingRule::GetRtt (void) const
+{
+  return m_rttEstimate;
+}
+
+EchoStoppingRule::Estimate
+EchoStoppingRule::GetSojourn (void) const
+{
+  return m_sojournEstimate;
+}
+
+void
+EchoStoppingRule::RecordRtt (Time rtt)
+{
+  Record (m_rtt, rtt.GetSeconds ());
+}
+
+void
+EchoStoppingRule::RecordSojourn (Time sojourn)
+{
+  Record (m_sojourn, sojourn.GetSeconds ());
+}
+
+void
+EchoStoppingRule::Record (Series &series, double value)
+{
+  if (series.cells.empty () || series.cells.back ().GetCount () == series.cellSize)
+    {
+      if (series.cells.size () == 8 * m_batches)
+        {
+          for (uint32_t i = 0; i < series.cells.size () / 2; i++)
+            {
+              series.cells[i] = series.cells[2 * i];
+              series.cells[i].Merge (series.cells[2 * i + 1]);
+            }
+          series.cells.resize (series.cells.size () / 2);
+          series.cellSize *= 2;
+        }
+      series.cells.push_back (EchoSketch ());
+    }
+  series.cells.back ().Add (value);
+  series.samples++;
+}
+
+void
+EchoStoppingRule::Check (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // a series nobody records into does not hold the simulation
+  bool rttDone = EstimateSeries (m_rtt, m_rttEstimate) || m_rtt.samples == 0;
+  bool sojournDone = EstimateSeries (m_sojourn, m_sojournEstimate) || m_sojourn.samples == 0;
+  if (rttDone && sojournDone && !(m_rtt.samples == 0 && m_sojourn.samples == 0))
+    {
+      NS_LOG_INFO ("Latency estimates are precise enough at " << Simulator::Now ().GetSeconds () << "s");
+      m_converged = true;
+      Simulator::Stop ();
+      return;
+    }
+  m_checkEvent = Simulator::Schedule (m_checkInterval, &EchoStoppingRule::Check, this);
+}
+
+/**
+ * \brief get the mean and the confidence interval half width of batch values
+ */
+static void
+MeanAndHalfWidth (const std::vector<double> &values, double &mean, double &halfWidth)
+{
+  uint32_t n = values.size ();
+  mean = 0.0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      mean += values[i];
+    }
+  mean /= n;
+  double var = 0.0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      var += (values[i] - mean) * (values[i] - mean);
+    }
+  var /= (n - 1);
+  halfWidth = EchoStoppingRule::StudentT975 (n - 1) * std::sqrt (var / n);
+}
+
+/**
+ * \brief find the initial transient with the MSER rule: the series of
+ * batch means is truncated where the standard error of the remaining ones
+ * is the smallest (searching the first half only). Over the means of 5
+ * samples it is MSER-5.
+ * \param z the batch means
+ * \return the number of batch means to drop
+ */
+static uint32_t
+Mser (const std::vector<double> &z)
+{
+  uint32_t m = z.size ();
+  if (m < 2)
+    {
+      return 0;
+    }
+  // suffix sums give the statistic of every truncation point in O(m)
+  double sum = 0.0;
+  double sumSquares = 0.0;
+  std::vector<double> mser (m, 0.0);
+  for (uint32_t d = m; d-- > 0; )
+    {
+      sum += z[d];
+      sumSquares += z[d] * z[d];
+      double n = m - d;
+      mser[d] = (sumSquares - sum * sum / n) / (n * n);
+    }
+  uint32_t best = 0;
+  for (uint32_t d = 1; d <= m / 2; d++)
+    {
+      if (mser[d] < mser[best])
+        {
+          best = d;
+        }
+    }
+  return best;
+}
+
+bool
+EchoStoppingRule::EstimateSeries (const Series &series, Estimate &estimate) const
+{
+  // the last cell is left out until it is full
+  uint32_t full = series.samples / series.cellSize;
+  std::vector<double> z (full);
+  for (uint32_t i = 0; i < full; i++)
+    {
+      z[i] = series.cells[i].GetMean ();
+    }
+
+  // the batches are made of whole cells; the cells which do not divide in
+  // to the batches are dropped with the warm-up
+  uint32_t cells = (full - Mser (z)) / m_batches;
+  uint32_t first = full - cells * m_batches;
+  estimate.samples = series.samples;
+  estimate.warmup = first * series.cellSize;
+
+  // every batch needs enough samples for its own tail quantile
+  uint32_t minSize = std::max<uint32_t> (10, std::ceil (10.0 / (1.0 - m_quantile)));
+  if (cells == 0 || cells * series.cellSize < minSize)
+    {
+      return false;
+    }
+
+  std::vector<double> means;
+  std::vector<double> quantiles;
+  for (uint32_t b = 0; b < m_batches; b++)
+    {
+      EchoSketch batch = series.cells[first + b * cells];
+      for (uint32_t i = 1; i < cells; i++)
+        {
+          batch.Merge (series.cells[first + b * cells + i]);
+        }
+      means.push_back (batch.GetMean ());
+      quantiles.push_back (batch.GetQuantile (m_quantile));
+    }
+  MeanAndHalfWidth (means, estimate.mean, estimate.meanHalfWidth);
+  MeanAndHalfWidth (quantiles, estimate.quantile, estimate.quantileHalfWidth);
+
+  NS_LOG_LOGIC ("samples " << estimate.samples << " warm-up " << estimate.warmup <<
+                " mean " << estimate.mean << " +- " << estimate.meanHalfWidth <<
+                " quantile " << estimate.quantile << " +- " << estimate.quantileHalfWidth);
+  return estimate.meanHalfWidth <= m_precision * estimate.mean &&
+         estimate.quantileHalfWidth <= m_precision * estimate.quantile;
+}
+
+void
+EchoStoppingRule::Print (std::ostream &os) const
+{
+  os << "stopped at " << Simulator::Now ().GetSeconds () << "s, "
+     << (m_converged ? "precision reached" : "maximum time reached") << std::endl;
+  const Estimate *estimates[] = {&m_rttEstimate, &m_sojournEstimate};
+  const char *names[] = {"client rtt", "server sojourn"};
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      const Estimate &e = *estimates[i];
+      os << names[i] << ": samples: " << e.samples << " warm-up: " << e.warmup
+         << " mean: " << e.mean << " +- " << e.meanHalfWidth
+         << " p" << m_quantile * 100 << ": " << e.quantile << " +- " << e.quantileHalfWidth << std::endl;
+    }
+}
+
+double
+EchoStoppingRule::StudentT975 (uint32_t dof)
+{
+  double z = 1.959964;
+  double v = std::max<uint32_t> (dof, 1);
+  return z + (z * z * z + z) / (4 * v) +
+         (5 * std::pow (z, 5) + 16 * z * z * z + 3 * z) / (96 * v * v);
+}
+
+} // namespace ns3
@@ -0,0 +1,181 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_STOPPING_RULE_H
+#define ECHO_STOPPING_RULE_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "echo-sketch.h"
+
+namespace ns3 {
+
+class Application;
+
+/**
+ * \ingroup udpecho
+ * \brief stops the simulation once the latency estimates are precise enough.
+ *
+ * The rule collects the client RTTs ("Rtt" trace source) and the server
+ * sojourn times ("Sojourn" trace source) of the applications added to it.
+ * Every check interval it drops the initial transient of each series with
+ * the MSER-5 rule, splits the rest in to batches and computes the batch
+ * means 95% confidence intervals of the mean and of the quantile (the
+ * mean of the batch quantiles). The simulation is stopped when every half
+ * width is below the relative precision, or at the maximum time.
+ *
+ * The samples are not kept: a series is a fixed number of cells of
+ * consecutive samples (5 at first), each a sketch, and when they are all
+ * full neighbouring cells merge in to cells twice as long. MSER runs over
+ * the cell means and the batches are made of whole cells, so the memory
+ * and the work of a check do not grow with the length of the run.
+ */
+class EchoStoppingRule : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  EchoStoppingRule ();
+  virtual ~EchoStoppingRule ();
+
+  /**
+   * \brief the estimate of a series
+   */
+  struct Estimate
+  {
+    Estimate () : samples (0), warmup (0), mean (0.0), meanHalfWidth (0.0),
+                  quantile (0.0), quantileHalfWidth (0.0) {}
+    uint32_t samples; //!< number of samples
+    uint32_t warmup; //!< number of samples dropped as the initial transient
+    double mean; //!< the mean (s)
+    double meanHalfWidth; //!< confidence interval half width of the mean (s)
+    double quantile; //!< the quantile (s)
+    double quantileHalfWidth; //!< confidence interval half width of the quantile (s)
+  };
+
+  /**
+   * \brief monitor the RTTs of a UdpEchoClient
+   * \param client the client
+   */
+  void AddClient (Ptr<Application> client);
+
+  /**
+   * \brief monitor the sojourn times of a UdpEchoServer
+   * \param server the server
+   */
+  void AddServer (Ptr<Application> server);
+
+  /**
+   * \brief schedule the first check and the maximum time stop
+   */
+  void Start (void);
+
+  /**
+   * \return true if the simulation was stopped as the estimates were precise enough
+   */
+  bool IsConverged (void) const;
+
+  /**
+   * \return the RTT estimate of the last check
+   */
+  Estimate GetRtt (void) const;
+
+  /**
+   * \return the sojourn time estimate of the last check
+   */
+  Estimate GetSojourn (void) const;
+
+  /**
+   * \brief print the estimates
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+  /**
+   * \brief get the 97.5% quantile of the Student t distribution
+   * \param dof the degrees of freedom
+   * \return the quantile (Cornish-Fisher expansion around the normal one)
+   */
+  static double StudentT975 (uint32_t dof);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * \brief estimate the series and stop the simulation if they are precise enough
+   */
+  void Check (void);
+
+  /**
+   * \brief a series summarized in at most 8 * Batches cells: cell i holds
+   * the samples i * cellSize to (i + 1) * cellSize - 1 in a sketch (count,
+   * sum and quantiles), the last one possibly partially
+   */
+  struct Series
+  {
+    Series () : cellSize (5), samples (0) {}
+    std::vector<EchoSketch> cells; //!< the full cells and the one filling up
+    uint32_t cellSize; //!< samples per cell
+    uint32_t samples; //!< number of samples
+  };
+
+  /**
+   * \brief add a sample to a series, merging the cells pairwise when they
+   * are all full
+   * \param series the series
+   * \param value the sample
+   */
+  void Record (Series &series, double value);
+
+  /**
+   * \brief estimate a series
+   * \param series the series
+   * \param estimate the estimate
+   * \return true if the estimate is precise enough
+   */
+  bool EstimateSeries (const Series &series, Estimate &estimate) const;
+
+  void RecordRtt (Time rtt);
+  void RecordSojourn (Time sojourn);
+
+  Time m_checkInterval; //!< period of the checks
+  Time m_maxTime; //!< the simulation stops at this time at the latest
+  double m_precision; //!< target relative half width
+  uint32_t m_batches; //!< number of batches
+  double m_quantile; //!< the tail quantile (e.g., 0.99)
+  EventId m_checkEvent; //!< next check
+  bool m_converged; //!< the estimates were precise enough
+  Series m_rtt; //!< the RTT samples (s)
+  Series m_sojourn; //!< the sojourn time samples (s)
+  Estimate m_rttEstimate; //!< RTT estimate of the last check
+  Estimate m_sojournEstimate; //!< sojourn time estimate of the last check
+};
+
+} // namespace ns3
+
+#endif /* ECHO_STOPPING_RULE_H */
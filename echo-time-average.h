@@ -0,0 +1,73 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_TIME_AVERAGE_H
+#define ECHO_TIME_AVERAGE_H
+
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief an incremental time average of a piecewise constant value.
+ *
+ * Update is called at every change of the value; the area under the
+ * value up to the last update is kept, so the average since any start
+ * time costs O (1).
+ */
+struct EchoTimeAverage
+{
+  EchoTimeAverage () : area (0.0), value (0.0) {}
+
+  /**
+   * \brief account the current value up to now and set the new one
+   * \param now the current time
+   * \param newValue the value from now on
+   */
+  void Update (Time now, double newValue)
+  {
+    area += value * (now - last).GetSeconds ();
+    value = newValue;
+    last = now;
+  }
+
+  /**
+   * \param start the time the average starts at (the first update)
+   * \param now the current time
+   * \return the time average from start to now, or the current value if
+   * no time elapsed
+   */
+  double Get (Time start, Time now) const
+  {
+    double elapsed = (now - start).GetSeconds ();
+    if (elapsed <= 0.0)
+      {
+        return value;
+      }
+    return (area + value * (now - last).GetSeconds ()) / elapsed;
+  }
+
+  double area; //!< integral of the value up to the last update
+  double value; //!< value since the last update
+  Time last; //!< time of the last update
+};
+
+} // namespace ns3
+
+#endif /* ECHO_TIME_AVERAGE_H */
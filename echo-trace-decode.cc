@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Offline decoder of the EchoTrace files. It does not depend on ns-3.
+ *
+ * Build: g++ -O2 -o echo-trace-decode echo-trace-decode.cc
+ * Run:   ./echo-trace-decode trace.bin > events.csv
+ *        ./echo-trace-decode -t 0.1 trace.bin > timeline.csv
+ *
+ * The first form prints one CSV line per event. The second prints, per
+ * node and per interval of the given length (s), the number of events of
+ * every type and the mean RTT of the replies the node received in the
+ * interval (client requests and replies are matched on the sequence number).
+ *
+ * The snapshot files of EchoStatsCollector are recognized as well and
+ * printed as CSV, one line per row:
+ *
+ *        ./echo-trace-decode snapshots.bin > snapshots.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "echo-trace-record.h"
+#include "echo-stats-record.h"
+
+/**
+ * \brief the events of one node in one interval
+ */
+struct Bin
+{
+  Bin () : rttSum (0.0), rttCount (0)
+  {
+    memset (count, 0, sizeof (count));
+  }
+  uint64_t count[ECHO_TRACE_SERVER_DROP + 1]; //!< events per type
+  double rttSum; //!< sum of the RTTs (s)
+  uint64_t rttCount; //!< number of RTTs
+};
+
+static const char *
+EventName (uint8_t type)
+{
+  switch (type)
+    {
+    case ECHO_TRACE_CLIENT_TX: return "client_tx";
+    case ECHO_TRACE_CLIENT_RX: return "client_rx";
+    case ECHO_TRACE_SERVER_RX: return "server_rx";
+    case ECHO_TRACE_SERVER_TX: return "server_tx";
+    case ECHO_TRACE_SERVER_DROP: return "server_drop";
+    default: return "unknown";
+    }
+}
+
+/**
+ * \brief print the rows of an EchoStatsCollector snapshot file
+ * \param file the file, positioned after the file header
+ * \param header the file header
+ * \return the exit status
+ */
+static int
+DecodeStats (FILE *file, const EchoStatsFileHeader &header)
+{
+  static const char *metricNames[] = {"rtt", "sojourn"};
+
+  if (header.columns != ECHO_STATS_COLUMNS)
+    {
+      fprintf (stderr, "unsupported snapshot file: %u columns\n", header.columns);
+      return 1;
+    }
+  std::vector<std::string> groups;
+  for (uint32_t g = 0; g < header.groups; g++)
+    {
+      uint32_t length;
+      if (fread (&length, sizeof (length), 1, file) != 1)
+        {
+          fprintf (stderr, "truncated snapshot file\n");
+          return 1;
+        }
+      std::string name (length, ' ');
+      if (length != 0 && fread (&name[0], 1, length, file) != length)
+        {
+          fprintf (stderr, "truncated snapshot file\n");
+          return 1;
+        }
+      groups.push_back (name);
+    }
+
+  printf ("time,group,metric,count,mean,p50,p90,p99,max\n");
+  EchoStatsBlockHeader block;
+  std::vector<double> columns[ECHO_STATS_COLUMNS];
+  while (fread (&block, sizeof (block), 1, file) == 1)
+    {
+      for (uint32_t c = 0; c < ECHO_STATS_COLUMNS; c++)
+        {
+          columns[c].resize (block.rows);
+          if (block.rows != 0 && fread (&columns[c][0], sizeof (double), block.rows, file) != block.rows)
+            {
+              fprintf (stderr, "truncated snapshot file\n");
+              return 1;
+            }
+        }
+      for (uint32_t r = 0; r < block.rows; r++)
+        {
+          uint32_t group = (uint32_t) columns[ECHO_STATS_GROUP][r];
+          uint32_t metric = (uint32_t) columns[ECHO_STATS_METRIC][r];
+          printf ("%.6f,%s,%s,%.0f,%.9f,%.9f,%.9f,%.9f,%.9f\n", columns[ECHO_STATS_TIME][r],
+                  group < groups.size () ? groups[group].c_str () : "unknown",
+                  metric <= ECHO_STATS_SOJOURN ? metricNames[metric] : "unknown",
+                  columns[ECHO_STATS_COUNT][r], columns[ECHO_STATS_MEAN][r],
+                  columns[ECHO_STATS_P50][r], columns[ECHO_STATS_P90][r],
+                  columns[ECHO_STATS_P99][r], columns[ECHO_STATS_MAX][r]);
+        }
+    }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  double interval = 0.0;
+  int opt;
+  while ((opt = getopt (argc, argv, "t:h")) != -1)
+    {
+      switch (opt)
+        {
+        case 't': interval = atof (optarg); break;
+        default:
+          fprintf (stderr, "usage: %s [-t interval s] trace-file\n", argv[0]);
+          return 1;
+        }
+    }
+  if (optind >= argc)
+    {
+      fprintf (stderr, "usage: %s [-t interval s] trace-file\n", argv[0]);
+      return 1;
+    }
+
+  FILE *file = fopen (argv[optind], "rb");
+  if (file == 0)
+    {
+      perror (argv[optind]);
+      return 1;
+    }
+  EchoTraceFileHeader header;
+  memset (&header, 0, sizeof (header));
+  if (fread (&header, sizeof (header), 1, file) == 1 &&
+      memcmp (header.magic, ECHO_STATS_MAGIC, sizeof (header.magic)) == 0)
+    {
+      EchoStatsFileHeader statsHeader;
+      memcpy (&statsHeader, &header, sizeof (statsHeader));
+      int status = DecodeStats (file, statsHeader);
+      fclose (file);
+      return status;
+    }
+  if (memcmp (header.magic, ECHO_TRACE_MAGIC, sizeof (header.magic)) != 0 ||
+      header.recordSize != sizeof (EchoTraceRecord))
+    {
+      fprintf (stderr, "%s is not an echo trace file\n", argv[optind]);
+      return 1;
+    }
+
+  // (node, seq) -> send time of the outstanding requests
+  std::map<std::pair<uint32_t, uint32_t>, int64_t> outstanding;
+  // (interval, node) -> events
+  std::map<std::pair<int64_t, uint32_t>, Bin> bins;
+
+  if (interval == 0.0)
+    {
+      printf ("time,event,node,peer,size,seq\n");
+    }
+  EchoTraceRecord r;
+  while (fread (&r, sizeof (r), 1, file) == 1)
+    {
+      if (interval == 0.0)
+        {
+          printf ("%.9f,%s,%u,%u,%u,%u\n", r.time / 1e9, EventName (r.type),
+                  r.node, r.peer, r.size, r.seq);
+          continue;
+        }
+      if (r.type > ECHO_TRACE_SERVER_DROP)
+        {
+          continue;
+        }
+      Bin &bin = bins[std::make_pair ((int64_t) (r.time / 1e9 / interval), r.node)];
+      bin.count[r.type]++;
+      if (r.type == ECHO_TRACE_CLIENT_TX)
+        {
+          outstanding[std::make_pair (r.node, r.seq)] = r.time;
+        }
+      else if (r.type == ECHO_TRACE_CLIENT_RX)
+        {
+          std::map<std::pair<uint32_t, uint32_t>, int64_t>::iterator it =
+            outstanding.find (std::make_pair (r.node, r.seq));
+          if (it != outstanding.end ())
+            {
+              bin.rttSum += (r.time - it->second) / 1e9;
+              bin.rttCount++;
+              outstanding.erase (it);
+            }
+        }
+    }
+  fclose (file);
+
+  if (interval != 0.0)
+    {
+      printf ("time,node,client_tx,client_rx,server_rx,server_tx,server_drop,mean_rtt\n");
+      for (std::map<std::pair<int64_t, uint32_t>, Bin>::const_iterator it = bins.begin ();
+           it != bins.end (); ++it)
+        {
+          const Bin &bin = it->second;
+          printf ("%.6f,%u,%lu,%lu,%lu,%lu,%lu,%.9f\n", it->first.first * interval, it->first.second,
+                  (unsigned long) bin.count[ECHO_TRACE_CLIENT_TX], (unsigned long) bin.count[ECHO_TRACE_CLIENT_RX],
+                  (unsigned long) bin.count[ECHO_TRACE_SERVER_RX], (unsigned long) bin.count[ECHO_TRACE_SERVER_TX],
+                  (unsigned long) bin.count[ECHO_TRACE_SERVER_DROP],
+                  bin.rttCount ? bin.rttSum / bin.rttCount : 0.0);
+        }
+    }
+  return 0;
+}
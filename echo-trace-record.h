@@ -0,0 +1,69 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_TRACE_RECORD_H
+#define ECHO_TRACE_RECORD_H
+
+#include <stdint.h>
+
+/**
+ * \brief the binary echo trace file format, shared by EchoTrace and the
+ * offline decoder (echo-trace-decode.cc), which does not depend on ns-3.
+ *
+ * A file is an EchoTraceFileHeader followed by EchoTraceRecords, both in
+ * the byte order of the host which wrote it.
+ */
+
+#define ECHO_TRACE_MAGIC "ECHOTRC1" //!< first 8 bytes of a trace file
+
+/**
+ * \brief the echo trace event types
+ */
+enum EchoTraceEvent {
+  ECHO_TRACE_CLIENT_TX = 1, //!< a client sent a request
+  ECHO_TRACE_CLIENT_RX = 2, //!< a client received a reply
+  ECHO_TRACE_SERVER_RX = 3, //!< a server buffered a request
+  ECHO_TRACE_SERVER_TX = 4, //!< a server sent a reply
+  ECHO_TRACE_SERVER_DROP = 5, //!< a server dropped a request, its buffer being full
+};
+
+/**
+ * \brief the trace file header
+ */
+struct EchoTraceFileHeader
+{
+  char magic[8]; //!< ECHO_TRACE_MAGIC
+  uint32_t recordSize; //!< sizeof (EchoTraceRecord)
+  uint32_t reserved; //!< zero
+};
+
+/**
+ * \brief one traced event (24 bytes)
+ */
+struct EchoTraceRecord
+{
+  int64_t time; //!< simulation time (time steps, ns by default)
+  uint32_t seq; //!< CommHeader sequence number
+  uint32_t node; //!< id of the node the event happened on
+  uint32_t peer; //!< peer index (server) or 0 (client)
+  uint16_t size; //!< packet size in bytes
+  uint8_t type; //!< EchoTraceEvent
+  uint8_t reserved; //!< zero
+};
+
+#endif /* ECHO_TRACE_RECORD_H */
@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+
+#include "ns3/log.h"
+#include "echo-trace.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EchoTrace");
+
+bool EchoTrace::m_enabled = false;
+FILE *EchoTrace::m_file = 0;
+std::vector<EchoTraceRecord> EchoTrace::m_records;
+uint32_t EchoTrace::m_next = 0;
+Time EchoTrace::m_flushInterval;
+EventId EchoTrace::m_flushEvent;
+
+bool
+EchoTrace::Enable (std::string filename, uint32_t capacity, Time flushInterval)
+{
+  NS_LOG_FUNCTION (filename << capacity << flushInterval);
+
+  Disable ();
+  m_file = fopen (filename.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_LOG_WARN ("Cannot open the echo trace file " << filename);
+      return false;
+    }
+
+  EchoTraceFileHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, ECHO_TRACE_MAGIC, sizeof (header.magic));
+  header.recordSize = sizeof (EchoTraceRecord);
+  fwrite (&header, sizeof (header), 1, m_file);
+
+  m_records.resize (capacity == 0 ? 1 : capacity);
+  m_next = 0;
+  m_flushInterval = flushInterval;
+  if (!m_flushInterval.IsZero ())
+    {
+      m_flushEvent = Simulator::Schedule (m_flushInterval, &EchoTrace::PeriodicFlush);
+    }
+  // the simulator may be destroyed without Disable being called
+  Simulator::ScheduleDestroy (&EchoTrace::Disable);
+  m_enabled = true;
+  return true;
+}
+
+void
+EchoTrace::Disable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  if (m_file == 0)
+    {
+      return;
+    }
+  Flush ();
+  fclose (m_file);
+  m_file = 0;
+  m_enabled = false;
+  Simulator::Cancel (m_flushEvent);
+  std::vector<EchoTraceRecord> ().swap (m_records);
+}
+
+void
+EchoTrace::Flush (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  if (m_file != 0 && m_next != 0)
+    {
+      fwrite (&m_records[0], sizeof (EchoTraceRecord), m_next, m_file);
+      fflush (m_file);
+    }
+  m_next = 0;
+}
+
+void
+EchoTrace::PeriodicFlush (void)
+{
+  Flush ();
+  m_flushEvent = Simulator::Schedule (m_flushInterval, &EchoTrace::PeriodicFlush);
+}
+
+} // namespace ns3
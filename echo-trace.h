@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ECHO_TRACE_H
+#define ECHO_TRACE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include "echo-trace-record.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup udpecho
+ * \brief a binary per-packet event tracer for the echo applications.
+ *
+ * The events are stored as fixed size records in a ring buffer, which is
+ * written to the trace file when it is full, periodically and when the
+ * simulation is destroyed. Unlike NS_LOG_INFO nothing is formatted, so
+ * tracing large runs is affordable; when the tracer is disabled an event
+ * costs one test of a global flag. Use echo-trace-decode to turn a file
+ * in to CSV or per-interval timelines.
+ */
+class EchoTrace
+{
+public:
+  /**
+   * \brief start tracing
+   * \param filename the trace file
+   * \param capacity the ring buffer size in records
+   * \param flushInterval the period of the flushes, zero to flush only
+   * when the ring buffer is full
+   * \return false if the file could not be opened
+   */
+  static bool Enable (std::string filename, uint32_t capacity = 65536,
+                      Time flushInterval = Seconds (1.0));
+
+  /**
+   * \brief flush the buffered records and stop tracing
+   */
+  static void Disable (void);
+
+  /**
+   * \brief write the buffered records to the trace file
+   */
+  static void Flush (void);
+
+  /**
+   * \return true if tracing is enabled
+   */
+  static bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+
+  /**
+   * \brief record an event, use ECHO_TRACE instead
+   * \param type the EchoTraceEvent
+   * \param node the node id
+   * \param peer the peer index
+   * \param size the packet size
+   * \param seq the sequence number
+   */
+  static void Record (uint8_t type, uint32_t node, uint32_t peer, uint32_t size, uint32_t seq)
+  {
+    EchoTraceRecord &r = m_records[m_next];
+    r.time = Simulator::Now ().GetTimeStep ();
+    r.seq = seq;
+    r.node = node;
+    r.peer = peer;
+    r.size = size > 0xffff ? 0xffff : size;
+    r.type = type;
+    r.reserved = 0;
+    if (++m_next == m_records.size ())
+      {
+        Flush ();
+      }
+  }
+
+private:
+  /**
+   * \brief flush and reschedule
+   */
+  static void PeriodicFlush (void);
+
+  static bool m_enabled; //!< tracing is enabled
+  static FILE *m_file; //!< the trace file
+  static std::vector<EchoTraceRecord> m_records; //!< the ring buffer
+  static uint32_t m_next; //!< next free record
+  static Time m_flushInterval; //!< flush period
+  static EventId m_flushEvent; //!< next periodic flush
+};
+
+} // namespace ns3
+
+/**
+ * \brief record an echo trace event; the arguments are not evaluated when
+ * tracing is disabled
+ */
+#define ECHO_TRACE(type, node, peer, size, seq)                         \
+  do                                                                    \
+    {                                                                   \
+      if (ns3::EchoTrace::IsEnabled ())                                 \
+        {                                                               \
+          ns3::EchoTrace::Record (type, node, peer, size, seq);         \
+        }                                                               \
+    }                                                                   \
+  while (false)
+
+#endif /* ECHO_TRACE_H */
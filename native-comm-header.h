@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef NATIVE_COMM_HEADER_H
+#define NATIVE_COMM_HEADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+namespace native {
+
+/**
+ * \brief the CommHeader wire format, for the native (non ns-3) tools.
+ *
+ * ns-3 Buffer::Iterator::WriteU32 writes little endian, hence the
+ * explicit byte order below. The layout must follow CommHeader::Serialize.
+ */
+struct CommHeader
+{
+  enum PacketType {
+    REQ_PACKET = 0x01,//!<request packet
+    REP_PACKET = 0x02,//!<reply pacekt
+  };
+
+  enum PacketStaus {
+    PACKET_ANALYZED = 0x01,//!<all packets still to be analyzed by an SoR
+    PACKET_NOTANALYZED = 0x00,//!<all analyzed packets by an SoR has this tag
+  };
+
+  static const size_t SIZE = 23; //!< serialized size in bytes
+
+  uint64_t sentTime; //!< time the request was generated (ns)
+  uint8_t packetType; //!< request or reply
+  uint8_t packetAnalyzed; //!< analyzed by an SoR
+  uint8_t trafficClass; //!< the traffic class, 0 being the highest priority
+  uint32_t seq; //!< sequence number given by the client
+  uint32_t key; //!< key of the requested object, 0 being no key
+  uint16_t fragmentIndex; //!< index of the reply fragment
+  uint16_t fragmentCount; //!< number of fragments of the reply
+
+  /**
+   * \brief read the header from the start of a datagram
+   * \param buf the datagram
+   * \param len the datagram length
+   * \return false if the datagram is shorter than the header
+   */
+  bool Deserialize (const uint8_t *buf, size_t len)
+  {
+    if (len < SIZE)
+      {
+        return false;
+      }
+    sentTime = 0;
+    for (int i = 7; i >= 0; i--)
+      {
+        sentTime = (sentTime << 8) | buf[i];
+      }
+    packetType = buf[8];
+    packetAnalyzed = buf[9];
+    trafficClass = buf[10];
+    seq = (uint32_t) buf[11] | ((uint32_t) buf[12] << 8) |
+          ((uint32_t) buf[13] << 16) | ((uint32_t) buf[14] << 24);
+    key = (uint32_t) buf[15] | ((uint32_t) buf[16] << 8) |
+          ((uint32_t) buf[17] << 16) | ((uint32_t) buf[18] << 24);
+    fragmentIndex = (uint16_t) (buf[19] | (buf[20] << 8));
+    fragmentCount = (uint16_t) (buf[21] | (buf[22] << 8));
+    return true;
+  }
+
+  /**
+   * \brief write the header at the start of a datagram
+   * \param buf the datagram, at least SIZE bytes long
+   */
+  void Serialize (uint8_t *buf) const
+  {
+    for (int i = 0; i < 8; i++)
+      {
+        buf[i] = (sentTime >> (8 * i)) & 0xff;
+      }
+    buf[8] = packetType;
+    buf[9] = packetAnalyzed;
+    buf[10] = trafficClass;
+    buf[11] = seq & 0xff;
+    buf[12] = (seq >> 8) & 0xff;
+    buf[13] = (seq >> 16) & 0xff;
+    buf[14] = (seq >> 24) & 0xff;
+    buf[15] = key & 0xff;
+    buf[16] = (key >> 8) & 0xff;
+    buf[17] = (key >> 16) & 0xff;
+    buf[18] = (key >> 24) & 0xff;
+    buf[19] = fragmentIndex & 0xff;
+    buf[20] = (fragmentIndex >> 8) & 0xff;
+    buf[21] = fragmentCount & 0xff;
+    buf[22] = (fragmentCount >> 8) & 0xff;
+  }
+
+  /**
+   * \brief turn a request, in place, in to its reply as UdpEchoServer::Reply does
+   * \param buf the datagram holding the request
+   */
+  static void MakeReply (uint8_t *buf)
+  {
+    buf[8] = REP_PACKET;
+    buf[9] = PACKET_ANALYZED;
+  }
+};
+
+/**
+ * \brief get the monotonic clock
+ * \return the time in nanoseconds
+ */
+inline uint64_t
+NowNs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+} // namespace native
+
+#endif /* NATIVE_COMM_HEADER_H */
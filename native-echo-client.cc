@@ -0,0 +1,563 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Native Linux counterpart of UdpEchoClient: an open loop load generator
+ * sending CommHeader requests with Poisson or constant inter-send times.
+ * Every thread drives many flows (connected sockets) and paces them with
+ * a timerfd or by busy polling the clock; the requests which are due
+ * together leave in one sendmmsg.
+ *
+ * The CLOCK_MONOTONIC time (ns) is written in to the CommHeader right
+ * before the send and the server echoes it back, so the RTT does not include the
+ * scheduling jitter of the generator. That jitter (actual minus intended
+ * send time) is recorded in a separate histogram.
+ *
+ * Build: g++ -O2 -pthread -o native-echo-client native-echo-client.cc
+ * Run:   ./native-echo-client -a 127.0.0.1 -p 9000 -r 100000 -t 2 -f 16 -d 10
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native-comm-header.h"
+
+namespace native {
+
+static std::atomic<bool> g_stop (false);
+
+/**
+ * \brief load generator configuration
+ */
+struct ClientOptions
+{
+  ClientOptions () : address ("127.0.0.1"), port (9), rate (10000.0), threads (1),
+                     flows (1), duration (10.0), size (100), poisson (true),
+                     spin (false), trafficClass (0), ioBatch (64), seed (1) {}
+  std::string address; //!< server address
+  uint16_t port; //!< server port
+  double rate; //!< total request rate (requests per second)
+  uint32_t threads; //!< number of sending threads
+  uint32_t flows; //!< sockets per thread
+  double duration; //!< sending time (s)
+  uint32_t size; //!< request size in bytes
+  bool poisson; //!< Poisson (true) or constant inter-send times
+  bool spin; //!< busy poll the clock instead of sleeping on a timerfd
+  uint8_t trafficClass; //!< traffic class of the requests
+  uint32_t ioBatch; //!< maximum number of datagrams per sendmmsg/recvmmsg
+  uint64_t seed; //!< seed of the inter-send time generator
+};
+
+/**
+ * \brief a log-linear latency histogram (32 sub-buckets per power of two,
+ * i.e., about 3% relative error) that can be merged
+ */
+class Histogram
+{
+public:
+  static const uint32_t SUB_BITS = 5; //!< log2 of the sub-buckets per power of two
+  static const uint32_t SUB = 1 << SUB_BITS; //!< sub-buckets per power of two
+  static const uint32_t BUCKETS = (64 - SUB_BITS + 1) * SUB; //!< number of buckets
+
+  Histogram () : m_counts (BUCKETS, 0), m_count (0), m_sum (0), m_max (0) {}
+
+  /**
+   * \brief add a sample
+   * \param ns the sample in nanoseconds
+   */
+  void Record (uint64_t ns)
+  {
+    m_counts[Index (ns)]++;
+    m_count++;
+    m_sum += ns;
+    m_max = std::max (m_max, ns);
+  }
+
+  /**
+   * \brief add the samples of another histogram
+   */
+  void Merge (const Histogram &other)
+  {
+    for (uint32_t i = 0; i < BUCKETS; i++)
+      {
+        m_counts[i] += other.m_counts[i];
+      }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max (m_max, other.m_max);
+  }
+
+  /**
+   * \brief get a quantile
+   * \param q the quantile (0 to 1)
+   * \return the upper bound of the bucket holding the quantile (ns)
+   */
+  uint64_t Quantile (double q) const
+  {
+    uint64_t rank = (uint64_t) std::ceil (q * m_count);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++)
+      {
+        seen += m_counts[i];
+        if (seen >= rank && seen != 0)
+          {
+            return std::min (Upper (i), m_max);
+          }
+      }
+    return m_max;
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  double GetMean (void) const
+  {
+    return m_count ? (double) m_sum / m_count : 0.0;
+  }
+
+private:
+  static uint32_t Index (uint64_t v)
+  {
+    if (v < SUB)
+      {
+        return v;
+      }
+    uint32_t msb = 63 - __builtin_clzll (v);
+    uint32_t shift = msb - SUB_BITS;
+    return (shift + 1) * SUB + ((v >> shift) & (SUB - 1));
+  }
+
+  static uint64_t Upper (uint32_t i)
+  {
+    if (i < SUB)
+      {
+        return i;
+      }
+    uint32_t shift = i / SUB - 1;
+    return (((uint64_t) (SUB + i % SUB) + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> m_counts; //!< samples per bucket
+  uint64_t m_count; //!< number of samples
+  uint64_t m_sum; //!< sum of the samples
+  uint64_t m_max; //!< largest sample
+};
+
+/**
+ * \brief a sending thread with its flows
+ */
+class LoadThread
+{
+public:
+  LoadThread (const ClientOptions &options, uint32_t id)
+    : m_options (options),
+      m_id (id),
+      m_rng (options.seed * 7919 + id),
+      m_sent (0),
+      m_received (0),
+      m_timerFd (-1),
+      m_msgs (options.ioBatch),
+      m_iovs (options.ioBatch),
+      m_buffers (options.ioBatch * Size ())
+  {
+  }
+
+  ~LoadThread ()
+  {
+    for (size_t i = 0; i < m_fds.size (); i++)
+      {
+        close (m_fds[i]);
+      }
+    if (m_timerFd >= 0)
+      {
+        close (m_timerFd);
+      }
+  }
+
+  /**
+   * \brief open and connect the flows
+   * \return false on failure
+   */
+  bool Open (void)
+  {
+    struct sockaddr_storage server;
+    socklen_t serverLen;
+    memset (&server, 0, sizeof (server));
+    struct sockaddr_in *in4 = (struct sockaddr_in *) &server;
+    struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) &server;
+    if (inet_pton (AF_INET, m_options.address.c_str (), &in4->sin_addr) == 1)
+      {
+        in4->sin_family = AF_INET;
+        in4->sin_port = htons (m_options.port);
+        serverLen = sizeof (*in4);
+      }
+    else if (inet_pton (AF_INET6, m_options.address.c_str (), &in6->sin6_addr) == 1)
+      {
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons (m_options.port);
+        serverLen = sizeof (*in6);
+      }
+    else
+      {
+        fprintf (stderr, "bad address %s\n", m_options.address.c_str ());
+        return false;
+      }
+
+    for (uint32_t i = 0; i < m_options.flows; i++)
+      {
+        int fd = socket (server.ss_family, SOCK_DGRAM, 0);
+        if (fd < 0 || connect (fd, (struct sockaddr *) &server, serverLen) < 0)
+          {
+            perror ("socket/connect");
+            return false;
+          }
+        int buf = 1024 * 1024;
+        setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof (buf));
+        m_fds.push_back (fd);
+      }
+
+    if (!m_options.spin)
+      {
+        m_timerFd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (m_timerFd < 0)
+          {
+            perror ("timerfd_create");
+            return false;
+          }
+      }
+    return true;
+  }
+
+  /**
+   * \brief send for the configured duration, then collect the late replies
+   */
+  void Run (void)
+  {
+    double rate = m_options.rate / m_options.threads;
+    std::exponential_distribution<double> poisson (rate);
+    uint64_t start = NowNs ();
+    uint64_t end = start + (uint64_t) (m_options.duration * 1e9);
+    uint64_t drainEnd = end + 1000000000ULL;
+    // stagger the threads' constant schedules
+    double next = start + 1e9 / rate * m_id / m_options.threads;
+    uint32_t flow = 0;
+
+    while (!g_stop)
+      {
+        uint64_t now = NowNs ();
+        if (now >= drainEnd)
+          {
+            break;
+          }
+
+        // send every request which is due, in one sendmmsg per flow run
+        uint32_t due = 0;
+        while (now < end && next <= now && due < m_options.ioBatch)
+          {
+            m_intended[due] = (uint64_t) next;
+            due++;
+            next += m_options.poisson ? poisson (m_rng) * 1e9 : 1e9 / rate;
+          }
+        if (due != 0)
+          {
+            Send (due, flow);
+            flow = (flow + 1) % m_fds.size ();
+          }
+
+        uint32_t received = HandleRead ();
+        if (due == 0 && received == 0)
+          {
+            Wait (now < end ? (uint64_t) next : drainEnd);
+          }
+      }
+  }
+
+  const Histogram & GetRtt (void) const
+  {
+    return m_rtt;
+  }
+
+  const Histogram & GetLag (void) const
+  {
+    return m_lag;
+  }
+
+  uint64_t GetSent (void) const
+  {
+    return m_sent;
+  }
+
+  uint64_t GetReceived (void) const
+  {
+    return m_received;
+  }
+
+private:
+  /**
+   * \brief get the request size (a CommHeader at least)
+   */
+  uint32_t Size (void) const
+  {
+    return std::max<uint32_t> (m_options.size, CommHeader::SIZE);
+  }
+
+  /**
+   * \brief send a run of requests on one flow
+   * \param n the number of requests
+   * \param flow the flow index
+   */
+  void Send (uint32_t n, uint32_t flow)
+  {
+    uint32_t size = Size ();
+    uint64_t now = NowNs ();
+    CommHeader hdr;
+    hdr.sentTime = now;
+    hdr.packetType = CommHeader::REQ_PACKET;
+    hdr.packetAnalyzed = CommHeader::PACKET_NOTANALYZED;
+    hdr.trafficClass = m_options.trafficClass;
+    hdr.key = 0;
+    hdr.fragmentIndex = 0;
+    hdr.fragmentCount = 1;
+    for (uint32_t i = 0; i < n; i++)
+      {
+        uint8_t *buf = &m_buffers[i * size];
+        hdr.seq = (uint32_t) (m_sent + i);
+        hdr.Serialize (buf);
+        m_iovs[i].iov_base = buf;
+        m_iovs[i].iov_len = size;
+        memset (&m_msgs[i].msg_hdr, 0, sizeof (m_msgs[i].msg_hdr));
+        m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+        m_lag.Record (now > m_intended[i] ? now - m_intended[i] : 0);
+      }
+    int r = sendmmsg (m_fds[flow], &m_msgs[0], n, 0);
+    if (r > 0)
+      {
+        m_sent += r;
+      }
+  }
+
+  /**
+   * \brief receive the pending replies of all the flows
+   * \return the number of replies
+   */
+  uint32_t HandleRead (void)
+  {
+    uint32_t total = 0;
+    for (size_t f = 0; f < m_fds.size (); f++)
+      {
+        for (uint32_t i = 0; i < m_options.ioBatch; i++)
+          {
+            m_iovs[i].iov_base = &m_buffers[i * Size ()];
+            m_iovs[i].iov_len = Size ();
+            memset (&m_msgs[i].msg_hdr, 0, sizeof (m_msgs[i].msg_hdr));
+            m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+            m_msgs[i].msg_hdr.msg_iovlen = 1;
+          }
+        int r = recvmmsg (m_fds[f], &m_msgs[0], m_options.ioBatch, MSG_DONTWAIT, 0);
+        if (r <= 0)
+          {
+            continue;
+          }
+        uint64_t now = NowNs ();
+        for (int i = 0; i < r; i++)
+          {
+            const uint8_t *buf = &m_buffers[i * Size ()];
+            CommHeader hdr;
+            if (!hdr.Deserialize (buf, m_msgs[i].msg_len) ||
+                hdr.packetType != CommHeader::REP_PACKET)
+              {
+                continue;
+              }
+            m_rtt.Record (now - hdr.sentTime);
+            m_received++;
+          }
+        total += r;
+      }
+    return total;
+  }
+
+  /**
+   * \brief wait for the next send time or a reply
+   * \param deadline the next send time
+   */
+  void Wait (uint64_t deadline)
+  {
+    uint64_t now = NowNs ();
+    if (m_options.spin || deadline <= now + 20000)
+      {
+        // busy poll: the loop checks the clock and the sockets again
+        return;
+      }
+    // wake up slightly early and spin the rest, as the timer slack would
+    // otherwise show up as send lag
+    struct itimerspec its;
+    memset (&its, 0, sizeof (its));
+    uint64_t wake = deadline - 10000;
+    its.it_value.tv_sec = wake / 1000000000ULL;
+    its.it_value.tv_nsec = wake % 1000000000ULL;
+    timerfd_settime (m_timerFd, TFD_TIMER_ABSTIME, &its, 0);
+
+    std::vector<struct pollfd> pfds (m_fds.size () + 1);
+    for (size_t i = 0; i < m_fds.size (); i++)
+      {
+        pfds[i].fd = m_fds[i];
+        pfds[i].events = POLLIN;
+      }
+    pfds.back ().fd = m_timerFd;
+    pfds.back ().events = POLLIN;
+    poll (&pfds[0], pfds.size (), 100);
+    uint64_t expirations;
+    if (read (m_timerFd, &expirations, sizeof (expirations)) < 0)
+      {
+        // not expired yet, woken up by a reply
+      }
+  }
+
+  ClientOptions m_options; //!< configuration
+  uint32_t m_id; //!< thread index
+  std::mt19937_64 m_rng; //!< inter-send time generator
+  uint64_t m_sent; //!< requests sent
+  uint64_t m_received; //!< replies received
+  int m_timerFd; //!< pacing timer
+  std::vector<int> m_fds; //!< the flows
+  std::vector<struct mmsghdr> m_msgs; //!< sendmmsg/recvmmsg vector
+  std::vector<struct iovec> m_iovs; //!< io vectors of m_msgs
+  std::vector<uint8_t> m_buffers; //!< datagram buffers
+  uint64_t m_intended[1024]; //!< intended send times of the due requests
+  Histogram m_rtt; //!< round trip times
+  Histogram m_lag; //!< send time minus intended send time
+};
+
+/**
+ * \brief print a histogram summary
+ */
+static void
+PrintHistogram (const char *what, const Histogram &h)
+{
+  printf ("%s (us): mean: %.1f p50: %.1f p90: %.1f p99: %.1f p99.9: %.1f max: %.1f\n",
+          what, h.GetMean () / 1e3, h.Quantile (0.50) / 1e3, h.Quantile (0.90) / 1e3,
+          h.Quantile (0.99) / 1e3, h.Quantile (0.999) / 1e3, h.Quantile (1.0) / 1e3);
+}
+
+} // namespace native
+
+static void
+HandleSignal (int)
+{
+  native::g_stop = true;
+}
+
+static void
+Usage (const char *name)
+{
+  fprintf (stderr,
+           "usage: %s [-a server address] [-p port] [-r rate rps] [-t threads] [-f flows per thread]\n"
+           "          [-d duration s] [-s size] [-c traffic class] [-C] [-S] [-b io batch] [-x seed]\n"
+           "  -C: constant inter-send times (default: Poisson)\n"
+           "  -S: busy poll the clock (default: sleep on a timerfd)\n", name);
+}
+
+int
+main (int argc, char *argv[])
+{
+  native::ClientOptions options;
+  int opt;
+  while ((opt = getopt (argc, argv, "a:p:r:t:f:d:s:c:CSb:x:h")) != -1)
+    {
+      switch (opt)
+        {
+        case 'a': options.address = optarg; break;
+        case 'p': options.port = atoi (optarg); break;
+        case 'r': options.rate = atof (optarg); break;
+        case 't': options.threads = std::max (1, atoi (optarg)); break;
+        case 'f': options.flows = std::max (1, atoi (optarg)); break;
+        case 'd': options.duration = atof (optarg); break;
+        case 's': options.size = atoi (optarg); break;
+        case 'c': options.trafficClass = atoi (optarg); break;
+        case 'C': options.poisson = false; break;
+        case 'S': options.spin = true; break;
+        case 'b': options.ioBatch = std::min (1024, std::max (1, atoi (optarg))); break;
+        case 'x': options.seed = strtoull (optarg, 0, 10); break;
+        default: Usage (argv[0]); return 1;
+        }
+    }
+
+  signal (SIGINT, HandleSignal);
+  signal (SIGTERM, HandleSignal);
+
+  std::vector<native::LoadThread *> loads;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      loads.push_back (new native::LoadThread (options, i));
+      if (!loads.back ()->Open ())
+        {
+          return 1;
+        }
+    }
+  uint64_t start = native::NowNs ();
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      threads.push_back (std::thread (&native::LoadThread::Run, loads[i]));
+    }
+
+  // merge the per-thread histograms
+  native::Histogram rtt, lag;
+  uint64_t sent = 0, received = 0;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      threads[i].join ();
+      rtt.Merge (loads[i]->GetRtt ());
+      lag.Merge (loads[i]->GetLag ());
+      sent += loads[i]->GetSent ();
+      received += loads[i]->GetReceived ();
+      delete loads[i];
+    }
+  double elapsed = std::min ((native::NowNs () - start) / 1e9, options.duration);
+  printf ("sent: %lu received: %lu lost: %lu send rate: %.1f rps\n",
+          (unsigned long) sent, (unsigned long) received,
+          (unsigned long) (sent - std::min (sent, received)), elapsed > 0 ? sent / elapsed : 0.0);
+  native::PrintHistogram ("rtt", rtt);
+  native::PrintHistogram ("send lag", lag);
+  return 0;
+}
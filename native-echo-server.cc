@@ -0,0 +1,964 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Native Linux counterpart of UdpEchoServer. It speaks the CommHeader wire
+ * format and applies the same service model (a FIFO buffer served in
+ * batches with exponential service times, mue = service rate / mean packet
+ * size) on real UDP sockets, batching the receives and the sends with
+ * recvmmsg/sendmmsg. It is used to calibrate the simulated service rates
+ * against measured ones.
+ *
+ * With -u, the sockets are driven by io_uring instead (see UringEchoServer).
+ *
+ * With -t N, N workers are started, each with its own SO_REUSEPORT socket,
+ * pinned to a core and serving its own buffer (a single-producer/single-
+ * consumer ring). The workers only write their own counters; the main
+ * thread aggregates them for the statistics print.
+ *
+ * Build: g++ -O2 -pthread -o native-echo-server native-echo-server.cc
+ * Run:   ./native-echo-server -p 9000 -r 10e6 -t 4
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "native-comm-header.h"
+#include "native-spsc-ring.h"
+#include "native-uring.h"
+
+namespace native {
+
+static std::atomic<bool> g_stop (false);
+
+/**
+ * \brief server configuration
+ */
+struct ServerOptions
+{
+  ServerOptions () : port (9), serviceRate (10000000.0), batchSize (1),
+                     batchOverhead (0.0), ioBatch (64), queueSize (8192),
+                     statInterval (1.0), seed (1), threads (1), uring (false) {}
+  uint16_t port; //!< port on which we listen for incoming packets
+  double serviceRate; //!< service rate of the server (bps)
+  uint32_t batchSize; //!< maximum number of requests served per service completion
+  double batchOverhead; //!< fraction of the service time paid once per batch
+  uint32_t ioBatch; //!< maximum number of datagrams per recvmmsg/sendmmsg
+  uint32_t queueSize; //!< server buffer size in packets
+  double statInterval; //!< interval of the statistics print (s)
+  uint64_t seed; //!< seed of the service time generator
+  uint32_t threads; //!< number of workers
+  bool uring; //!< use the io_uring backend instead of recvmmsg/sendmmsg
+};
+
+/**
+ * \brief a server buffer slot. Requests are received straight in to the
+ * slots and replied from them, so the payload is never copied.
+ */
+struct Slot
+{
+  static const size_t SIZE = 2048; //!< maximum datagram size
+  uint8_t data[SIZE]; //!< the datagram
+  uint32_t len; //!< datagram length
+  struct sockaddr_storage peer; //!< the client
+  socklen_t peerLen; //!< length of the client address
+  uint64_t enqueueNs; //!< time the request entered the buffer
+};
+
+/**
+ * \brief counters of a worker. Only the worker writes them, so plain
+ * relaxed loads and stores are enough; the main thread reads them.
+ */
+struct alignas (64) WorkerCounters
+{
+  WorkerCounters () : received (0), bytes (0), sent (0), dropped (0), busyNs (0), sojournNs (0), syscalls (0) {}
+  std::atomic<uint64_t> received; //!< requests received
+  std::atomic<uint64_t> bytes; //!< bytes received
+  std::atomic<uint64_t> sent; //!< replies sent
+  std::atomic<uint64_t> dropped; //!< requests dropped as the buffer was full or truncated
+  std::atomic<uint64_t> busyNs; //!< time the server was busy
+  std::atomic<uint64_t> sojournNs; //!< sum of the sojourn times
+  std::atomic<uint64_t> syscalls; //!< socket and io_uring system calls
+
+  /**
+   * \brief add to a counter owned by the calling worker
+   */
+  static void Add (std::atomic<uint64_t> &counter, uint64_t value)
+  {
+    counter.store (counter.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * \brief a plain copy of the counters, as aggregated by the main thread
+ */
+struct Counters
+{
+  Counters () : received (0), bytes (0), sent (0), dropped (0), busyNs (0), sojournNs (0), syscalls (0) {}
+  uint64_t received; //!< requests received
+  uint64_t bytes; //!< bytes received
+  uint64_t sent; //!< replies sent
+  uint64_t dropped; //!< requests dropped as the buffer was full or truncated
+  uint64_t busyNs; //!< time the server was busy
+  uint64_t sojournNs; //!< sum of the sojourn times
+  uint64_t syscalls; //!< socket and io_uring system calls
+
+  void Add (const WorkerCounters &c)
+  {
+    received += c.received.load (std::memory_order_relaxed);
+    bytes += c.bytes.load (std::memory_order_relaxed);
+    sent += c.sent.load (std::memory_order_relaxed);
+    dropped += c.dropped.load (std::memory_order_relaxed);
+    busyNs += c.busyNs.load (std::memory_order_relaxed);
+    sojournNs += c.sojournNs.load (std::memory_order_relaxed);
+    syscalls += c.syscalls.load (std::memory_order_relaxed);
+  }
+};
+
+/**
+ * \brief the part of a server worker common to the socket backends: the
+ * service model of UdpEchoServer and the statistics
+ */
+class EchoWorker
+{
+public:
+  EchoWorker (const ServerOptions &options, uint32_t id)
+    : m_options (options),
+      m_id (id),
+      m_inService (0),
+      m_busy (false),
+      m_serviceStart (0),
+      m_completionNs (0),
+      m_avgPacketSize (0.0),
+      m_received (0),
+      m_rng (options.seed + id),
+      m_fd (-1)
+  {
+  }
+
+  virtual ~EchoWorker ()
+  {
+    if (m_fd >= 0)
+      {
+        close (m_fd);
+      }
+  }
+
+  /**
+   * \brief open and bind the socket
+   * \return false on failure
+   */
+  virtual bool Open (void)
+  {
+    m_fd = socket (AF_INET6, SOCK_DGRAM, 0);
+    if (m_fd < 0)
+      {
+        perror ("socket");
+        return false;
+      }
+    int off = 0;
+    setsockopt (m_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof (off));
+    int on = 1;
+    if (m_options.threads > 1 && setsockopt (m_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on)) < 0)
+      {
+        perror ("SO_REUSEPORT");
+        return false;
+      }
+    int buf = 4 * 1024 * 1024;
+    setsockopt (m_fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof (buf));
+    setsockopt (m_fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof (buf));
+
+    struct sockaddr_in6 local;
+    memset (&local, 0, sizeof (local));
+    local.sin6_family = AF_INET6;
+    local.sin6_addr = in6addr_any;
+    local.sin6_port = htons (m_options.port);
+    if (bind (m_fd, (struct sockaddr *) &local, sizeof (local)) < 0)
+      {
+        perror ("bind");
+        return false;
+      }
+    return true;
+  }
+
+  /**
+   * \brief serve until SIGINT/SIGTERM
+   */
+  virtual void Run (void) = 0;
+
+  /**
+   * \brief get the counters of the worker
+   */
+  const WorkerCounters & GetCounters (void) const
+  {
+    return m_counters;
+  }
+
+protected:
+  /**
+   * \brief pin the calling thread to the worker's core
+   */
+  void Pin (void)
+  {
+    unsigned cores = std::max (1u, std::thread::hardware_concurrency ());
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (m_id % cores, &set);
+    pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+  }
+
+  /**
+   * \brief get the number of buffered requests not in service
+   */
+  virtual uint32_t Backlog (void) const = 0;
+
+  /**
+   * \brief get the arrival time of a buffered request not in service
+   * \param i the index of the request, less than Backlog ()
+   */
+  virtual uint64_t EnqueueTime (uint32_t i) = 0;
+
+  /**
+   * \brief account for a received request
+   * \param len the request size
+   */
+  void Arrive (uint32_t len)
+  {
+    m_avgPacketSize = ((m_avgPacketSize * m_received) + len) / (m_received + 1);
+    m_received++;
+  }
+
+  /**
+   * \brief take the next batch in to the service, as UdpEchoServer::ScheduleTransmit
+   * \param now the service start time
+   */
+  void ScheduleTransmit (uint64_t now)
+  {
+    uint32_t backlog = Backlog ();
+    if (backlog == 0)
+      {
+        m_busy = false;
+        return;
+      }
+    // The loop may notice a completion late; the batch served from that
+    // instant only holds the requests which had arrived by then.
+    now = std::max (now, EnqueueTime (0));
+    uint32_t n = 1;
+    while (n < std::min (backlog, m_options.batchSize) && EnqueueTime (n) <= now)
+      {
+        n++;
+      }
+    m_inService = n;
+    double mue = m_options.serviceRate / (m_avgPacketSize * 8.0);
+    double batchCost = m_options.batchOverhead + (1.0 - m_options.batchOverhead) * m_inService;
+    std::exponential_distribution<double> service (mue / batchCost);
+    uint64_t serviceNs = (uint64_t) (service (m_rng) * 1e9);
+    m_serviceStart = now;
+    m_completionNs = now + serviceNs;
+    m_busy = true;
+  }
+
+  /**
+   * \brief get how long the worker may block
+   * \param now the current time
+   * \return the time until the service completion (or a stop check)
+   */
+  uint64_t WaitTime (uint64_t now) const
+  {
+    // wake up regularly to notice the stop signal
+    uint64_t deadline = now + 100000000ULL;
+    if (m_busy)
+      {
+        deadline = std::min (deadline, m_completionNs);
+      }
+    return deadline > now ? deadline - now : 0;
+  }
+
+  ServerOptions m_options; //!< configuration
+  uint32_t m_id; //!< worker index
+  uint32_t m_inService; //!< number of requests in service, at the head of the buffer
+  bool m_busy; //!< a batch is being served
+  uint64_t m_serviceStart; //!< start of the current service
+  uint64_t m_completionNs; //!< completion of the current service
+  double m_avgPacketSize; //!< average size of the received packets
+  uint64_t m_received; //!< number of received packets
+  std::mt19937_64 m_rng; //!< service time generator
+  int m_fd; //!< the socket
+  WorkerCounters m_counters; //!< statistics of the worker
+};
+
+/**
+ * \brief a server worker using recvmmsg/sendmmsg: a socket and a ring of
+ * slots served in FIFO order
+ */
+class EchoServer : public EchoWorker
+{
+public:
+  EchoServer (const ServerOptions &options, uint32_t id)
+    : EchoWorker (options, id),
+      m_slots (options.queueSize),
+      m_msgs (options.ioBatch),
+      m_iovs (options.ioBatch)
+  {
+  }
+
+  virtual void Run (void)
+  {
+    if (m_options.threads > 1)
+      {
+        Pin ();
+      }
+
+    while (!g_stop)
+      {
+        if (m_busy && NowNs () >= m_completionNs)
+          {
+            // the next batch starts at the completion instant, not at the
+            // (later) time the loop noticed it, to keep the service rate exact
+            uint64_t completion = m_completionNs;
+            ServiceComplete ();
+            ScheduleTransmit (completion);
+          }
+
+        uint32_t received = HandleRead ();
+        if (!m_busy && Backlog () != 0)
+          {
+            ScheduleTransmit (NowNs ());
+          }
+
+        if (received == 0)
+          {
+            Wait ();
+          }
+      }
+  }
+
+private:
+  virtual uint32_t Backlog (void) const
+  {
+    return m_slots.Size () - m_inService;
+  }
+
+  virtual uint64_t EnqueueTime (uint32_t i)
+  {
+    return m_slots.ReadSlot (m_inService + i).enqueueNs;
+  }
+
+  /**
+   * \brief receive the pending datagrams in to the free slots
+   * \return the number of datagrams received
+   */
+  uint32_t HandleRead (void)
+  {
+    uint32_t free = m_slots.Free ();
+    if (free == 0)
+      {
+        return DropRead ();
+      }
+    uint32_t n = std::min (free, m_options.ioBatch);
+    for (uint32_t i = 0; i < n; i++)
+      {
+        Slot &slot = m_slots.WriteSlot (i);
+        m_iovs[i].iov_base = slot.data;
+        m_iovs[i].iov_len = Slot::SIZE;
+        memset (&m_msgs[i].msg_hdr, 0, sizeof (m_msgs[i].msg_hdr));
+        m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+        m_msgs[i].msg_hdr.msg_name = &slot.peer;
+        m_msgs[i].msg_hdr.msg_namelen = sizeof (slot.peer);
+      }
+    int r = recvmmsg (m_fd, &m_msgs[0], n, MSG_DONTWAIT, 0);
+    WorkerCounters::Add (m_counters.syscalls, 1);
+    if (r <= 0)
+      {
+        return 0;
+      }
+    uint64_t now = NowNs ();
+    uint32_t accepted = 0;
+    uint32_t truncated = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < r; i++)
+      {
+        Slot &slot = m_slots.WriteSlot (accepted);
+        if (m_msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+          {
+            // larger than a slot: echoing the truncated part would be wrong
+            truncated++;
+            continue;
+          }
+        if (m_msgs[i].msg_len < CommHeader::SIZE)
+          {
+            continue;
+          }
+        if (accepted != (uint32_t) i)
+          {
+            // close the gap left by a malformed datagram
+            Slot &src = m_slots.WriteSlot (i);
+            memcpy (slot.data, src.data, m_msgs[i].msg_len);
+            slot.peer = src.peer;
+          }
+        slot.len = m_msgs[i].msg_len;
+        slot.peerLen = m_msgs[i].msg_hdr.msg_namelen;
+        slot.enqueueNs = now;
+        Arrive (slot.len);
+        bytes += slot.len;
+        accepted++;
+      }
+    m_slots.Push (accepted);
+    WorkerCounters::Add (m_counters.received, accepted);
+    WorkerCounters::Add (m_counters.bytes, bytes);
+    WorkerCounters::Add (m_counters.dropped, truncated);
+    return r;
+  }
+
+  /**
+   * \brief drain the socket while the buffer is full
+   * \return the number of dropped datagrams
+   */
+  uint32_t DropRead (void)
+  {
+    uint32_t n = m_options.ioBatch;
+    for (uint32_t i = 0; i < n; i++)
+      {
+        m_iovs[i].iov_base = m_scratch;
+        m_iovs[i].iov_len = sizeof (m_scratch);
+        memset (&m_msgs[i].msg_hdr, 0, sizeof (m_msgs[i].msg_hdr));
+        m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+    int r = recvmmsg (m_fd, &m_msgs[0], n, MSG_DONTWAIT, 0);
+    WorkerCounters::Add (m_counters.syscalls, 1);
+    if (r <= 0)
+      {
+        return 0;
+      }
+    WorkerCounters::Add (m_counters.dropped, r);
+    return r;
+  }
+
+  /**
+   * \brief reply the batch in service back-to-back, as UdpEchoServer::Reply
+   */
+  void ServiceComplete (void)
+  {
+    uint64_t now = m_completionNs;
+    uint64_t sojournNs = 0;
+    uint32_t sentTotal = 0;
+    uint32_t done = 0;
+    while (done < m_inService)
+      {
+        uint32_t n = std::min (m_inService - done, m_options.ioBatch);
+        for (uint32_t i = 0; i < n; i++)
+          {
+            Slot &slot = m_slots.ReadSlot (done + i);
+            CommHeader::MakeReply (slot.data);
+            m_iovs[i].iov_base = slot.data;
+            m_iovs[i].iov_len = slot.len;
+            memset (&m_msgs[i].msg_hdr, 0, sizeof (m_msgs[i].msg_hdr));
+            m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+            m_msgs[i].msg_hdr.msg_iovlen = 1;
+            m_msgs[i].msg_hdr.msg_name = &slot.peer;
+            m_msgs[i].msg_hdr.msg_namelen = slot.peerLen;
+            sojournNs += now - slot.enqueueNs;
+          }
+        uint32_t sent = 0;
+        while (sent < n)
+          {
+            int r = sendmmsg (m_fd, &m_msgs[sent], n - sent, 0);
+            WorkerCounters::Add (m_counters.syscalls, 1);
+            if (r < 0)
+              {
+                if (errno == EINTR)
+                  {
+                    continue;
+                  }
+                perror ("sendmmsg");
+                break;
+              }
+            sent += r;
+          }
+        sentTotal += sent;
+        done += n;
+      }
+    m_slots.Pop (m_inService);
+    m_inService = 0;
+    WorkerCounters::Add (m_counters.sent, sentTotal);
+    WorkerCounters::Add (m_counters.sojournNs, sojournNs);
+    WorkerCounters::Add (m_counters.busyNs, now - m_serviceStart);
+  }
+
+  /**
+   * \brief wait for a datagram or the service completion
+   */
+  void Wait (void)
+  {
+    uint64_t left = WaitTime (NowNs ());
+    if (left < 20000)
+      {
+        // poll() cannot sleep this short accurately, spin instead
+        return;
+      }
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    struct timespec ts;
+    ts.tv_sec = left / 1000000000ULL;
+    ts.tv_nsec = left % 1000000000ULL;
+    ppoll (&pfd, 1, &ts, 0);
+    WorkerCounters::Add (m_counters.syscalls, 1);
+  }
+
+  SpscRing<Slot> m_slots; //!< the server buffer
+  std::vector<struct mmsghdr> m_msgs; //!< recvmmsg/sendmmsg vector
+  std::vector<struct iovec> m_iovs; //!< io vectors of m_msgs
+  uint8_t m_scratch[Slot::SIZE]; //!< sink of the dropped datagrams
+};
+
+/**
+ * \brief a server worker using io_uring. A multishot recvmsg receives the
+ * requests in to buffers provided to the kernel; a reply is made in place
+ * (the CommHeader type is rewritten) and sent from the same buffer, which
+ * is then given back to the kernel. The payload is never copied, and the
+ * whole batch of replies is submitted with a single system call.
+ */
+class UringEchoServer : public EchoWorker
+{
+public:
+  UringEchoServer (const ServerOptions &options, uint32_t id)
+    : EchoWorker (options, id),
+      m_requests (std::min<uint32_t> (options.queueSize, 32768)),
+      m_recvArmed (false),
+      m_held (0)
+  {
+    m_bufferCount = m_requests.GetCapacity ();
+    m_send.resize (m_bufferCount);
+    memset (&m_recvMsg, 0, sizeof (m_recvMsg));
+    m_recvMsg.msg_namelen = sizeof (struct sockaddr_storage);
+  }
+
+  virtual bool Open (void)
+  {
+    if (!EchoWorker::Open ())
+      {
+        return false;
+      }
+    if (!m_uring.Init (1024))
+      {
+        perror ("io_uring_setup");
+        return false;
+      }
+    int r = m_buffers.Init (m_uring, BUFFER_GROUP, m_bufferCount,
+                            sizeof (struct io_uring_recvmsg_out) + sizeof (struct sockaddr_storage) + Slot::SIZE);
+    if (r < 0)
+      {
+        fprintf (stderr, "IORING_REGISTER_PBUF_RING: %s\n", strerror (-r));
+        return false;
+      }
+    return true;
+  }
+
+  virtual void Run (void)
+  {
+    if (m_options.threads > 1)
+      {
+        Pin ();
+      }
+
+    while (!g_stop)
+      {
+        HandleCompletions ();
+
+        if (m_busy && NowNs () >= m_completionNs)
+          {
+            uint64_t completion = m_completionNs;
+            ServiceComplete ();
+            ScheduleTransmit (completion);
+          }
+        if (!m_busy && Backlog () != 0)
+          {
+            ScheduleTransmit (NowNs ());
+          }
+
+        // the multishot receive stops when the kernel runs out of buffers;
+        // arm it again once some were given back
+        m_buffers.Publish ();
+        if (!m_recvArmed && m_held < m_bufferCount)
+          {
+            ArmRecv ();
+          }
+
+        uint64_t left = WaitTime (NowNs ());
+        bool wait = m_uring.PeekCqe () == 0 && left >= 20000;
+        int r = m_uring.Submit (wait, left);
+        if (r < 0)
+          {
+            fprintf (stderr, "io_uring_enter: %s\n", strerror (-r));
+            return;
+          }
+        WorkerCounters::Add (m_counters.syscalls, 1);
+      }
+  }
+
+private:
+  static const uint16_t BUFFER_GROUP = 1; //!< provided buffer group id
+  static const uint64_t RECV_TAG = 1ULL << 32; //!< user data of the receive
+  static const uint64_t SEND_TAG = 2ULL << 32; //!< user data of a send (| buffer id)
+
+  /**
+   * \brief a buffered request
+   */
+  struct Request
+  {
+    uint16_t bid; //!< the buffer holding the request
+    uint32_t len; //!< payload length
+    uint64_t enqueueNs; //!< time the request entered the buffer
+  };
+
+  /**
+   * \brief the send arguments of a buffer; they have to stay valid
+   * until the send completes
+   */
+  struct SendState
+  {
+    struct msghdr msg; //!< the message
+    struct iovec iov; //!< the payload
+  };
+
+  virtual uint32_t Backlog (void) const
+  {
+    return m_requests.Size () - m_inService;
+  }
+
+  virtual uint64_t EnqueueTime (uint32_t i)
+  {
+    return m_requests.ReadSlot (m_inService + i).enqueueNs;
+  }
+
+  /**
+   * \brief submit the multishot receive
+   */
+  void ArmRecv (void)
+  {
+    struct io_uring_sqe *sqe = m_uring.GetSqe ();
+    if (sqe == 0)
+      {
+        return;
+      }
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = m_fd;
+    sqe->addr = (uint64_t) (uintptr_t) &m_recvMsg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = RECV_TAG;
+    m_recvArmed = true;
+  }
+
+  /**
+   * \brief get the payload of a received buffer
+   */
+  uint8_t * Payload (uint16_t bid)
+  {
+    return m_buffers.Get (bid) + sizeof (struct io_uring_recvmsg_out) +
+           m_recvMsg.msg_namelen + m_recvMsg.msg_controllen;
+  }
+
+  /**
+   * \brief give a buffer back to the kernel
+   */
+  void Recycle (uint16_t bid)
+  {
+    m_buffers.Recycle (bid);
+    m_held--;
+  }
+
+  /**
+   * \brief handle the receive and send completions
+   */
+  void HandleCompletions (void)
+  {
+    uint64_t now = NowNs ();
+    uint32_t accepted = 0;
+    uint64_t bytes = 0;
+    uint32_t dropped = 0;
+    uint32_t sent = 0;
+    struct io_uring_cqe *cqe;
+    while ((cqe = m_uring.PeekCqe ()) != 0)
+      {
+        uint64_t tag = cqe->user_data;
+        int32_t res = cqe->res;
+        uint32_t flags = cqe->flags;
+        m_uring.CqeSeen ();
+
+        if (tag != RECV_TAG)
+          {
+            // a reply left its buffer
+            if (res >= 0)
+              {
+                sent++;
+              }
+            Recycle (tag & 0xffff);
+            continue;
+          }
+
+        if (!(flags & IORING_CQE_F_MORE))
+          {
+            m_recvArmed = false;
+          }
+        if (res < 0 || !(flags & IORING_CQE_F_BUFFER))
+          {
+            continue;
+          }
+        uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        m_held++;
+        struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *) m_buffers.Get (bid);
+        if (out->flags & MSG_TRUNC)
+          {
+            Recycle (bid);
+            dropped++;
+            continue;
+          }
+        if (out->payloadlen < CommHeader::SIZE)
+          {
+            Recycle (bid);
+            continue;
+          }
+        if (m_requests.Free () == 0)
+          {
+            Recycle (bid);
+            dropped++;
+            continue;
+          }
+        Request &request = m_requests.WriteSlot (0);
+        request.bid = bid;
+        request.len = out->payloadlen;
+        request.enqueueNs = now;
+        m_requests.Push (1);
+        Arrive (request.len);
+        bytes += request.len;
+        accepted++;
+      }
+    WorkerCounters::Add (m_counters.received, accepted);
+    WorkerCounters::Add (m_counters.bytes, bytes);
+    WorkerCounters::Add (m_counters.dropped, dropped);
+    WorkerCounters::Add (m_counters.sent, sent);
+  }
+
+  /**
+   * \brief reply the batch in service back-to-back, as UdpEchoServer::Reply
+   */
+  void ServiceComplete (void)
+  {
+    uint64_t now = m_completionNs;
+    uint64_t sojournNs = 0;
+    for (uint32_t i = 0; i < m_inService; i++)
+      {
+        Request &request = m_requests.ReadSlot (i);
+        struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *) m_buffers.Get (request.bid);
+        uint8_t *payload = Payload (request.bid);
+        CommHeader::MakeReply (payload);
+
+        SendState &state = m_send[request.bid];
+        memset (&state.msg, 0, sizeof (state.msg));
+        state.iov.iov_base = payload;
+        state.iov.iov_len = request.len;
+        state.msg.msg_name = m_buffers.Get (request.bid) + sizeof (struct io_uring_recvmsg_out);
+        state.msg.msg_namelen = std::min<uint32_t> (out->namelen, m_recvMsg.msg_namelen);
+        state.msg.msg_iov = &state.iov;
+        state.msg.msg_iovlen = 1;
+
+        struct io_uring_sqe *sqe = m_uring.GetSqe ();
+        if (sqe == 0)
+          {
+            m_uring.Submit (false, 0);
+            WorkerCounters::Add (m_counters.syscalls, 1);
+            sqe = m_uring.GetSqe ();
+          }
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = m_fd;
+        sqe->addr = (uint64_t) (uintptr_t) &state.msg;
+        sqe->len = 1;
+        sqe->user_data = SEND_TAG | request.bid;
+        sojournNs += now - request.enqueueNs;
+      }
+    m_requests.Pop (m_inService);
+    m_inService = 0;
+    WorkerCounters::Add (m_counters.sojournNs, sojournNs);
+    WorkerCounters::Add (m_counters.busyNs, now - m_serviceStart);
+  }
+
+  Uring m_uring; //!< the io_uring instance
+  ProvidedBuffers m_buffers; //!< buffers the kernel receives in to
+  uint32_t m_bufferCount; //!< number of provided buffers
+  SpscRing<Request> m_requests; //!< the server buffer
+  std::vector<SendState> m_send; //!< send arguments per buffer
+  struct msghdr m_recvMsg; //!< layout of the received buffers
+  bool m_recvArmed; //!< the multishot receive is active
+  uint32_t m_held; //!< buffers taken from the kernel and not yet given back
+};
+
+/**
+ * \brief print the measured lambda and mue of a period
+ * \param c the counters of the period
+ * \param elapsedNs the length of the period
+ * \param what label of the period
+ * \param options the server configuration
+ */
+static void
+PrintStat (const Counters &c, uint64_t elapsedNs, const char *what, const ServerOptions &options)
+{
+  double elapsed = elapsedNs / 1e9;
+  // the workers serve in parallel, so the busy time is per worker
+  double busy = c.busyNs / 1e9 / options.threads;
+  double avgPacketSize = c.received ? (double) c.bytes / c.received : 0.0;
+  double configuredMue = avgPacketSize > 0 ? options.threads * options.serviceRate / (avgPacketSize * 8.0) : 0.0;
+  printf ("%s: received: %lu sent: %lu dropped: %lu lambda: %.1f "
+          "measured mue: %.1f configured mue: %.1f utilization: %.3f mean sojourn: %.6f "
+          "syscalls/packet: %.3f\n",
+          what, (unsigned long) c.received, (unsigned long) c.sent,
+          (unsigned long) c.dropped,
+          elapsed > 0 ? c.received / elapsed : 0.0,
+          busy > 0 ? c.sent / busy : 0.0, configuredMue,
+          elapsed > 0 ? busy / elapsed : 0.0,
+          c.sent ? c.sojournNs / 1e9 / c.sent : 0.0,
+          c.received ? (double) c.syscalls / c.received : 0.0);
+  fflush (stdout);
+}
+
+} // namespace native
+
+static void
+HandleSignal (int)
+{
+  native::g_stop = true;
+}
+
+static void
+Usage (const char *name)
+{
+  fprintf (stderr,
+           "usage: %s [-p port] [-r service rate bps] [-k batch size] [-o batch overhead]\n"
+           "          [-b io batch] [-q queue size] [-i stat interval s] [-s seed] [-t threads] [-u]\n"
+           "  -u: io_uring backend (multishot receive in to provided buffers, zero copy replies)\n", name);
+}
+
+int
+main (int argc, char *argv[])
+{
+  native::ServerOptions options;
+  int opt;
+  while ((opt = getopt (argc, argv, "p:r:k:o:b:q:i:s:t:uh")) != -1)
+    {
+      switch (opt)
+        {
+        case 'p': options.port = atoi (optarg); break;
+        case 'r': options.serviceRate = atof (optarg); break;
+        case 'k': options.batchSize = std::max (1, atoi (optarg)); break;
+        case 'o': options.batchOverhead = atof (optarg); break;
+        case 'b': options.ioBatch = std::max (1, atoi (optarg)); break;
+        case 'q': options.queueSize = std::max (1, atoi (optarg)); break;
+        case 'i': options.statInterval = atof (optarg); break;
+        case 's': options.seed = strtoull (optarg, 0, 10); break;
+        case 't': options.threads = std::max (1, atoi (optarg)); break;
+        case 'u': options.uring = true; break;
+        default: Usage (argv[0]); return 1;
+        }
+    }
+
+  signal (SIGINT, HandleSignal);
+  signal (SIGTERM, HandleSignal);
+
+  std::vector<native::EchoWorker *> workers;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      if (options.uring)
+        {
+          workers.push_back (new native::UringEchoServer (options, i));
+        }
+      else
+        {
+          workers.push_back (new native::EchoServer (options, i));
+        }
+      if (!workers.back ()->Open ())
+        {
+          return 1;
+        }
+    }
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      threads.push_back (std::thread (&native::EchoWorker::Run, workers[i]));
+    }
+
+  // aggregate the per-worker counters without locking the workers
+  uint64_t start = native::NowNs ();
+  uint64_t intervalStart = start;
+  native::Counters last;
+  while (!native::g_stop)
+    {
+      usleep ((useconds_t) (options.statInterval * 1e6));
+      uint64_t now = native::NowNs ();
+      native::Counters total;
+      for (uint32_t i = 0; i < options.threads; i++)
+        {
+          total.Add (workers[i]->GetCounters ());
+        }
+      native::Counters interval;
+      interval.received = total.received - last.received;
+      interval.bytes = total.bytes - last.bytes;
+      interval.sent = total.sent - last.sent;
+      interval.dropped = total.dropped - last.dropped;
+      interval.busyNs = total.busyNs - last.busyNs;
+      interval.sojournNs = total.sojournNs - last.sojournNs;
+      interval.syscalls = total.syscalls - last.syscalls;
+      native::PrintStat (interval, now - intervalStart, "interval", options);
+      last = total;
+      intervalStart = now;
+    }
+
+  native::Counters total;
+  for (uint32_t i = 0; i < options.threads; i++)
+    {
+      threads[i].join ();
+      total.Add (workers[i]->GetCounters ());
+      delete workers[i];
+    }
+  native::PrintStat (total, native::NowNs () - start, "total", options);
+  return 0;
+}
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef NATIVE_SPSC_RING_H
+#define NATIVE_SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace native {
+
+/**
+ * \brief a bounded single-producer/single-consumer ring buffer.
+ *
+ * The items are kept in place: the producer fills the free items it gets
+ * from WriteSlot and publishes them with Push, the consumer reads the
+ * published items with ReadSlot and frees them with Pop. The capacity is
+ * rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+  explicit SpscRing (uint32_t capacity)
+    : m_head (0),
+      m_tail (0)
+  {
+    uint32_t size = 1;
+    while (size < capacity)
+      {
+        size <<= 1;
+      }
+    m_items.resize (size);
+    m_mask = size - 1;
+  }
+
+  /**
+   * \brief get the ring capacity
+   * \return the number of items
+   */
+  uint32_t GetCapacity (void) const
+  {
+    return m_mask + 1;
+  }
+
+  /**
+   * \brief (producer) get the number of free items
+   * \return the number of items that can be written
+   */
+  uint32_t Free (void) const
+  {
+    return GetCapacity () - (m_tail.load (std::memory_order_relaxed) -
+                             m_head.load (std::memory_order_acquire));
+  }
+
+  /**
+   * \brief (producer) get a free item
+   * \param i the index among the free items, less than Free ()
+   * \return the item
+   */
+  T & WriteSlot (uint32_t i)
+  {
+    return m_items[(m_tail.load (std::memory_order_relaxed) + i) & m_mask];
+  }
+
+  /**
+   * \brief (producer) publish the first n free items
+   * \param n the number of items
+   */
+  void Push (uint32_t n)
+  {
+    m_tail.store (m_tail.load (std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  /**
+   * \brief (consumer) get the number of published items
+   * \return the number of items that can be read
+   */
+  uint32_t Size (void) const
+  {
+    return m_tail.load (std::memory_order_acquire) - m_head.load (std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief (consumer) get a published item
+   * \param i the index among the published items, less than Size ()
+   * \return the item
+   */
+  T & ReadSlot (uint32_t i)
+  {
+    return m_items[(m_head.load (std::memory_order_relaxed) + i) & m_mask];
+  }
+
+  /**
+   * \brief (consumer) free the first n published items
+   * \param n the number of items
+   */
+  void Pop (uint32_t n)
+  {
+    m_head.store (m_head.load (std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+private:
+  std::vector<T> m_items; //!< the items
+  uint32_t m_mask; //!< capacity - 1
+  alignas (64) std::atomic<uint32_t> m_head; //!< next item to read (written by the consumer)
+  alignas (64) std::atomic<uint32_t> m_tail; //!< next item to write (written by the producer)
+};
+
+} // namespace native
+
+#endif /* NATIVE_SPSC_RING_H */
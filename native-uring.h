@@ -0,0 +1,370 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef NATIVE_URING_H
+#define NATIVE_URING_H
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+
+namespace native {
+
+/**
+ * \brief a minimal io_uring instance on top of the raw system calls
+ * (liburing is not required). Only one thread may use an instance.
+ */
+class Uring
+{
+public:
+  Uring ()
+    : m_fd (-1),
+      m_sqRing (0),
+      m_cqRing (0),
+      m_sqes (0),
+      m_sqRingSize (0),
+      m_cqRingSize (0),
+      m_sqesSize (0),
+      m_pending (0)
+  {
+  }
+
+  ~Uring ()
+  {
+    if (m_sqes)
+      {
+        munmap (m_sqes, m_sqesSize);
+      }
+    if (m_cqRing && m_cqRing != m_sqRing)
+      {
+        munmap (m_cqRing, m_cqRingSize);
+      }
+    if (m_sqRing)
+      {
+        munmap (m_sqRing, m_sqRingSize);
+      }
+    if (m_fd >= 0)
+      {
+        close (m_fd);
+      }
+  }
+
+  /**
+   * \brief create the rings
+   * \param entries the number of submission queue entries
+   * \return false on failure (errno is set)
+   */
+  bool Init (unsigned entries)
+  {
+    struct io_uring_params p;
+    memset (&p, 0, sizeof (p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+    m_fd = syscall (__NR_io_uring_setup, entries, &p);
+    if (m_fd < 0)
+      {
+        return false;
+      }
+
+    m_sqRingSize = p.sq_off.array + p.sq_entries * sizeof (uint32_t);
+    m_cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+      {
+        m_sqRingSize = m_cqRingSize = std::max (m_sqRingSize, m_cqRingSize);
+      }
+    m_sqRing = (uint8_t *) mmap (0, m_sqRingSize, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED)
+      {
+        m_sqRing = 0;
+        return false;
+      }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+      {
+        m_cqRing = m_sqRing;
+      }
+    else
+      {
+        m_cqRing = (uint8_t *) mmap (0, m_cqRingSize, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED)
+          {
+            m_cqRing = 0;
+            return false;
+          }
+      }
+    m_sqesSize = p.sq_entries * sizeof (struct io_uring_sqe);
+    m_sqes = (struct io_uring_sqe *) mmap (0, m_sqesSize, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+      {
+        m_sqes = 0;
+        return false;
+      }
+
+    m_sqHead = (uint32_t *) (m_sqRing + p.sq_off.head);
+    m_sqTail = (uint32_t *) (m_sqRing + p.sq_off.tail);
+    m_sqMask = *(uint32_t *) (m_sqRing + p.sq_off.ring_mask);
+    m_sqEntries = p.sq_entries;
+    m_sqArray = (uint32_t *) (m_sqRing + p.sq_off.array);
+    m_cqHead = (uint32_t *) (m_cqRing + p.cq_off.head);
+    m_cqTail = (uint32_t *) (m_cqRing + p.cq_off.tail);
+    m_cqMask = *(uint32_t *) (m_cqRing + p.cq_off.ring_mask);
+    m_cqes = (struct io_uring_cqe *) (m_cqRing + p.cq_off.cqes);
+    return true;
+  }
+
+  /**
+   * \brief get a cleared submission queue entry
+   * \return the entry, or null if the submission queue is full
+   */
+  struct io_uring_sqe * GetSqe (void)
+  {
+    uint32_t tail = *m_sqTail + m_pending;
+    if (tail - __atomic_load_n (m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+      {
+        return 0;
+      }
+    struct io_uring_sqe *sqe = &m_sqes[tail & m_sqMask];
+    memset (sqe, 0, sizeof (*sqe));
+    m_sqArray[tail & m_sqMask] = tail & m_sqMask;
+    m_pending++;
+    return sqe;
+  }
+
+  /**
+   * \brief submit the pending entries and optionally wait for a completion
+   * \param wait wait for at least one completion
+   * \param timeoutNs maximum wait time
+   * \return the number of submitted entries, or a negative errno
+   */
+  int Submit (bool wait, uint64_t timeoutNs)
+  {
+    uint32_t toSubmit = m_pending;
+    __atomic_store_n (m_sqTail, *m_sqTail + m_pending, __ATOMIC_RELEASE);
+    m_pending = 0;
+    if (!wait && toSubmit == 0)
+      {
+        return 0;
+      }
+
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeoutNs / 1000000000ULL;
+    ts.tv_nsec = timeoutNs % 1000000000ULL;
+    struct io_uring_getevents_arg arg;
+    memset (&arg, 0, sizeof (arg));
+    arg.ts = (uint64_t) (uintptr_t) &ts;
+    unsigned flags = wait ? (IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG) : 0;
+    int r = syscall (__NR_io_uring_enter, m_fd, toSubmit, wait ? 1 : 0, flags,
+                     wait ? (void *) &arg : 0, wait ? sizeof (arg) : 0);
+    if (r < 0 && (errno == ETIME || errno == EINTR))
+      {
+        return 0;
+      }
+    return r < 0 ? -errno : r;
+  }
+
+  /**
+   * \brief get the next completion, if any
+   * \return the completion, or null. Release it with CqeSeen.
+   */
+  struct io_uring_cqe * PeekCqe (void)
+  {
+    uint32_t head = *m_cqHead;
+    if (head == __atomic_load_n (m_cqTail, __ATOMIC_ACQUIRE))
+      {
+        return 0;
+      }
+    return &m_cqes[head & m_cqMask];
+  }
+
+  /**
+   * \brief release the completion returned by PeekCqe
+   */
+  void CqeSeen (void)
+  {
+    __atomic_store_n (m_cqHead, *m_cqHead + 1, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * \brief call io_uring_register
+   * \return 0, or a negative errno
+   */
+  int Register (unsigned opcode, void *arg, unsigned nrArgs)
+  {
+    int r = syscall (__NR_io_uring_register, m_fd, opcode, arg, nrArgs);
+    return r < 0 ? -errno : r;
+  }
+
+private:
+  int m_fd; //!< the ring file descriptor
+  uint8_t *m_sqRing; //!< submission ring mapping
+  uint8_t *m_cqRing; //!< completion ring mapping
+  struct io_uring_sqe *m_sqes; //!< submission queue entries
+  size_t m_sqRingSize; //!< size of the submission ring mapping
+  size_t m_cqRingSize; //!< size of the completion ring mapping
+  size_t m_sqesSize; //!< size of the entries mapping
+  uint32_t *m_sqHead; //!< submission ring head (kernel)
+  uint32_t *m_sqTail; //!< submission ring tail (user)
+  uint32_t m_sqMask; //!< submission ring mask
+  uint32_t m_sqEntries; //!< submission ring size
+  uint32_t *m_sqArray; //!< submission ring index array
+  uint32_t *m_cqHead; //!< completion ring head (user)
+  uint32_t *m_cqTail; //!< completion ring tail (kernel)
+  uint32_t m_cqMask; //!< completion ring mask
+  struct io_uring_cqe *m_cqes; //!< completion entries
+  uint32_t m_pending; //!< entries prepared but not yet submitted
+};
+
+/**
+ * \brief a ring of buffers provided to the kernel (IORING_REGISTER_PBUF_RING).
+ * The kernel picks a buffer per received datagram; the buffer is given
+ * back with Recycle once the reply has been sent from it.
+ */
+class ProvidedBuffers
+{
+public:
+  ProvidedBuffers ()
+    : m_ring (0),
+      m_ringSize (0),
+      m_data (0),
+      m_dataSize (0),
+      m_count (0),
+      m_bufferSize (0),
+      m_added (0)
+  {
+  }
+
+  ~ProvidedBuffers ()
+  {
+    if (m_ring)
+      {
+        munmap (m_ring, m_ringSize);
+      }
+    if (m_data)
+      {
+        munmap (m_data, m_dataSize);
+      }
+  }
+
+  /**
+   * \brief allocate and register the buffers
+   * \param uring the ring to register with
+   * \param group the buffer group id
+   * \param count number of buffers, a power of two up to 32768
+   * \param size size of each buffer
+   * \return 0, or a negative errno
+   */
+  int Init (Uring &uring, uint16_t group, uint32_t count, uint32_t size)
+  {
+    m_count = count;
+    m_bufferSize = size;
+    m_ringSize = count * sizeof (struct io_uring_buf);
+    m_ring = (struct io_uring_buf *) mmap (0, m_ringSize, PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    m_dataSize = (size_t) count * size;
+    m_data = (uint8_t *) mmap (0, m_dataSize, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m_ring == MAP_FAILED || m_data == MAP_FAILED)
+      {
+        m_ring = 0;
+        m_data = 0;
+        return -ENOMEM;
+      }
+
+    struct io_uring_buf_reg reg;
+    memset (&reg, 0, sizeof (reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) m_ring;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    int r = uring.Register (IORING_REGISTER_PBUF_RING, &reg, 1);
+    if (r < 0)
+      {
+        return r;
+      }
+    for (uint32_t i = 0; i < count; i++)
+      {
+        Recycle (i);
+      }
+    Publish ();
+    return 0;
+  }
+
+  /**
+   * \brief get a buffer
+   * \param id the buffer id
+   * \return the buffer memory
+   */
+  uint8_t * Get (uint16_t id) const
+  {
+    return m_data + (size_t) id * m_bufferSize;
+  }
+
+  /**
+   * \brief give a buffer back to the kernel (visible after Publish)
+   * \param id the buffer id
+   */
+  void Recycle (uint16_t id)
+  {
+    uint16_t tail = *Tail () + m_added;
+    struct io_uring_buf *buf = &m_ring[tail & (m_count - 1)];
+    buf->addr = (uint64_t) (uintptr_t) Get (id);
+    buf->len = m_bufferSize;
+    buf->bid = id;
+    m_added++;
+  }
+
+  /**
+   * \brief publish the recycled buffers to the kernel
+   */
+  void Publish (void)
+  {
+    __atomic_store_n (Tail (), (uint16_t) (*Tail () + m_added), __ATOMIC_RELEASE);
+    m_added = 0;
+  }
+
+private:
+  /**
+   * \brief get the ring tail, which overlays the reserved field of the
+   * first entry. struct io_uring_buf_ring is not used as its flexible array
+   * member is laid out at a different offset when compiled as C++.
+   */
+  uint16_t * Tail (void)
+  {
+    return &m_ring[0].resv;
+  }
+
+  struct io_uring_buf *m_ring; //!< the shared ring
+  size_t m_ringSize; //!< size of the ring mapping
+  uint8_t *m_data; //!< buffer memory
+  size_t m_dataSize; //!< size of the buffer memory
+  uint32_t m_count; //!< number of buffers
+  uint32_t m_bufferSize; //!< size of a buffer
+  uint16_t m_added; //!< recycled but not yet published buffers
+};
+
+} // namespace native
+
+#endif /* NATIVE_URING_H */
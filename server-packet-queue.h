@@ -27,14 +27,83 @@
 #include "ns3/packet.h" 
 #include "ns3/address-utils.h"
 
+#include <map>
+#include <vector>
+
 namespace ns3 {
 //using namespace ns3
+/**
+ * \brief a table of interned peer addresses.
+ *
+ * Queue entries refer to their peer by a 32-bit index into this table 
+ * instead of carrying a full Address, as the number of distinct peers 
+ * is far smaller than the number of queued packets.
+ */
+class ServerPeerTable
+{
+public:
+ServerPeerTable ()
+{
+  //cstrctr
+}
+
+/**
+* \brief get the index of an address, adding the address if it is new
+* \params address the peer address
+* \returns the index of the address
+*/
+uint32_t Intern (const Address &address)
+{
+      std::map<Address, uint32_t>::const_iterator it = m_index.find (address);
+      if (it != m_index.end ())
+      {
+        return it->second;
+      }
+      uint32_t index = m_peers.size ();
+      m_peers.push_back (address);
+      m_index.insert (std::make_pair (address, index));
+      return index;
+}
+
+/**
+* \brief get the address of an index
+* \params index the index returned by Intern
+* \returns the peer address
+*/
+const Address & Get (uint32_t index) const
+{
+      NS_ASSERT (index < m_peers.size ());
+      return m_peers[index];
+}
+
+/**
+* \brief get the number of interned addresses
+* \returns the number of the peers
+*/
+uint32_t GetSize () const
+{
+      return m_peers.size ();
+}
+
+private:
+
+  std::vector<Address> m_peers; //!< the interned addresses
+  std::map<Address, uint32_t> m_index; //!< address to index lookup
+};
+
+/**
+ * \brief an entry of the server packet buffer.
+ *
+ * The entry is kept compact (a packet pointer, a peer index and the 
+ * enqueue time) as there can be millions of backlogged packets.
+ */
 class ServerQueueEntry
 {
 public:
-ServerQueueEntry (Ptr<const Packet> pa = 0, Address const address = Address ())
+ServerQueueEntry (Ptr<const Packet> pa = 0, uint32_t peer = 0)
       		:m_packet (pa),
-      		m_address (address)
+      		m_peer (peer),
+      		m_enqueueTime (Simulator::Now ().GetTimeStep ())
 {
   //cstrctr
 }
@@ -58,27 +127,46 @@ void SetPacket (Ptr<const Packet> p)
 }
 
 /**
-* \brief get the packet's destination address
-* \returns the destination address of the packet
+* \brief get the index of the packet's destination in the ServerPeerTable
+* \returns the peer index of the packet
+*/
+uint32_t GetPeer () const
+{
+      return m_peer;
+}
+
+/**
+* \brief set the index of the packet's destination in the ServerPeerTable
+* \params peer the peer index of the packet
+*/
+void SetPeer (uint32_t peer)
+{
+      m_peer = peer;
+}
+
+/**
+* \brief get the time the packet was added to the queue
+* \returns the enqueue time
 */
-Address GetAddress () const
+Time GetEnqueueTime () const
 {
-      return m_address;
+      return Time (m_enqueueTime);
 }
 
 /**
-* \brief set the packet's destination address
-* \params add destination address of the packet
+* \brief set the time the packet was added to the queue
+* \params t the enqueue time
 */
-void SetAddress (Address add)
+void SetEnqueueTime (Time t)
 {
-      m_address = add;
+      m_enqueueTime = t.GetTimeStep ();
 }
 
 private:
 
   Ptr<const Packet> m_packet; //!< data packet
-  Address m_address; //!< destination address of the packet
+  uint32_t m_peer; //!< index of the destination address of the packet
+  int64_t m_enqueueTime; //!< time (in time steps) the packet entered the server buffer
 };
 } // END OF ns3
 #endif /* sorrouting_PACKETQUEUE_H */
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Egress asymmetry: small requests, large fragmented replies.
+ *
+ * nClients clients send --rate requests/s in total (--packetSize bytes
+ * each) to a server whose reply payload sizes follow --distribution with
+ * the mean of each entry of --sizes, fragmented at --mtu. The server
+ * link runs at --serverLink, so the replies, not the requests, load it.
+ * The program prints one CSV line per mean reply size: the fragments per
+ * reply, the egress over the ingress bytes of the server, the utilization
+ * of its egress link, the time to the first and to the last byte (p50,
+ * p99) and the fraction of the replies which lost a fragment,
+ * e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-asymmetric --sizes=100,1000,10000,30000"
+ *   ./waf --run "scratch/udp-echo-asymmetric --distribution=Pareto --serverLink=1Gbps"
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-sketch.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoAsymmetric");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  double rate = 500.0;
+  uint32_t packetSize = 100;
+  std::string sizes = "100,1000,10000,30000";
+  std::string distribution = "Exponential";
+  uint32_t mtu = 1472;
+  std::string serverLink = "100Mbps";
+  double simTime = 60.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("rate", "Total request rate of the clients (requests/s)", rate);
+  cmd.AddValue ("packetSize", "Request payload size (bytes)", packetSize);
+  cmd.AddValue ("sizes", "Comma separated mean reply payload sizes (bytes)", sizes);
+  cmd.AddValue ("distribution", "Reply size distribution (Constant, Exponential, Pareto)", distribution);
+  cmd.AddValue ("mtu", "Largest reply packet, CommHeader included (bytes)", mtu);
+  cmd.AddValue ("serverLink", "Data rate of the server link", serverLink);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  std::cout << "response_size,fragments_per_reply,egress_over_ingress,egress_utilization,"
+               "ttfb_p50,ttfb_p99,ttlb_p50,ttlb_p99,incomplete" << std::endl;
+
+  std::istringstream list (sizes);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RngSeedManager::SetRun (run);
+
+      NodeContainer hub;
+      hub.Create (1);
+      NodeContainer server;
+      server.Create (1);
+      NodeContainer clients;
+      clients.Create (nClients);
+
+      InternetStackHelper internet;
+      internet.Install (hub);
+      internet.Install (server);
+      internet.Install (clients);
+
+      PointToPointHelper p2p;
+      p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4StaticRoutingHelper staticRouting;
+      Ipv4Address serverAddress;
+      NodeContainer spokes (server, clients);
+      for (uint32_t i = 0; i < spokes.GetN (); i++)
+        {
+          // the server link is the bottleneck of the replies
+          p2p.SetDeviceAttribute ("DataRate", StringValue (i == 0 ? serverLink : "1Gbps"));
+          NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+          Ipv4InterfaceContainer interfaces = address.Assign (devices);
+          address.NewNetwork ();
+          Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+          routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+          if (i == 0)
+            {
+              serverAddress = interfaces.GetAddress (1);
+            }
+        }
+
+      // the client DataRate counts the payload only
+      DataRate clientRate ((uint64_t) (rate / nClients * packetSize * 8));
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (DataRate ("1Gbps")));
+      echoServer.SetAttribute ("ResponseSize", StringValue (distribution));
+      echoServer.SetAttribute ("ResponseSizeMean", UintegerValue (atoi (item.c_str ())));
+      echoServer.SetAttribute ("Mtu", UintegerValue (mtu));
+      echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer serverApp = echoServer.Install (server);
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 1.0));
+      Ptr<UdpEchoServer> echoServerApp = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+
+      std::vector<Ptr<UdpEchoClient> > clientApps;
+      for (uint32_t i = 0; i < nClients; i++)
+        {
+          UdpEchoClientHelper echoClient (serverAddress, port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+          clientApp.Start (Seconds ((double) i / nClients));
+          clientApp.Stop (Seconds (simTime + 1.0));
+          clientApps.push_back (DynamicCast<UdpEchoClient> (clientApp.Get (0)));
+        }
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      EchoSketch ttfb;
+      EchoSketch ttlb;
+      uint32_t incomplete = 0;
+      for (uint32_t i = 0; i < clientApps.size (); i++)
+        {
+          ttfb.Merge (clientApps[i]->GetTtfb ());
+          ttlb.Merge (clientApps[i]->GetTtlb ());
+          incomplete += clientApps[i]->GetIncompleteReplies ();
+        }
+      double rxBytes = echoServerApp->GetRxBytes ();
+      double txBits = echoServerApp->GetTxBytes () * 8.0;
+      std::cout << item << "," << echoServerApp->GetFragmentsPerReply () << ","
+                << (rxBytes ? txBits / 8.0 / rxBytes : 0.0) << ","
+                << txBits / simTime / DataRate (serverLink).GetBitRate () << ","
+                << ttfb.GetQuantile (0.50) << "," << ttfb.GetQuantile (0.99) << ","
+                << ttlb.GetQuantile (0.50) << "," << ttlb.GetQuantile (0.99) << ","
+                << (ttfb.GetCount () ? (double) incomplete / ttfb.GetCount () : 0.0) << std::endl;
+
+      Simulator::Destroy ();
+    }
+  return 0;
+}
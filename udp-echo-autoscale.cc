@@ -0,0 +1,244 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Reaction of the server autoscaler to a load spike.
+ *
+ * nClients clients offer --rho of the capacity of one channel; between
+ * --spikeStart and --spikeEnd, --spike times as many clients join. The
+ * server starts with one channel and scales its channels (or, with
+ * --mode=Frequency, its frequency). The scenario is run once per
+ * provisioning delay of the list and prints one CSV line each: the time
+ * from the spike to the first scale up and to the highest capacity, the
+ * highest and the time averaged capacity (the cost), the number of scale
+ * ups and downs, and the RTT p99 and p99.9 of the requests sent during
+ * the spike and of the whole run, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-autoscale --delays=0,5,10,30 --spike=4"
+ *   ./waf --run "scratch/udp-echo-autoscale --mode=Frequency --metric=QueueLength --upThreshold=2"
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-sketch.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoAutoscale");
+
+/**
+ * \brief what a run observed
+ */
+struct AutoscaleRun
+{
+  Time spikeStart; //!< start of the spike
+  Time spikeEnd; //!< end of the spike
+  Time firstScaleUp; //!< first capacity increase after the spike start
+  Time peakTime; //!< time the highest capacity was reached
+  double peak; //!< highest capacity
+  EchoSketch spikeRtt; //!< RTTs of the requests sent during the spike (s)
+  EchoSketch rtt; //!< all the RTTs (s)
+};
+
+/**
+ * \brief follow the capacity changes
+ */
+static void
+CapacityChanged (AutoscaleRun *run, double oldValue, double newValue)
+{
+  Time now = Simulator::Now ();
+  if (newValue > oldValue && now >= run->spikeStart && run->firstScaleUp.IsZero ())
+    {
+      run->firstScaleUp = now;
+    }
+  if (newValue > run->peak)
+    {
+      run->peak = newValue;
+      run->peakTime = now;
+    }
+}
+
+/**
+ * \brief record an RTT
+ */
+static void
+RecordRtt (AutoscaleRun *run, Time rtt)
+{
+  Time sent = Simulator::Now () - rtt;
+  run->rtt.Add (rtt.GetSeconds ());
+  if (sent >= run->spikeStart && sent < run->spikeEnd)
+    {
+      run->spikeRtt.Add (rtt.GetSeconds ());
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  double rho = 0.5;
+  double spike = 4.0;
+  double spikeStart = 100.0;
+  double spikeEnd = 200.0;
+  double simTime = 300.0;
+  std::string delays = "0,5,10,30";
+  std::string mode = "Channels";
+  std::string metric = "Utilization";
+  double upThreshold = 0.8;
+  double downThreshold = 0.3;
+  uint32_t maxChannels = 8;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients before the spike", nClients);
+  cmd.AddValue ("rho", "Offered load before the spike over the capacity of one channel", rho);
+  cmd.AddValue ("spike", "Offered load multiplier during the spike", spike);
+  cmd.AddValue ("spikeStart", "Start of the spike (s)", spikeStart);
+  cmd.AddValue ("spikeEnd", "End of the spike (s)", spikeEnd);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("delays", "Comma separated provisioning delays (s)", delays);
+  cmd.AddValue ("mode", "Autoscale mode (Channels, Frequency)", mode);
+  cmd.AddValue ("metric", "Autoscale metric (Utilization, QueueLength)", metric);
+  cmd.AddValue ("upThreshold", "Scale up threshold", upThreshold);
+  cmd.AddValue ("downThreshold", "Scale down threshold", downThreshold);
+  cmd.AddValue ("maxChannels", "Most channels", maxChannels);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  uint32_t nSpikeClients = (uint32_t) (nClients * (spike - 1.0) + 0.5);
+
+  std::cout << "provisioning_delay,first_scale_up_s,peak_capacity_s,peak_capacity,mean_capacity,"
+               "scale_ups,scale_downs,spike_rtt_p99,spike_rtt_p999,rtt_p99,rtt_p999" << std::endl;
+
+  std::istringstream list (delays);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      double delay = atof (item.c_str ());
+      RngSeedManager::SetRun (run);
+
+      NodeContainer hub;
+      hub.Create (1);
+      NodeContainer server;
+      server.Create (1);
+      NodeContainer clients;
+      clients.Create (nClients + nSpikeClients);
+
+      InternetStackHelper internet;
+      internet.Install (hub);
+      internet.Install (server);
+      internet.Install (clients);
+
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4StaticRoutingHelper staticRouting;
+      Ipv4Address serverAddress;
+      NodeContainer spokes (server, clients);
+      for (uint32_t i = 0; i < spokes.GetN (); i++)
+        {
+          NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+          Ipv4InterfaceContainer interfaces = address.Assign (devices);
+          address.NewNetwork ();
+          Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+          routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+          if (i == 0)
+            {
+              serverAddress = interfaces.GetAddress (1);
+            }
+        }
+
+      // every client offers rho / nClients of one channel
+      uint32_t packetSize = 100;
+      uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+      DataRate serviceRate ("10Mbps");
+      double lambda = rho * serviceRate.GetBitRate () / (requestSize * 8.0) / nClients;
+      DataRate clientRate ((uint64_t) (lambda * packetSize * 8));
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+      echoServer.SetAttribute ("Autoscale", StringValue (mode));
+      echoServer.SetAttribute ("AutoscaleMetric", StringValue (metric));
+      echoServer.SetAttribute ("ScaleUpThreshold", DoubleValue (upThreshold));
+      echoServer.SetAttribute ("ScaleDownThreshold", DoubleValue (downThreshold));
+      echoServer.SetAttribute ("MaxChannels", UintegerValue (maxChannels));
+      echoServer.SetAttribute ("ProvisioningDelay", TimeValue (Seconds (delay)));
+      echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer serverApp = echoServer.Install (server);
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 1.0));
+      Ptr<UdpEchoServer> echoServerApp = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+
+      AutoscaleRun result;
+      result.spikeStart = Seconds (spikeStart);
+      result.spikeEnd = Seconds (spikeEnd);
+      result.peak = 1.0;
+      echoServerApp->TraceConnectWithoutContext ("Capacity", MakeBoundCallback (&CapacityChanged, &result));
+
+      for (uint32_t i = 0; i < nClients + nSpikeClients; i++)
+        {
+          UdpEchoClientHelper echoClient (serverAddress, port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+          if (i < nClients)
+            {
+              clientApp.Start (Seconds ((double) i / nClients));
+              clientApp.Stop (Seconds (simTime + 1.0));
+            }
+          else
+            {
+              clientApp.Start (Seconds (spikeStart));
+              clientApp.Stop (Seconds (spikeEnd));
+            }
+          clientApp.Get (0)->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&RecordRtt, &result));
+        }
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      // the server is still running at simTime, so its time averages run up to now
+      std::cout << delay << ","
+                << (result.firstScaleUp.IsZero () ? -1.0 : (result.firstScaleUp - result.spikeStart).GetSeconds ()) << ","
+                << (result.peakTime >= result.spikeStart ? (result.peakTime - result.spikeStart).GetSeconds () : -1.0) << ","
+                << result.peak << "," << echoServerApp->GetMeanCapacity () << ","
+                << echoServerApp->GetScaleUps () << "," << echoServerApp->GetScaleDowns () << ","
+                << result.spikeRtt.GetQuantile (0.99) << "," << result.spikeRtt.GetQuantile (0.999) << ","
+                << result.rtt.GetQuantile (0.99) << "," << result.rtt.GetQuantile (0.999) << std::endl;
+
+      Simulator::Destroy ();
+    }
+  return 0;
+}
@@ -0,0 +1,297 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Microbenchmarks (Google Benchmark) of the per-packet paths of the echo
+ * applications. Every benchmark reports the time and the heap allocations
+ * per operation ("allocs/op", counted by the operator new below). The
+ * memory benchmarks report the live heap bytes (the usable size of every
+ * block from operator new, i.e., with the allocator rounding) per queued
+ * entry or per peer.
+ *
+ * Build it with the applications, against ns-3 and Google Benchmark, e.g.:
+ *   g++ -O2 -o udp-echo-benchmark udp-echo-benchmark.cc udp-echo-client.cc \
+ *     udp-echo-server.cc comm-header.cc echo-trace.cc echo-sketch.cc echo-cache.cc \
+ *     echo-pipeline.cc echo-fanout.cc echo-autoscaler.cc \
+ *     $(pkg-config --cflags --libs libns3-dev-core libns3-dev-network \
+ *       libns3-dev-internet libns3-dev-applications) -lbenchmark -lpthread
+ */
+
+#include <stdlib.h>
+#include <malloc.h>
+#include <new>
+#include <queue>
+
+#include <benchmark/benchmark.h>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/comm-header.h"
+
+#include "udp-echo-client.h"
+#include "udp-echo-server.h"
+
+static uint64_t g_allocations = 0; //!< number of operator new calls
+static int64_t g_liveBytes = 0; //!< usable bytes of the live operator new blocks
+
+void *
+operator new (size_t size)
+{
+  g_allocations++;
+  void *p = malloc (size ? size : 1);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  g_liveBytes += malloc_usable_size (p);
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  if (p != 0)
+    {
+      g_liveBytes -= malloc_usable_size (p);
+    }
+  free (p);
+}
+
+void
+operator delete (void *p, size_t) noexcept
+{
+  if (p != 0)
+    {
+      g_liveBytes -= malloc_usable_size (p);
+    }
+  free (p);
+}
+
+namespace ns3 {
+
+/**
+ * \brief the server buffer entry before the peer interning: the packet,
+ * the full peer Address and the enqueue Time
+ */
+struct LegacyQueueEntry
+{
+  LegacyQueueEntry (Ptr<const Packet> p, const Address &a)
+    : packet (p), peer (a), enqueueTime (Simulator::Now ()) {}
+  Ptr<const Packet> packet; //!< the request
+  Address peer; //!< the client address
+  Time enqueueTime; //!< time the request was buffered
+};
+
+/**
+ * \brief access to the private per-packet paths of the echo applications
+ */
+class UdpEchoBenchmark
+{
+public:
+  /**
+   * \brief report the allocations made since start per iteration
+   */
+  static void CountAllocations (benchmark::State &state, uint64_t start)
+  {
+    state.counters["allocs/op"] = benchmark::Counter ((double) (g_allocations - start),
+                                                      benchmark::Counter::kAvgIterations);
+  }
+
+  static void
+  HeaderSerialize (benchmark::State &state)
+  {
+    CommHeader hdr;
+    hdr.SetSentTime (Seconds (1.5));
+    hdr.SetPacketType (CommHeader::REQ_PACKET);
+    hdr.SetTrafficClass (1);
+    Buffer buffer;
+    buffer.AddAtStart (hdr.GetSerializedSize ());
+    uint64_t start = g_allocations;
+    for (auto _ : state)
+      {
+        hdr.SetSequenceNumber ((uint32_t) state.iterations ());
+        hdr.Serialize (buffer.Begin ());
+        benchmark::ClobberMemory ();
+      }
+    CountAllocations (state, start);
+  }
+
+  static void
+  HeaderDeserialize (benchmark::State &state)
+  {
+    CommHeader hdr;
+    hdr.SetSentTime (Seconds (1.5));
+    Buffer buffer;
+    buffer.AddAtStart (hdr.GetSerializedSize ());
+    hdr.Serialize (buffer.Begin ());
+    uint64_t start = g_allocations;
+    for (auto _ : state)
+      {
+        CommHeader read;
+        benchmark::DoNotOptimize (read.Deserialize (buffer.Begin ()));
+        benchmark::DoNotOptimize (read.GetSequenceNumber ());
+      }
+    CountAllocations (state, start);
+  }
+
+  /**
+   * \brief UdpEchoClient::Send packet construction, state.range (0) selects
+   * the SetFill data
+   */
+  static void
+  ClientCreateRequest (benchmark::State &state)
+  {
+    Ptr<UdpEchoClient> client = CreateObject<UdpEchoClient> ();
+    if (state.range (0))
+      {
+        client->SetFill (0xab, 1024);
+      }
+    else
+      {
+        client->SetDataSize (1024);
+      }
+    uint64_t start = g_allocations;
+    for (auto _ : state)
+      {
+        Ptr<Packet> p = client->CreateRequest ();
+        benchmark::DoNotOptimize (p);
+        client->m_sent++;
+      }
+    CountAllocations (state, start);
+  }
+
+  /**
+   * \brief ServerQueueEntry push and pop through UdpEchoServer::m_serverBuffer
+   */
+  static void
+  ServerQueue (benchmark::State &state)
+  {
+    Ptr<UdpEchoServer> server = CreateObject<UdpEchoServer> ();
+    server->m_serverBuffer.resize (1);
+    Ptr<Packet> packet = Create<Packet> (1024);
+    uint32_t depth = state.range (0);
+    for (uint32_t i = 0; i < depth; i++)
+      {
+        server->m_serverBuffer[0].push (ServerQueueEntry (packet, 0));
+      }
+    uint64_t start = g_allocations;
+    for (auto _ : state)
+      {
+        server->m_serverBuffer[0].push (ServerQueueEntry (packet, 0));
+        benchmark::DoNotOptimize (server->m_serverBuffer[0].front ().GetPacket ());
+        server->m_serverBuffer[0].pop ();
+      }
+    CountAllocations (state, start);
+  }
+
+  /**
+   * \brief heap bytes per entry of a std::queue of state.range (0) copies
+   * of an entry (the packet is shared, so only the buffer itself counts)
+   */
+  template <typename Entry>
+  static void
+  QueueMemory (benchmark::State &state, const Entry &entry)
+  {
+    uint32_t depth = state.range (0);
+    for (auto _ : state)
+      {
+        int64_t before = g_liveBytes;
+        std::queue<Entry> queue;
+        for (uint32_t i = 0; i < depth; i++)
+          {
+            queue.push (entry);
+          }
+        state.counters["bytes/entry"] = (double) (g_liveBytes - before) / depth;
+        state.counters["sizeof"] = sizeof (Entry);
+      }
+  }
+
+  /**
+   * \brief memory of the server buffer with the compact ServerQueueEntry
+   */
+  static void
+  ServerQueueMemory (benchmark::State &state)
+  {
+    Ptr<Packet> packet = Create<Packet> (1024);
+    QueueMemory (state, ServerQueueEntry (packet, 0));
+  }
+
+  /**
+   * \brief memory of the server buffer with the entry carrying the Address
+   */
+  static void
+  LegacyQueueMemory (benchmark::State &state)
+  {
+    Ptr<Packet> packet = Create<Packet> (1024);
+    QueueMemory (state, LegacyQueueEntry (packet, InetSocketAddress (Ipv4Address ("10.0.0.1"), 9)));
+  }
+
+  /**
+   * \brief heap bytes per peer of a ServerPeerTable of state.range (0)
+   * distinct clients, paid once per client instead of once per entry
+   */
+  static void
+  PeerTableMemory (benchmark::State &state)
+  {
+    uint32_t peers = state.range (0);
+    for (auto _ : state)
+      {
+        int64_t before = g_liveBytes;
+        ServerPeerTable table;
+        for (uint32_t i = 0; i < peers; i++)
+          {
+            table.Intern (InetSocketAddress (Ipv4Address (0x0a000000 + i), 9));
+          }
+        state.counters["bytes/peer"] = (double) (g_liveBytes - before) / peers;
+      }
+  }
+
+  /**
+   * \brief UdpEchoServer::Reply header swap (without the socket)
+   */
+  static void
+  ServerCreateReply (benchmark::State &state)
+  {
+    Ptr<UdpEchoServer> server = CreateObject<UdpEchoServer> ();
+    server->m_numClasses = 1;
+    server->m_classStats.resize (1);
+    Ptr<UdpEchoClient> client = CreateObject<UdpEchoClient> ();
+    client->SetDataSize (1024);
+    ServerQueueEntry entry (client->CreateRequest (), 0);
+    uint64_t start = g_allocations;
+    for (auto _ : state)
+      {
+        Ptr<Packet> reply = server->CreateReply (entry);
+        benchmark::DoNotOptimize (reply);
+      }
+    CountAllocations (state, start);
+  }
+};
+
+BENCHMARK (UdpEchoBenchmark::HeaderSerialize);
+BENCHMARK (UdpEchoBenchmark::HeaderDeserialize);
+BENCHMARK (UdpEchoBenchmark::ClientCreateRequest)->Arg (0)->Arg (1);
+BENCHMARK (UdpEchoBenchmark::ServerQueue)->Arg (0)->Arg (1000);
+BENCHMARK (UdpEchoBenchmark::ServerCreateReply);
+BENCHMARK (UdpEchoBenchmark::ServerQueueMemory)->Arg (1000000);
+BENCHMARK (UdpEchoBenchmark::LegacyQueueMemory)->Arg (1000000);
+BENCHMARK (UdpEchoBenchmark::PeerTableMemory)->Arg (1000);
+
+} // namespace ns3
+
+BENCHMARK_MAIN ();
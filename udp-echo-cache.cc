@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Hit ratio and latency of a server with a response cache.
+ *
+ * nClients clients in --classes traffic classes ask for --numKeys keys
+ * with Zipf popularity (--zipf exponents) at --load times the capacity of
+ * the server without a cache. The scenario is run once per pair of Zipf
+ * exponent and cache size of the lists (0 disables the cache) and prints
+ * one CSV line each: the hit ratio, the effective capacity over the one
+ * without a cache (the speedup), the throughput and the RTT p50/p99, and
+ * the colon separated hit ratios and RTT p99 of the classes, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-cache --sizes=0,10,100,1000 --zipf=0.8,0.99,1.2"
+ *   ./waf --run "scratch/udp-echo-cache --policy=Lfu --keys=Uniform --load=0.9"
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-sketch.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoCache");
+
+/**
+ * \brief record an RTT
+ */
+static void
+RecordRtt (EchoSketch *sketch, Time rtt)
+{
+  sketch->Add (rtt.GetSeconds ());
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  uint32_t classes = 2;
+  std::string sizes = "0,10,100,1000";
+  std::string exponents = "0.99";
+  std::string policy = "Lru";
+  std::string keys = "Zipf";
+  uint32_t numKeys = 10000;
+  double hitCost = 0.1;
+  double load = 0.8;
+  double simTime = 100.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("classes", "Number of traffic classes, the clients take turns", classes);
+  cmd.AddValue ("sizes", "Comma separated cache sizes (keys, 0: no cache)", sizes);
+  cmd.AddValue ("zipf", "Comma separated Zipf exponents", exponents);
+  cmd.AddValue ("policy", "Cache eviction policy (Lru, Lfu)", policy);
+  cmd.AddValue ("keys", "Key distribution (Uniform, Zipf)", keys);
+  cmd.AddValue ("numKeys", "Number of distinct keys", numKeys);
+  cmd.AddValue ("hitCost", "Service time of a hit over the one of a miss", hitCost);
+  cmd.AddValue ("load", "Offered load over the capacity without a cache", load);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  std::cout << "zipf,cache_size,hit_ratio,speedup,throughput,rtt_p50,rtt_p99,"
+               "class_hit_ratio,class_rtt_p99" << std::endl;
+
+  std::istringstream exponentList (exponents);
+  std::string exponent;
+  while (std::getline (exponentList, exponent, ','))
+    {
+      std::istringstream sizeList (sizes);
+      std::string size;
+      while (std::getline (sizeList, size, ','))
+        {
+          RngSeedManager::SetRun (run);
+
+          NodeContainer hub;
+          hub.Create (1);
+          NodeContainer server;
+          server.Create (1);
+          NodeContainer clients;
+          clients.Create (nClients);
+
+          InternetStackHelper internet;
+          internet.Install (hub);
+          internet.Install (server);
+          internet.Install (clients);
+
+          PointToPointHelper p2p;
+          p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+          p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+          Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+          Ipv4StaticRoutingHelper staticRouting;
+          Ipv4Address serverAddress;
+          NodeContainer spokes (server, clients);
+          for (uint32_t i = 0; i < spokes.GetN (); i++)
+            {
+              NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+              Ipv4InterfaceContainer interfaces = address.Assign (devices);
+              address.NewNetwork ();
+              Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+              routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+              if (i == 0)
+                {
+                  serverAddress = interfaces.GetAddress (1);
+                }
+            }
+
+          uint32_t packetSize = 100;
+          uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+          DataRate serviceRate ("10Mbps");
+          double mue = serviceRate.GetBitRate () / (requestSize * 8.0);
+          DataRate clientRate ((uint64_t) (load * mue / nClients * packetSize * 8));
+
+          uint16_t port = 9;
+          UdpEchoServerHelper echoServer (port);
+          echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+          echoServer.SetAttribute ("NumClasses", UintegerValue (classes));
+          echoServer.SetAttribute ("CacheSize", UintegerValue (atoi (size.c_str ())));
+          echoServer.SetAttribute ("CachePolicy", StringValue (policy));
+          echoServer.SetAttribute ("CacheHitCost", DoubleValue (hitCost));
+          echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer serverApp = echoServer.Install (server);
+          serverApp.Start (Seconds (0.0));
+          serverApp.Stop (Seconds (simTime + 1.0));
+          Ptr<UdpEchoServer> echoServerApp = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+
+          EchoSketch rtt;
+          std::vector<EchoSketch> classRtt (classes);
+          for (uint32_t i = 0; i < nClients; i++)
+            {
+              UdpEchoClientHelper echoClient (serverAddress, port);
+              echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+              echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+              echoClient.SetAttribute ("Id", UintegerValue (i));
+              echoClient.SetAttribute ("TrafficClass", UintegerValue (i % classes));
+              echoClient.SetAttribute ("KeyDistribution", StringValue (keys));
+              echoClient.SetAttribute ("NumKeys", UintegerValue (numKeys));
+              echoClient.SetAttribute ("ZipfExponent", DoubleValue (atof (exponent.c_str ())));
+              echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+              ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+              clientApp.Start (Seconds ((double) i / nClients));
+              clientApp.Stop (Seconds (simTime + 1.0));
+              clientApp.Get (0)->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&RecordRtt, &rtt));
+              clientApp.Get (0)->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&RecordRtt, &classRtt[i % classes]));
+            }
+
+          Simulator::Stop (Seconds (simTime));
+          Simulator::Run ();
+
+          std::ostringstream classHitRatio;
+          std::ostringstream classP99;
+          for (uint32_t c = 0; c < classes; c++)
+            {
+              classHitRatio << (c ? ":" : "") << echoServerApp->GetCacheHitRatio (c);
+              classP99 << (c ? ":" : "") << classRtt[c].GetQuantile (0.99);
+            }
+          double hitRatio = echoServerApp->GetCache ().GetHitRatio ();
+          std::cout << exponent << "," << size << "," << hitRatio << ","
+                    << 1.0 / (hitRatio * hitCost + 1.0 - hitRatio) << "," << rtt.GetCount () / simTime << ","
+                    << rtt.GetQuantile (0.50) << "," << rtt.GetQuantile (0.99) << ","
+                    << classHitRatio.str () << "," << classP99.str () << std::endl;
+
+          Simulator::Destroy ();
+        }
+    }
+  return 0;
+}
@@ -15,6 +15,9 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
+#include <algorithm>
+#include <cmath>
+
 #include "ns3/log.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
@@ -26,10 +29,15 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/data-rate.h"
 #include "ns3/trace-source-accessor.h"
 #include "udp-echo-client.h"
 
 #include "ns3/comm-header.h"
+#include "echo-trace.h"
 
 namespace ns3 {
 
@@ -71,8 +79,123 @@ UdpEchoClient::GetTypeId (void)
                    UintegerValue (0),
                    MakeUintegerAccessor (&UdpEchoClient::m_id),
                    MakeUintegerChecker<uint32_t> ())                     
+    .AddAttribute ("TrafficClass", 
+                   "The traffic class (priority) of the requests, 0 being the highest",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoClient::m_trafficClass),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("DataRate", 
+                   "The mean offered load; requests leave with exponential inter-send times",
+                   DataRateValue (DataRate ("1Mbps")),
+                   MakeDataRateAccessor (&UdpEchoClient::m_rate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("HedgeAddress",
+                   "The second server the hedged requests are sent to (unset disables the hedging)",
+                   AddressValue (),
+                   MakeAddressAccessor (&UdpEchoClient::m_hedgeAddress),
+                   MakeAddressChecker ())
+    .AddAttribute ("HedgeDelay",
+                   "Time after which an unanswered request is hedged",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&UdpEchoClient::m_hedgeDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("HedgePercentile",
+                   "If positive, hedge after this percentile of the primary server RTTs "
+                   "instead of HedgeDelay (once enough RTTs are known)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&UdpEchoClient::m_hedgePercentile),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("HedgeWindow",
+                   "Number of outstanding requests tracked for the hedging",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&UdpEchoClient::m_hedgeWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RateControl",
+                   "How the send rate is adapted to the RTT inflation and the losses",
+                   EnumValue (UdpEchoClient::RATE_FIXED),
+                   MakeEnumAccessor (&UdpEchoClient::m_rateControl),
+                   MakeEnumChecker (UdpEchoClient::RATE_FIXED, "Fixed",
+                                    UdpEchoClient::RATE_AIMD, "Aimd",
+                                    UdpEchoClient::RATE_DELAY, "Delay"))
+    .AddAttribute ("ControlInterval",
+                   "Time between two updates of the send rate",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&UdpEchoClient::m_controlInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("AdditiveIncrease",
+                   "Rate added per interval without congestion",
+                   DataRateValue (DataRate ("10kbps")),
+                   MakeDataRateAccessor (&UdpEchoClient::m_additiveIncrease),
+                   MakeDataRateChecker ())
+    .AddAttribute ("DecreaseFactor",
+                   "Rate multiplier on a loss (and on RTT inflation in Aimd mode); "
+                   "the largest decrease in Delay mode",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&UdpEchoClient::m_decreaseFactor),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("RttTarget",
+                   "Mean RTT of an interval over the lowest RTT above which the rate is decreased",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&UdpEchoClient::m_rttTarget),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("DelayGain",
+                   "Gain of the decrease in Delay mode: the rate is multiplied by "
+                   "1 - DelayGain * (inflation - RttTarget) / inflation",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&UdpEchoClient::m_delayGain),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("LossTimeout",
+                   "Time after which an unanswered request counts as lost for the rate control",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&UdpEchoClient::m_lossTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinRate",
+                   "Lowest send rate of the rate control",
+                   DataRateValue (DataRate ("1kbps")),
+                   MakeDataRateAccessor (&UdpEchoClient::m_minRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("MaxRate",
+                   "Highest send rate of the rate control",
+                   DataRateValue (DataRate ("1Gbps")),
+                   MakeDataRateAccessor (&UdpEchoClient::m_maxRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("KeyDistribution",
+                   "How the keys of the requests (for the server cache) are drawn",
+                   EnumValue (UdpEchoClient::KEYS_NONE),
+                   MakeEnumAccessor (&UdpEchoClient::m_keyDistribution),
+                   MakeEnumChecker (UdpEchoClient::KEYS_NONE, "None",
+                                    UdpEchoClient::KEYS_UNIFORM, "Uniform",
+                                    UdpEchoClient::KEYS_ZIPF, "Zipf"))
+    .AddAttribute ("NumKeys",
+                   "Number of distinct keys",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&UdpEchoClient::m_numKeys),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ZipfExponent",
+                   "Exponent s of the Zipf popularity of the keys",
+                   DoubleValue (0.99),
+                   MakeDoubleAccessor (&UdpEchoClient::m_zipfExponent),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("ReassemblyWindow",
+                   "Number of fragmented replies tracked for the time to the last byte",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&UdpEchoClient::m_reassemblyWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PrintStats",
+                   "Print the statistics of the client when it stops",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&UdpEchoClient::m_printStats),
+                   MakeBooleanChecker ())
     .AddTraceSource ("Tx", "A new packet is created and is sent",
-                     MakeTraceSourceAccessor (&UdpEchoClient::m_txTrace))                   
+                     MakeTraceSourceAccessor (&UdpEchoClient::m_txTrace))
+    .AddTraceSource ("Rtt", "The round trip time of a received reply",
+                     MakeTraceSourceAccessor (&UdpEchoClient::m_rttTrace))                   
+    .AddTraceSource ("Hedge", "The hedged copy of a request is sent to the second server",
+                     MakeTraceSourceAccessor (&UdpEchoClient::m_hedgeTrace))
+    .AddTraceSource ("Rate", "The send rate (bit/s) set by the rate control",
+                     MakeTraceSourceAccessor (&UdpEchoClient::m_sendRate))
+    .AddTraceSource ("Ttlb", "The time to the last byte of a complete reply",
+                     MakeTraceSourceAccessor (&UdpEchoClient::m_ttlbTrace))
   ;
   return tid;
 }
@@ -86,6 +209,33 @@ UdpEchoClient::UdpEchoClient ()
   m_sendEvent = EventId ();
   m_data = 0;
   m_dataSize = 0;
+  m_trafficClass = 0;
+  m_printStats = true;
+  m_hedgePercentile = 0.0;
+  m_hedgeWindow = 4096;
+  m_hedged = 0;
+  m_hedgeWins = 0;
+  m_duplicates = 0;
+  m_rateControl = RATE_FIXED;
+  m_decreaseFactor = 0.5;
+  m_rttTarget = 2.0;
+  m_delayGain = 0.8;
+  m_sendRate = 0.0;
+  m_intervalRttSum = 0.0;
+  m_intervalReplies = 0;
+  m_intervalSent = 0;
+  m_intervalLosses = 0;
+  m_oldestRequest = 0;
+  m_rateDecreases = 0;
+  m_rateUpdates = 0;
+  m_rateSum = 0.0;
+  m_keyDistribution = KEYS_NONE;
+  m_numKeys = 1000;
+  m_zipfExponent = 0.99;
+  m_reassemblyWindow = 4096;
+  m_fragmentedReplies = 0;
+  m_fragmentsReceived = 0;
+  m_incompleteReplies = 0;
   
   m_Mue = 0.0;
   m_serviceRate = 0.0;
@@ -97,6 +247,7 @@ UdpEchoClient::~UdpEchoClient()
 {
   NS_LOG_FUNCTION (this);
   m_socket = 0;
+  m_hedgeSocket = 0;
 
   delete [] m_data;
   m_data = 0;
@@ -127,6 +278,46 @@ UdpEchoClient::SetRemote (Ipv6Address ip, uint16_t port)
   m_peerPort = port;
 }
 
+int64_t
+UdpEchoClient::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_rng->SetStream (stream);
+  return 1;
+}
+
+DataRate
+UdpEchoClient::GetSendRate (void) const
+{
+  return DataRate ((uint64_t) m_sendRate.Get ());
+}
+
+const EchoSketch &
+UdpEchoClient::GetTtfb (void) const
+{
+  return m_ttfbSketch;
+}
+
+const EchoSketch &
+UdpEchoClient::GetTtlb (void) const
+{
+  return m_ttlbSketch;
+}
+
+uint32_t
+UdpEchoClient::GetIncompleteReplies (void) const
+{
+  uint32_t incomplete = m_incompleteReplies;
+  for (uint32_t i = 0; i < m_fragments.size (); i++)
+    {
+      if (m_fragments[i].valid && m_fragments[i].received < m_fragments[i].count)
+        {
+          incomplete++;
+        }
+    }
+  return incomplete;
+}
+
 void
 UdpEchoClient::DoDispose (void)
 {
@@ -141,22 +332,50 @@ UdpEchoClient::StartApplication (void)
 
   if (m_socket == 0)
     {
-      TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
-      m_socket = Socket::CreateSocket (GetNode (), tid);
-      if (Ipv4Address::IsMatchingType(m_peerAddress) == true)
+      m_socket = OpenSocket (m_peerAddress);
+    }
+  m_socket->SetRecvCallback (MakeCallback (&UdpEchoClient::HandleRead, this));
+
+  if (!m_hedgeAddress.IsInvalid () && m_hedgeSocket == 0)
+    {
+      m_hedgeSocket = OpenSocket (m_hedgeAddress);
+      m_hedgeSocket->SetRecvCallback (MakeCallback (&UdpEchoClient::HandleRead, this));
+      m_outstanding.assign (m_hedgeWindow, OutstandingRequest ());
+      m_currentHedgeDelay = m_hedgeDelay;
+    }
+
+  m_sendRate = m_rate.GetBitRate ();
+  if (m_rateControl != RATE_FIXED)
+    {
+      m_baseRtt = Time ();
+      m_intervalRttSum = 0.0;
+      m_intervalReplies = 0;
+      m_intervalSent = 0;
+      m_intervalLosses = 0;
+      m_controlRequests.clear ();
+      m_oldestRequest = m_sent;
+      m_controlEvent = Simulator::Schedule (m_controlInterval, &UdpEchoClient::UpdateRate, this);
+    }
+
+  m_fragments.assign (m_reassemblyWindow, ReplyFragments ());
+
+  m_keyCdf.clear ();
+  if (m_keyDistribution == KEYS_ZIPF)
+    {
+      // drawn by inversion with the same stream as the inter-send times
+      m_keyCdf.resize (m_numKeys);
+      double sum = 0.0;
+      for (uint32_t k = 0; k < m_numKeys; k++)
         {
-          m_socket->Bind();
-          m_socket->Connect (InetSocketAddress (Ipv4Address::ConvertFrom(m_peerAddress), m_peerPort));
+          sum += 1.0 / std::pow (k + 1.0, m_zipfExponent);
+          m_keyCdf[k] = sum;
         }
-      else if (Ipv6Address::IsMatchingType(m_peerAddress) == true)
+      for (uint32_t k = 0; k < m_numKeys; k++)
         {
-          m_socket->Bind6();
-          m_socket->Connect (Inet6SocketAddress (Ipv6Address::ConvertFrom(m_peerAddress), m_peerPort));
+          m_keyCdf[k] /= sum;
         }
     }
 
-  m_socket->SetRecvCallback (MakeCallback (&UdpEchoClient::HandleRead, this));
-
   //ScheduleTransmit (Seconds (0.));
   ScheduleTransmitRand ();
 }
@@ -172,9 +391,44 @@ UdpEchoClient::StopApplication ()
       m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
       m_socket = 0;
     }
+  if (m_hedgeSocket != 0) 
+    {
+      m_hedgeSocket->Close ();
+      m_hedgeSocket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      m_hedgeSocket = 0;
+    }
+  for (uint32_t i = 0; i < m_outstanding.size (); i++)
+    {
+      Simulator::Cancel (m_outstanding[i].hedgeEvent);
+    }
 
-  std::cout << m_id << ": sent: " << m_sent << " and received: " << m_received << " number of packets and the Average RTT is " << m_AvgTime <<std::endl;
+  if (m_printStats)
+    {
+      std::cout << m_id << ": sent: " << m_sent << " and received: " << m_received << " number of packets and the Average RTT is " << m_AvgTime <<std::endl;
+      if (!m_outstanding.empty ())
+        {
+          PrintHedgeStats ();
+        }
+      if (m_rateControl != RATE_FIXED)
+        {
+          std::cout << m_id << ": rate: " << m_sendRate << 
+                       " mean rate: " << (m_rateUpdates ? m_rateSum / m_rateUpdates : 0.0) << 
+                       " decreases: " << m_rateDecreases << " of " << m_rateUpdates << " updates" <<
+                       " base rtt: " << m_baseRtt.GetSeconds () << std::endl;
+        }
+      if (m_fragmentedReplies != 0)
+        {
+          std::cout << m_id << ": fragmented replies: " << m_fragmentedReplies << 
+                       " fragments: " << m_fragmentsReceived << 
+                       " incomplete: " << GetIncompleteReplies () << 
+                       " ttfb p50/p99: " << m_ttfbSketch.GetQuantile (0.50) << 
+                       " " << m_ttfbSketch.GetQuantile (0.99) << 
+                       " ttlb p50/p99: " << m_ttlbSketch.GetQuantile (0.50) << 
+                       " " << m_ttlbSketch.GetQuantile (0.99) << std::endl;
+        }
+    }
   Simulator::Cancel (m_sendEvent);
+  Simulator::Cancel (m_controlEvent);
   Simulator::Cancel (m_statEvent);
 }
 
@@ -293,7 +547,8 @@ UdpEchoClient::ScheduleTransmitRand (void)
 {
   NS_LOG_FUNCTION (this);
   
-	m_serviceRate = 1000000.0; // 10Mbps
+	// 1Mbps by default, or the rate the rate control settled on
+	m_serviceRate = (m_rateControl == RATE_FIXED) ? m_rate.GetBitRate () : m_sendRate.Get ();
 	double randValue = m_rng->GetValue (0.0, 1.0);
 	
 	m_Mue = m_serviceRate / (m_size * 8.0);	
@@ -304,12 +559,25 @@ UdpEchoClient::ScheduleTransmitRand (void)
   m_sendEvent = Simulator::Schedule (t_reSchedule, &UdpEchoClient::ScheduleTransmitRand, this);
 }
 
-void 
-UdpEchoClient::Send (void)
+uint32_t
+UdpEchoClient::NextKey (void)
 {
-  NS_LOG_FUNCTION (this);
+  switch (m_keyDistribution)
+    {
+    case KEYS_UNIFORM:
+      return m_rng->GetInteger (1, m_numKeys);
+    case KEYS_ZIPF:
+      return std::lower_bound (m_keyCdf.begin (), m_keyCdf.end () - 1,
+                               m_rng->GetValue (0.0, 1.0)) - m_keyCdf.begin () + 1;
+    default:
+      return 0;
+    }
+}
 
-  //NS_ASSERT (m_sendEvent.IsExpired ());
+Ptr<Packet> 
+UdpEchoClient::CreateRequest (void)
+{
+  NS_LOG_FUNCTION (this);
 
   Ptr<Packet> p;
   
@@ -318,6 +586,9 @@ UdpEchoClient::Send (void)
   hdr.SetSentTime (Simulator::Now ());
   hdr.SetPacketType (CommHeader::REQ_PACKET);
   hdr.SetPacketAnalyzed (CommHeader::PACKET_NOTANALYZED);
+  hdr.SetTrafficClass (m_trafficClass);
+  hdr.SetSequenceNumber (m_sent);
+  hdr.SetKey (NextKey ());
 
   if (m_dataSize)
     {
@@ -345,25 +616,51 @@ UdpEchoClient::Send (void)
     
   // Add the communication header to the packet
   p->AddHeader (hdr);
+  return p;
+}
+
+void 
+UdpEchoClient::Send (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  //NS_ASSERT (m_sendEvent.IsExpired ());
+
+  Ptr<Packet> p = CreateRequest ();
   
   // call to the trace sinks before the packet is actually sent,
   // so that tags added to the packet can be sent as well
   m_txTrace (p);
-  m_socket->Send (p);
-
-  ++m_sent;
-
-  if (Ipv4Address::IsMatchingType (m_peerAddress))
+  
+  if (!m_outstanding.empty ())
     {
-      NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s client sent " << m_size << " bytes to " <<
-                   Ipv4Address::ConvertFrom (m_peerAddress) << " port " << m_peerPort);
+      // keep a copy to hedge; an older request in the slot is given up
+      OutstandingRequest &request = m_outstanding[m_sent % m_outstanding.size ()];
+      Simulator::Cancel (request.hedgeEvent);
+      request.seq = m_sent;
+      request.valid = true;
+      request.answered = false;
+      request.hedged = false;
+      request.hedgeWon = false;
+      request.duplicate = false;
+      request.packet = p->Copy ();
+      request.hedgeEvent = Simulator::Schedule (m_currentHedgeDelay, &UdpEchoClient::SendHedge, this, m_sent);
     }
-  else if (Ipv6Address::IsMatchingType (m_peerAddress))
+  
+  if (m_rateControl != RATE_FIXED)
     {
-      NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s client sent " << m_size << " bytes to " <<
-                   Ipv6Address::ConvertFrom (m_peerAddress) << " port " << m_peerPort);
+      ControlRequest request;
+      request.sent = Simulator::Now ();
+      m_controlRequests.push_back (request);
     }
 
+  m_socket->Send (p);
+
+  ++m_sent;
+  ++m_intervalSent;
+
+  ECHO_TRACE (ECHO_TRACE_CLIENT_TX, GetNode ()->GetId (), 0, p->GetSize (), m_sent - 1);
+
 // dissabled to introduse random packet genaration based on Poisson Distribution.
 //  if (m_sent < m_count) 
 //    {
@@ -386,15 +683,39 @@ UdpEchoClient::HandleRead (Ptr<Socket> socket)
           
           // Remove the communication header          
           packet->RemoveHeader (oldHdr);
-
-          NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << 
-                       "s client received " << packet->GetSize () << 
-                       " bytes from " <<
-                       InetSocketAddress::ConvertFrom (from).GetIpv4 () << 
-                       " port " <<
-                       InetSocketAddress::ConvertFrom (from).GetPort ());
+          Time rtt = Simulator::Now () - oldHdr.GetSentTime ();
+
+          // the hedged copies are told apart before the fragments, so
+          // only the copy which won is reassembled
+          if (!m_outstanding.empty () && !AcceptReply (socket, oldHdr))
+            {
+              // the duplicate reply of a hedged request
+              m_received --;
+              continue;
+            }
+
+          if (oldHdr.GetFragmentCount () > 1 && !AcceptFragment (oldHdr))
+            {
+              // a later fragment of a reply
+              m_received --;
+              continue;
+            }
+
+          ECHO_TRACE (ECHO_TRACE_CLIENT_RX, GetNode ()->GetId (), 0,
+                      packet->GetSize () + oldHdr.GetSerializedSize (), oldHdr.GetSequenceNumber ());
 
           m_AvgTime = ((m_AvgTime * (m_received - 1)) + (Simulator::Now ().GetSeconds () - oldHdr.GetSentTime ().GetSeconds ())) /  m_received;
+          m_rttTrace (rtt);
+          m_ttfbSketch.Add (rtt.GetSeconds ());
+          if (oldHdr.GetFragmentCount () <= 1)
+            {
+              m_ttlbSketch.Add (rtt.GetSeconds ());
+              m_ttlbTrace (rtt);
+            }
+          if (m_rateControl != RATE_FIXED)
+            {
+              RecordControlSample (oldHdr.GetSequenceNumber (), Simulator::Now () - oldHdr.GetSentTime ());
+            }
 
 //          std::cout << m_id << ": RTT is: " << 
 //                        (Simulator::Now ().GetSeconds () - oldHdr.GetSentTime ().GetSeconds ()) <<
@@ -408,9 +729,12 @@ UdpEchoClient::HandleRead (Ptr<Socket> socket)
       else if (Inet6SocketAddress::IsMatchingType (from))
         {
           m_received ++;
-          NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s client received " << packet->GetSize () << " bytes from " <<
-                       Inet6SocketAddress::ConvertFrom (from).GetIpv6 () << " port " <<
-                       Inet6SocketAddress::ConvertFrom (from).GetPort ());
+          if (EchoTrace::IsEnabled ())
+            {
+              packet->PeekHeader (oldHdr);
+              EchoTrace::Record (ECHO_TRACE_CLIENT_RX, GetNode ()->GetId (), 0,
+                                 packet->GetSize (), oldHdr.GetSequenceNumber ());
+            }
         }
     }
     
@@ -421,6 +745,250 @@ UdpEchoClient::HandleRead (Ptr<Socket> socket)
     }
 }
 
+Ptr<Socket>
+UdpEchoClient::OpenSocket (Address peer)
+{
+  NS_LOG_FUNCTION (this << peer);
+
+  TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+  Ptr<Socket> socket = Socket::CreateSocket (GetNode (), tid);
+  if (Ipv4Address::IsMatchingType(peer) == true)
+    {
+      socket->Bind();
+      socket->Connect (InetSocketAddress (Ipv4Address::ConvertFrom(peer), m_peerPort));
+    }
+  else if (Ipv6Address::IsMatchingType(peer) == true)
+    {
+      socket->Bind6();
+      socket->Connect (Inet6SocketAddress (Ipv6Address::ConvertFrom(peer), m_peerPort));
+    }
+  return socket;
+}
+
+void
+UdpEchoClient::SendHedge (uint32_t seq)
+{
+  NS_LOG_FUNCTION (this << seq);
+
+  OutstandingRequest &request = m_outstanding[seq % m_outstanding.size ()];
+  if (!request.valid || request.seq != seq || request.answered)
+    {
+      return;
+    }
+  
+  // the copy keeps the sent time of the original request, so the RTT is
+  // the one the user of the client sees
+  Ptr<Packet> p = request.packet;
+  request.packet = 0;
+  request.hedged = true;
+  m_hedgeTrace (p);
+  m_hedgeSocket->Send (p);
+  m_hedged++;
+
+  ECHO_TRACE (ECHO_TRACE_CLIENT_TX, GetNode ()->GetId (), 1, p->GetSize (), seq);
+}
+
+bool
+UdpEchoClient::AcceptFragment (const CommHeader &hdr)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_fragmentsReceived++;
+  ReplyFragments &slot = m_fragments[hdr.GetSequenceNumber () % m_fragments.size ()];
+  if (!slot.valid || slot.seq != hdr.GetSequenceNumber ())
+    {
+      if (slot.valid && slot.received < slot.count)
+        {
+          m_incompleteReplies++;
+        }
+      slot.seq = hdr.GetSequenceNumber ();
+      slot.count = hdr.GetFragmentCount ();
+      slot.received = 1;
+      slot.valid = true;
+      slot.seen.assign (slot.count, false);
+      slot.seen[hdr.GetFragmentIndex () % slot.count] = true;
+      m_fragmentedReplies++;
+      return true;
+    }
+
+  // Only the copy of a hedged request which won gets here, but an index
+  // counts once and a fragment of another reply size is ignored anyway.
+  if (hdr.GetFragmentCount () != slot.count || hdr.GetFragmentIndex () >= slot.count ||
+      slot.seen[hdr.GetFragmentIndex ()])
+    {
+      return false;
+    }
+  slot.seen[hdr.GetFragmentIndex ()] = true;
+  if (++slot.received == slot.count)
+    {
+      Time ttlb = Simulator::Now () - hdr.GetSentTime ();
+      m_ttlbSketch.Add (ttlb.GetSeconds ());
+      m_ttlbTrace (ttlb);
+    }
+  return false;
+}
+
+bool
+UdpEchoClient::AcceptReply (Ptr<Socket> socket, CommHeader &hdr)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  // A reply may be fragmented: the copy whose first packet arrives first
+  // wins and its later fragments go on to the reassembly, while the other
+  // copy is one duplicate however many fragments it has.
+  Time rtt = Simulator::Now () - hdr.GetSentTime ();
+  OutstandingRequest &request = m_outstanding[hdr.GetSequenceNumber () % m_outstanding.size ()];
+  bool tracked = request.valid && request.seq == hdr.GetSequenceNumber ();
+  bool fromHedge = (socket == m_hedgeSocket);
+  bool won = !tracked || !request.answered || request.hedgeWon == fromHedge;
+  bool first = !tracked || !request.answered || (!won && !request.duplicate);
+
+  if (first && !fromHedge)
+    {
+      // the primary RTTs are the RTTs without hedging; they set the delay
+      m_primaryRttSketch.Add (rtt.GetSeconds ());
+      if (m_hedgePercentile > 0.0 && m_primaryRttSketch.GetCount () >= 100 &&
+          m_primaryRttSketch.GetCount () % 64 == 0)
+        {
+          m_currentHedgeDelay = Seconds (m_primaryRttSketch.GetQuantile (m_hedgePercentile));
+        }
+    }
+
+  if (!won)
+    {
+      if (first)
+        {
+          request.duplicate = true;
+          m_duplicates++;
+        }
+      return false;
+    }
+  if (tracked && !request.answered)
+    {
+      request.answered = true;
+      request.hedgeWon = fromHedge;
+      request.packet = 0;
+      Simulator::Cancel (request.hedgeEvent);
+      if (fromHedge)
+        {
+          m_hedgeWins++;
+        }
+    }
+  if (first)
+    {
+      m_rttSketch.Add (rtt.GetSeconds ());
+    }
+  return true;
+}
+
+void
+UdpEchoClient::PrintHedgeStats (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Without hedging the primary server would have answered every request,
+  // so its RTTs are the baseline. The hedges load the servers as well, so 
+  // the baseline is somewhat pessimistic.
+  double rate = m_sent ? (double) m_hedged / m_sent : 0.0;
+  std::cout << m_id << ": hedged: " << m_hedged << 
+               " hedge rate / extra load: " << rate * 100 << "%" <<
+               " hedge delay: " << m_currentHedgeDelay.GetSeconds () <<
+               " hedge wins: " << m_hedgeWins << 
+               " duplicates: " << m_duplicates << 
+               " rtt p99/p99.9: " << m_rttSketch.GetQuantile (0.99) << 
+               " " << m_rttSketch.GetQuantile (0.999) << 
+               " primary rtt p99/p99.9: " << m_primaryRttSketch.GetQuantile (0.99) << 
+               " " << m_primaryRttSketch.GetQuantile (0.999) << std::endl;
+}
+
+void
+UdpEchoClient::RecordControlSample (uint32_t seq, Time rtt)
+{
+  NS_LOG_FUNCTION (this << seq << rtt);
+
+  if (m_baseRtt.IsZero () || rtt < m_baseRtt)
+    {
+      m_baseRtt = rtt;
+    }
+  m_intervalRttSum += rtt.GetSeconds ();
+  m_intervalReplies++;
+
+  // Replies are reordered by parallel channels, the classes, the pipeline
+  // and the hedging, so a gap is no loss: the reply marks its request, and
+  // a reply to a request already expired is too late to count.
+  if (seq >= m_oldestRequest && seq - m_oldestRequest < m_controlRequests.size ())
+    {
+      m_controlRequests[seq - m_oldestRequest].answered = true;
+    }
+}
+
+void
+UdpEchoClient::ExpireControlRequests (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time deadline = Simulator::Now () - m_lossTimeout;
+  while (!m_controlRequests.empty () &&
+         (m_controlRequests.front ().answered || m_controlRequests.front ().sent <= deadline))
+    {
+      if (!m_controlRequests.front ().answered)
+        {
+          m_intervalLosses++;
+        }
+      m_controlRequests.pop_front ();
+      m_oldestRequest++;
+    }
+}
+
+void
+UdpEchoClient::UpdateRate (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  ExpireControlRequests ();
+
+  // Requests sent in an interval without any reply were lost or stalled
+  // at an overloaded (or dead) server: a loss. An idle interval keeps the
+  // rate. The ControlInterval should be longer than the RTT.
+  if (m_intervalReplies > 0 || m_intervalSent > 0)
+    {
+      double rate = m_sendRate;
+      double inflation = m_intervalReplies ? (m_intervalRttSum / m_intervalReplies) / m_baseRtt.GetSeconds () : 0.0;
+      if (m_intervalLosses > 0 || m_intervalReplies == 0)
+        {
+          rate *= m_decreaseFactor;
+          m_rateDecreases++;
+        }
+      else if (inflation > m_rttTarget)
+        {
+          if (m_rateControl == RATE_AIMD)
+            {
+              rate *= m_decreaseFactor;
+            }
+          else
+            {
+              rate *= std::max (1.0 - m_delayGain * (inflation - m_rttTarget) / inflation, m_decreaseFactor);
+            }
+          m_rateDecreases++;
+        }
+      else
+        {
+          rate += m_additiveIncrease.GetBitRate ();
+        }
+      rate = std::min (std::max (rate, (double) m_minRate.GetBitRate ()), (double) m_maxRate.GetBitRate ());
+      NS_LOG_LOGIC ("inflation " << inflation << " losses " << m_intervalLosses << " rate " << rate);
+      m_sendRate = rate;
+    }
+  m_rateUpdates++;
+  m_rateSum += m_sendRate;
+
+  m_intervalRttSum = 0.0;
+  m_intervalReplies = 0;
+  m_intervalSent = 0;
+  m_intervalLosses = 0;
+  m_controlEvent = Simulator::Schedule (m_controlInterval, &UdpEchoClient::UpdateRate, this);
+}
+
 void 
 UdpEchoClient::SchedulePrintStat (void)
 {
@@ -19,28 +19,81 @@
 #ifndef UDP_ECHO_CLIENT_H
 #define UDP_ECHO_CLIENT_H
 
+#include <deque>
+#include <vector>
+
 #include "ns3/application.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
+#include "ns3/data-rate.h"
 
 #include "ns3/random-variable-stream.h"
+#include "echo-sketch.h"
 
 namespace ns3 {
 
 class Socket;
 class Packet;
+class CommHeader;
 
 /**
  * \ingroup udpecho
  * \brief A Udp Echo client
  *
  * Every packet sent should be returned by the server and received here.
+ *
+ * With a HedgeAddress set, a request still unanswered after the hedge
+ * delay (a fixed time or a percentile of the RTTs of the primary server)
+ * is sent again to the second server. The first reply wins; the later one
+ * is matched on the sequence number and discarded with all its fragments,
+ * before the fragments of the winner are reassembled.
+ *
+ * With "RateControl" set, the send rate starts at "DataRate" and is
+ * adapted every "ControlInterval" from the RTT inflation (the mean RTT of
+ * the interval over the lowest RTT seen) and the losses (requests still
+ * unanswered after "LossTimeout", whatever the order of the replies): AIMD adds "AdditiveIncrease" or
+ * multiplies the rate by "DecreaseFactor" on congestion, and Delay
+ * decreases it in proportion to how far the inflation exceeds
+ * "RttTarget". The "Rate" trace source follows the send rate.
+ *
+ * With "KeyDistribution" set, every request carries the key of the object
+ * it asks for in its CommHeader, drawn among "NumKeys" keys uniformly or
+ * with Zipf popularity (key 1 being the most popular), for the server
+ * cache.
+ *
+ * A reply the server split in to fragments counts as received with its
+ * first fragment: the "Rtt" trace source and the statistics of the
+ * replies follow the time to the first byte, and the "Ttlb" trace source
+ * the time to the last byte, once all the fragments arrived. A reply in
+ * a single packet has both times equal.
  */
 class UdpEchoClient : public Application 
 {
+  friend class UdpEchoBenchmark;
 public:
+  /**
+   * \brief How the send rate is adapted
+   */
+  enum RateControlMode
+  {
+    RATE_FIXED, //!< send at DataRate
+    RATE_AIMD, //!< additive increase, multiplicative decrease on loss or RTT inflation
+    RATE_DELAY, //!< additive increase, decrease proportional to the RTT inflation
+  };
+
+  /**
+   * \brief How the keys of the requests are drawn
+   */
+  enum KeyDistribution
+  {
+    KEYS_NONE, //!< no key (0), the requests are never cached
+    KEYS_UNIFORM, //!< every key equally likely
+    KEYS_ZIPF, //!< key k drawn with a probability proportional to 1 / k^s
+  };
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -139,6 +192,35 @@ public:
    */
   void SetFill (uint8_t *fill, uint32_t fillSize, uint32_t dataSize);
 
+  /**
+   * \brief Assign a fixed random variable stream number to the random 
+   * variables used by this application
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \return the current send rate
+   */
+  DataRate GetSendRate (void) const;
+
+  /**
+   * \return the times to the first byte of the replies (s)
+   */
+  const EchoSketch &GetTtfb (void) const;
+
+  /**
+   * \return the times to the last byte of the complete replies (s)
+   */
+  const EchoSketch &GetTtlb (void) const;
+
+  /**
+   * \return the number of fragmented replies a fragment of which did not
+   * arrive (yet)
+   */
+  uint32_t GetIncompleteReplies (void) const;
+
 protected:
   virtual void DoDispose (void);
 
@@ -158,6 +240,18 @@ private:
    */
   void ScheduleTransmit (Time dt);  
 
+  /**
+   * \brief Create the next request: the payload and its CommHeader
+   * \return the request packet
+   */
+  Ptr<Packet> CreateRequest (void);
+
+  /**
+   * \brief draw the key of the next request
+   * \return the key, 1 to NumKeys, or 0 without a key distribution
+   */
+  uint32_t NextKey (void);
+
   /**
    * \brief Send a packet
    */
@@ -171,6 +265,59 @@ private:
    * \param socket the socket the packet was received to.
    */
   void HandleRead (Ptr<Socket> socket);
+
+  /**
+   * \brief create a socket connected to a server
+   * \param peer the IPv4 or IPv6 address of the server
+   * \return the socket
+   */
+  Ptr<Socket> OpenSocket (Address peer);
+
+  /**
+   * \brief send the hedged copy of a request if it is still unanswered
+   * \param seq the sequence number of the request
+   */
+  void SendHedge (uint32_t seq);
+
+  /**
+   * \brief account a fragment of a fragmented reply
+   * \param hdr the CommHeader of the fragment
+   * \return true if it is the first fragment of its reply to arrive
+   */
+  bool AcceptFragment (const CommHeader &hdr);
+
+  /**
+   * \brief match a reply with its outstanding request
+   * \param socket the socket the reply was received to
+   * \param hdr the CommHeader of the reply
+   * \return true for a packet (any fragment) of the first reply of the
+   * request, false for the duplicate reply of a hedged request
+   */
+  bool AcceptReply (Ptr<Socket> socket, CommHeader &hdr);
+
+  /**
+   * \brief print the hedging statistics
+   */
+  void PrintHedgeStats (void);
+
+  /**
+   * \brief account a reply for the rate controller
+   * \param seq the sequence number of the reply
+   * \param rtt the round trip time of the reply
+   */
+  void RecordControlSample (uint32_t seq, Time rtt);
+
+  /**
+   * \brief count the requests unanswered for LossTimeout as losses and
+   * forget them and the answered requests in front of them
+   */
+  void ExpireControlRequests (void);
+
+  /**
+   * \brief adapt the send rate to the samples of the last interval and
+   * schedule the next update
+   */
+  void UpdateRate (void);
   
   /**
    * \brief print statistics every 100s time interval
@@ -178,6 +325,7 @@ private:
   void SchedulePrintStat (void);
   
   uint32_t m_id; //!< Aunique ID for this client
+  uint8_t m_trafficClass; //!< traffic class (priority) of the requests
 
   uint32_t m_count; //!< Maximum number of packets the application will send
   Time m_interval; //!< Packet inter-send time
@@ -195,13 +343,109 @@ private:
   double m_AvgTime; //!< Average RTT
   EventId m_statEvent; //!< Event to print the statistics 
   bool m_statStarted; //!< initialized the statistics printing process   
+  bool m_printStats; //!< print the statistics when the application stops
 
   /// Callbacks for tracing the packet Tx events
   TracedCallback<Ptr<const Packet> > m_txTrace;
+
+  /// Callbacks for tracing the round trip time of every reply
+  TracedCallback<Time> m_rttTrace;
   
   double m_Mue; //!< the Mue of the client
   double m_serviceRate; //!< service rate of the client
+  DataRate m_rate; //!< mean offered load
   Ptr<UniformRandomVariable> m_rng; //!< Rng stream.  
+
+  /**
+   * \brief a request which may be hedged
+   */
+  struct OutstandingRequest
+  {
+    OutstandingRequest () : seq (0), valid (false), answered (false), hedged (false),
+                            hedgeWon (false), duplicate (false) {}
+    uint32_t seq; //!< sequence number of the request
+    bool valid; //!< the slot holds a request
+    bool answered; //!< a reply was received
+    bool hedged; //!< the hedged copy was sent
+    bool hedgeWon; //!< the reply came from the second server
+    bool duplicate; //!< a packet of the other copy was received
+    Ptr<Packet> packet; //!< copy of the request, until it is hedged or answered
+    EventId hedgeEvent; //!< Event to send the hedged copy
+  };
+
+  Address m_hedgeAddress; //!< the second server (unset disables the hedging)
+  Time m_hedgeDelay; //!< fixed hedge delay
+  double m_hedgePercentile; //!< hedge after this RTT percentile if positive
+  uint32_t m_hedgeWindow; //!< number of outstanding requests tracked
+  Ptr<Socket> m_hedgeSocket; //!< socket connected to the second server
+  std::vector<OutstandingRequest> m_outstanding; //!< outstanding requests by sequence number modulo the window
+  Time m_currentHedgeDelay; //!< the hedge delay in use
+  EchoSketch m_rttSketch; //!< RTTs of the first replies
+  EchoSketch m_primaryRttSketch; //!< RTTs of all the replies of the primary server
+  uint32_t m_hedged; //!< number of hedged requests
+  uint32_t m_hedgeWins; //!< number of requests the second server answered first
+  uint32_t m_duplicates; //!< number of discarded duplicate replies
+  TracedCallback<Ptr<const Packet> > m_hedgeTrace; //!< hedged copies sent
+
+  RateControlMode m_rateControl; //!< how the send rate is adapted
+  Time m_controlInterval; //!< period of the rate updates
+  DataRate m_additiveIncrease; //!< rate added per interval without congestion
+  double m_decreaseFactor; //!< rate multiplier on loss (and on inflation in AIMD mode)
+  double m_rttTarget; //!< RTT inflation above which the rate is decreased
+  double m_delayGain; //!< gain of the decrease in Delay mode
+  DataRate m_minRate; //!< lowest send rate
+  DataRate m_maxRate; //!< highest send rate
+  TracedValue<double> m_sendRate; //!< current send rate (bit/s)
+  EventId m_controlEvent; //!< Event to update the send rate
+  Time m_baseRtt; //!< lowest RTT seen
+  double m_intervalRttSum; //!< sum of the RTTs of the interval (s)
+  uint32_t m_intervalReplies; //!< replies of the interval
+  uint32_t m_intervalSent; //!< requests sent in the interval
+  uint32_t m_intervalLosses; //!< requests expired unanswered in the interval
+
+  /**
+   * \brief a request tracked by the rate controller
+   */
+  struct ControlRequest
+  {
+    ControlRequest () : answered (false) {}
+    Time sent; //!< send time
+    bool answered; //!< a reply was received
+  };
+
+  Time m_lossTimeout; //!< time after which an unanswered request is lost
+  std::deque<ControlRequest> m_controlRequests; //!< requests in sequence number order, from m_oldestRequest
+  uint32_t m_oldestRequest; //!< sequence number of the front of m_controlRequests
+  uint32_t m_rateDecreases; //!< number of rate decreases
+  uint32_t m_rateUpdates; //!< number of rate updates
+  double m_rateSum; //!< sum of the rates after the updates (bit/s)
+
+  KeyDistribution m_keyDistribution; //!< how the keys of the requests are drawn
+  uint32_t m_numKeys; //!< number of distinct keys
+  double m_zipfExponent; //!< exponent s of the Zipf popularity
+  std::vector<double> m_keyCdf; //!< cumulative Zipf probabilities of the keys 1, 2, ...
+
+  /**
+   * \brief the fragments of a reply received so far
+   */
+  struct ReplyFragments
+  {
+    ReplyFragments () : seq (0), received (0), count (0), valid (false) {}
+    uint32_t seq; //!< sequence number of the reply
+    uint16_t received; //!< distinct fragments received
+    uint16_t count; //!< fragments of the reply
+    bool valid; //!< the slot holds a reply
+    std::vector<bool> seen; //!< the fragment indices received
+  };
+
+  uint32_t m_reassemblyWindow; //!< number of fragmented replies tracked
+  std::vector<ReplyFragments> m_fragments; //!< fragmented replies by sequence number modulo the window
+  EchoSketch m_ttfbSketch; //!< times to the first byte (s)
+  EchoSketch m_ttlbSketch; //!< times to the last byte (s)
+  TracedCallback<Time> m_ttlbTrace; //!< time to the last byte of every complete reply
+  uint32_t m_fragmentedReplies; //!< replies received in more than one fragment
+  uint32_t m_fragmentsReceived; //!< fragments of those replies
+  uint32_t m_incompleteReplies; //!< fragmented replies evicted from the window incomplete
 };
 
 } // namespace ns3
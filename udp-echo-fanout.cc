@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Tail amplification of fan-out request trees.
+ *
+ * nClients clients send their requests to an aggregator server, which
+ * fans every request out to K backend servers and replies once the
+ * quorum of them answered (all of them by default). Every backend sees
+ * the whole request stream, so its utilization is rho whatever K is. The
+ * program runs once per K of the list and prints one CSV line each: the
+ * backend (sub-request) RTT p99, the aggregator fan-out p50/p99/p99.9,
+ * the p99 amplification and the client RTT p99/p99.9, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-fanout --fanOut=1,2,4,8,16,32 --rho=0.5"
+ *   ./waf --run "scratch/udp-echo-fanout --fanOut=16 --quorum=15 --timeout=0.05"
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-stats-collector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoFanOut");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  std::string fanOutList = "1,2,4,8,16";
+  uint32_t quorum = 0;
+  double timeout = 0.0;
+  double rho = 0.5;
+  double simTime = 100.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("fanOut", "Comma separated numbers of backends", fanOutList);
+  cmd.AddValue ("quorum", "Sub-replies completing a request (0: all)", quorum);
+  cmd.AddValue ("timeout", "Fan-out timeout (s, 0: none)", timeout);
+  cmd.AddValue ("rho", "Utilization of every backend", rho);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  std::cout << "fan_out,quorum,sub_p99,fan_out_p50,fan_out_p99,fan_out_p999,p99_amplification,"
+               "rtt_p99,rtt_p999,timeout_rate" << std::endl;
+
+  std::istringstream list (fanOutList);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      uint32_t fanOut = std::max (atoi (item.c_str ()), 1);
+      RngSeedManager::SetRun (run);
+
+      NodeContainer hub;
+      hub.Create (1);
+      NodeContainer aggregator;
+      aggregator.Create (1);
+      NodeContainer backends;
+      backends.Create (fanOut);
+      NodeContainer clients;
+      clients.Create (nClients);
+
+      InternetStackHelper internet;
+      internet.Install (hub);
+      internet.Install (aggregator);
+      internet.Install (backends);
+      internet.Install (clients);
+
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("10Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("50us"));
+
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4StaticRoutingHelper staticRouting;
+      std::vector<Ipv4Address> addresses;
+      NodeContainer spokes (aggregator, backends);
+      spokes.Add (clients);
+      for (uint32_t i = 0; i < spokes.GetN (); i++)
+        {
+          NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+          Ipv4InterfaceContainer interfaces = address.Assign (devices);
+          address.NewNetwork ();
+          Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+          routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+          addresses.push_back (interfaces.GetAddress (1));
+        }
+
+      // every backend serves the whole request stream at rho
+      uint32_t packetSize = 100;
+      uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+      DataRate serviceRate ("10Mbps");
+      double lambda = rho * serviceRate.GetBitRate () / (requestSize * 8.0) / nClients;
+      DataRate clientRate ((uint64_t) (lambda * packetSize * 8));
+
+      uint16_t port = 9;
+      UdpEchoServerHelper backendServer (port);
+      backendServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+      backendServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer backendApps = backendServer.Install (backends);
+      backendApps.Start (Seconds (0.0));
+      backendApps.Stop (Seconds (simTime + 1.0));
+
+      // the aggregator itself is fast: the latency is set by the backends
+      UdpEchoServerHelper aggregatorServer (port);
+      aggregatorServer.SetAttribute ("ServiceRate", DataRateValue (DataRate ("10Gbps")));
+      aggregatorServer.SetAttribute ("Quorum", UintegerValue (quorum));
+      aggregatorServer.SetAttribute ("FanOutTimeout", TimeValue (Seconds (timeout)));
+      aggregatorServer.SetAttribute ("MaxPending", UintegerValue (65536));
+      aggregatorServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer aggregatorApp = aggregatorServer.Install (aggregator);
+      Ptr<UdpEchoServer> aggregatorServerApp = DynamicCast<UdpEchoServer> (aggregatorApp.Get (0));
+      for (uint32_t i = 0; i < fanOut; i++)
+        {
+          aggregatorServerApp->AddBackend (InetSocketAddress (addresses[1 + i], port));
+        }
+      aggregatorApp.Start (Seconds (0.0));
+      aggregatorApp.Stop (Seconds (simTime + 1.0));
+
+      Ptr<EchoStatsCollector> collector = CreateObject<EchoStatsCollector> ();
+      for (uint32_t i = 0; i < nClients; i++)
+        {
+          UdpEchoClientHelper echoClient (addresses[0], port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+          clientApp.Start (Seconds ((double) i / nClients));
+          clientApp.Stop (Seconds (simTime + 1.0));
+          collector->AddClient (clientApp.Get (0));
+        }
+      collector->Start ();
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      const EchoSketch &sub = aggregatorServerApp->GetSubRequestRtt ();
+      const EchoSketch &fan = aggregatorServerApp->GetFanOutLatency ();
+      EchoSketch rtt = collector->GetSketch (ECHO_STATS_RTT);
+      double subP99 = sub.GetQuantile (0.99);
+      // the timeouts are completions too, so they count in the fan-out latency
+      uint64_t completed = fan.GetCount ();
+      std::cout << fanOut << "," << (quorum == 0 ? fanOut : std::min (quorum, fanOut)) << ","
+                << subP99 << "," << fan.GetQuantile (0.50) << "," << fan.GetQuantile (0.99) << ","
+                << fan.GetQuantile (0.999) << "," << (subP99 > 0 ? fan.GetQuantile (0.99) / subP99 : 0.0) << ","
+                << rtt.GetQuantile (0.99) << "," << rtt.GetQuantile (0.999) << ","
+                << (completed ? (double) aggregatorServerApp->GetFanOutTimeouts () / completed : 0.0) << std::endl;
+
+      collector->Dispose ();
+      Simulator::Destroy ();
+    }
+  return 0;
+}
@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Overhead and benefit of request hedging.
+ *
+ * nClients clients are connected through a hub to two servers; half of
+ * them use the first server as the primary and the second one for the
+ * hedged requests, and the other half the reverse. The scenario is run
+ * once without hedging and once per hedge percentile of the list (and,
+ * with --hedgeDelay, once with that fixed delay). Every run prints one
+ * CSV line with the hedge rate (the extra load), the RTT percentiles of
+ * all the clients (EchoStatsCollector) and the p99/p99.9 improvement over
+ * the run without hedging, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-hedging --rho=0.7 --percentiles=0.9,0.95,0.99"
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-stats-collector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoHedging");
+
+/**
+ * \brief count a hedged request
+ */
+static void
+CountHedge (uint64_t *hedged, Ptr<const Packet> /* packet */)
+{
+  (*hedged)++;
+}
+
+/**
+ * \brief count a request
+ */
+static void
+CountSent (uint64_t *sent, Ptr<const Packet> /* packet */)
+{
+  (*sent)++;
+}
+
+/**
+ * \brief the result of a run
+ */
+struct HedgingResult
+{
+  double hedgeRate; //!< hedged requests over the requests
+  double p50; //!< RTT median (s)
+  double p99; //!< RTT 99th percentile (s)
+  double p999; //!< RTT 99.9th percentile (s)
+};
+
+/**
+ * \brief run the scenario
+ * \param nClients number of clients
+ * \param rho utilization of the servers without the hedges
+ * \param simTime simulated time (s)
+ * \param percentile hedge percentile (0: fixed delay)
+ * \param delay fixed hedge delay (0: no hedging)
+ * \param run RNG run number
+ */
+static HedgingResult
+Run (uint32_t nClients, double rho, double simTime, double percentile, Time delay, uint32_t run)
+{
+  RngSeedManager::SetRun (run);
+
+  NodeContainer hub;
+  hub.Create (1);
+  NodeContainer servers;
+  servers.Create (2);
+  NodeContainer clients;
+  clients.Create (nClients);
+
+  InternetStackHelper internet;
+  internet.Install (hub);
+  internet.Install (servers);
+  internet.Install (clients);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+  Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+  Ipv4StaticRoutingHelper staticRouting;
+  std::vector<Ipv4Address> serverAddresses;
+  NodeContainer spokes (servers, clients);
+  for (uint32_t i = 0; i < spokes.GetN (); i++)
+    {
+      NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+      address.NewNetwork ();
+      Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+      routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+      if (i < 2)
+        {
+          serverAddresses.push_back (interfaces.GetAddress (1));
+        }
+    }
+
+  // every server gets half of the clients as the primary: rho of 10 Mbps
+  uint32_t packetSize = 100;
+  uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+  DataRate serviceRate ("10Mbps");
+  double lambda = rho * serviceRate.GetBitRate () / (requestSize * 8.0) / ((nClients + 1) / 2);
+  DataRate clientRate ((uint64_t) (lambda * packetSize * 8));
+
+  uint16_t port = 9;
+  UdpEchoServerHelper echoServer (port);
+  echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+  echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+  ApplicationContainer serverApps = echoServer.Install (servers);
+  serverApps.Start (Seconds (0.0));
+  serverApps.Stop (Seconds (simTime + 1.0));
+
+  Ptr<EchoStatsCollector> collector = CreateObject<EchoStatsCollector> ();
+  uint64_t hedged = 0;
+  uint64_t sent = 0;
+  for (uint32_t i = 0; i < nClients; i++)
+    {
+      UdpEchoClientHelper echoClient (serverAddresses[i % 2], port);
+      echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+      echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+      echoClient.SetAttribute ("Id", UintegerValue (i));
+      echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+      if (percentile > 0.0 || delay.IsStrictlyPositive ())
+        {
+          echoClient.SetAttribute ("HedgeAddress", AddressValue (serverAddresses[(i + 1) % 2]));
+          echoClient.SetAttribute ("HedgeDelay", TimeValue (delay.IsStrictlyPositive () ? delay : MilliSeconds (10)));
+          echoClient.SetAttribute ("HedgePercentile", DoubleValue (percentile));
+        }
+      ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+      clientApp.Start (Seconds ((double) i / nClients));
+      clientApp.Stop (Seconds (simTime + 1.0));
+
+      Ptr<Application> client = clientApp.Get (0);
+      collector->AddClient (client, "all clients");
+      client->TraceConnectWithoutContext ("Hedge", MakeBoundCallback (&CountHedge, &hedged));
+      client->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&CountSent, &sent));
+    }
+  collector->Start ();
+
+  Simulator::Stop (Seconds (simTime));
+  Simulator::Run ();
+
+  EchoSketch rtt = collector->GetSketch (ECHO_STATS_RTT);
+  HedgingResult result;
+  result.hedgeRate = sent ? (double) hedged / sent : 0.0;
+  result.p50 = rtt.GetQuantile (0.50);
+  result.p99 = rtt.GetQuantile (0.99);
+  result.p999 = rtt.GetQuantile (0.999);
+  collector->Dispose ();
+  Simulator::Destroy ();
+  return result;
+}
+
+/**
+ * \brief print the CSV line of a run
+ */
+static void
+Print (std::string setting, const HedgingResult &result, const HedgingResult &baseline)
+{
+  std::cout << setting << "," << result.hedgeRate << "," << result.p50 << ","
+            << result.p99 << "," << result.p999 << ","
+            << (baseline.p99 > 0 ? 1.0 - result.p99 / baseline.p99 : 0.0) << ","
+            << (baseline.p999 > 0 ? 1.0 - result.p999 / baseline.p999 : 0.0) << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 20;
+  double rho = 0.7;
+  double simTime = 100.0;
+  std::string percentiles = "0.9,0.95,0.99";
+  double hedgeDelay = 0.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("rho", "Utilization of the servers without the hedges", rho);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("percentiles", "Comma separated hedge percentiles of the primary RTTs", percentiles);
+  cmd.AddValue ("hedgeDelay", "Fixed hedge delay of an extra run (s, 0: no such run)", hedgeDelay);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  nClients = std::max<uint32_t> (nClients, 2);
+
+  std::cout << "hedging,hedge_rate,rtt_p50,rtt_p99,rtt_p999,p99_reduction,p999_reduction" << std::endl;
+  HedgingResult baseline = Run (nClients, rho, simTime, 0.0, Seconds (0), run);
+  Print ("off", baseline, baseline);
+
+  std::istringstream list (percentiles);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      HedgingResult result = Run (nClients, rho, simTime, atof (item.c_str ()), Seconds (0), run);
+      Print ("p" + item, result, baseline);
+    }
+  if (hedgeDelay > 0.0)
+    {
+      std::ostringstream setting;
+      setting << hedgeDelay << "s";
+      Print (setting.str (), Run (nClients, rho, simTime, 0.0, Seconds (hedgeDelay), run), baseline);
+    }
+  return 0;
+}
@@ -0,0 +1,152 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Reply pacing at rates which are not a whole number of bytes per ns.
+ *
+ * For every pacing rate of the list it checks that the wait of the token
+ * bucket covers deficits down to a fraction of a byte, then runs nClients
+ * clients offering --load times the pacing rate for --simTime and checks
+ * that the pacer sent replies and its queue drained one second after the
+ * clients stopped. A wait rounded down to 0 livelocks the pacer, so a
+ * regression shows as a run which never ends. It prints one CSV line per
+ * rate and the exit status is 1 if any check failed, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-pacing --rates=7Mbps,1.3Mbps,11Mbps"
+ *   ./waf --run "scratch/udp-echo-pacing --load=0.99 --burst=200"
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/comm-header.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoPacing");
+
+/**
+ * \brief check that the wait of the token bucket refills every deficit
+ * from 1e-6 to 1e4 bytes, and is positive
+ */
+static bool
+CheckPacingWait (DataRate rate)
+{
+  for (double deficit = 1e-6; deficit <= 1e4; deficit *= 1.7)
+    {
+      Time wait = UdpEchoServer::GetPacingWait (deficit, rate);
+      if (!wait.IsStrictlyPositive () || wait.GetSeconds () * rate.GetBitRate () / 8.0 < deficit)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 4;
+  std::string rateList = "7Mbps,1.3Mbps,11Mbps,0.77Mbps";
+  uint32_t packetSize = 100;
+  uint32_t burst = 1500;
+  double load = 0.9;
+  double simTime = 10.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("rates", "Comma separated pacing rates", rateList);
+  cmd.AddValue ("packetSize", "Payload of the requests in bytes", packetSize);
+  cmd.AddValue ("burst", "Depth of the token bucket in bytes", burst);
+  cmd.AddValue ("load", "Offered load over the pacing rate", load);
+  cmd.AddValue ("simTime", "Simulated time the clients send (s)", simTime);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  bool failed = false;
+  std::cout << "rate,wait,paced_replies,queued_at_end,check" << std::endl;
+
+  std::istringstream list (rateList);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RngSeedManager::SetRun (run);
+      DataRate pacingRate (item);
+      bool waitOk = CheckPacingWait (pacingRate);
+
+      NodeContainer nodes;
+      nodes.Create (2);
+      InternetStackHelper internet;
+      internet.Install (nodes);
+
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+      NetDeviceContainer devices = p2p.Install (nodes);
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+      // the pacer is the bottleneck
+      uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+      DataRate clientRate ((uint64_t) (load * pacingRate.GetBitRate () / nClients * packetSize / requestSize));
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (DataRate ("1Gbps")));
+      echoServer.SetAttribute ("PacingRate", DataRateValue (pacingRate));
+      echoServer.SetAttribute ("PacingBurst", UintegerValue (burst));
+      echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer serverApp = echoServer.Install (nodes.Get (1));
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 2.0));
+      Ptr<UdpEchoServer> echoServerApp = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+
+      for (uint32_t i = 0; i < nClients; i++)
+        {
+          UdpEchoClientHelper echoClient (interfaces.GetAddress (1), port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (nodes.Get (0));
+          clientApp.Start (Seconds ((double) i / nClients));
+          clientApp.Stop (Seconds (simTime));
+        }
+
+      // the server is still running, so the queue must have drained
+      Simulator::Stop (Seconds (simTime + 1.0));
+      Simulator::Run ();
+
+      uint32_t paced = echoServerApp->GetPacedReplies ();
+      uint32_t queued = echoServerApp->GetReplyQueueLength ();
+      bool ok = waitOk && paced > 0 && queued == 0;
+      failed = failed || !ok;
+      std::cout << item << "," << (waitOk ? "ok" : "FAIL") << "," << paced << "," << queued << ","
+                << (ok ? "ok" : "FAIL") << std::endl;
+
+      Simulator::Destroy ();
+    }
+  return failed ? 1 : 0;
+}
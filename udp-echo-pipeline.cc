@@ -0,0 +1,233 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Throughput of a staged server against its inter-stage buffer sizes.
+ *
+ * The server is a parse -> compute -> respond pipeline (--work,
+ * --workers, --distributions, see the Stage* attributes of
+ * UdpEchoServer). nClients clients offer --load times the capacity of the
+ * slowest stage. The scenario is run once per buffer size of the list
+ * (the same size between all the stages, 0 is unlimited) and prints one
+ * CSV line each: the throughput, alone and over the capacity of the
+ * slowest stage, the requests without a reply (dropped at the server or
+ * still in flight at the end), the RTT p50/p99 and
+ * the colon separated utilization and blocking of every stage, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-pipeline --buffers=1,2,4,8,0 --load=1.2"
+ *   ./waf --run "scratch/udp-echo-pipeline --work=0.3:0.4:0.3 --workers=1:2:1"
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-stats-collector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoPipeline");
+
+/**
+ * \brief count a reply
+ */
+static void
+CountReply (uint64_t *replies, Time /* rtt */)
+{
+  (*replies)++;
+}
+
+/**
+ * \brief count a request
+ */
+static void
+CountSent (uint64_t *sent, Ptr<const Packet> /* packet */)
+{
+  (*sent)++;
+}
+
+/**
+ * \brief split a colon separated list of numbers
+ */
+static std::vector<double>
+SplitList (std::string list)
+{
+  std::vector<double> values;
+  std::istringstream iss (list);
+  std::string token;
+  while (std::getline (iss, token, ':'))
+    {
+      values.push_back (atof (token.c_str ()));
+    }
+  return values;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  std::string work = "0.2:0.6:0.2";
+  std::string workers = "1:1:1";
+  std::string distributions = "Exponential:Exponential:Exponential";
+  std::string bufferList = "1,2,4,8,16,0";
+  uint32_t maxQueueSize = 100;
+  double load = 1.2;
+  double simTime = 100.0;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("work", "Colon separated shares of the service time of the stages", work);
+  cmd.AddValue ("workers", "Colon separated workers of the stages", workers);
+  cmd.AddValue ("distributions", "Colon separated service distributions of the stages", distributions);
+  cmd.AddValue ("buffers", "Comma separated inter-stage buffer sizes (0: unlimited)", bufferList);
+  cmd.AddValue ("maxQueueSize", "Size of the buffer in front of the first stage", maxQueueSize);
+  cmd.AddValue ("load", "Offered load over the capacity of the slowest stage", load);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  // the capacity of a stage is its workers over its share of the service time
+  std::vector<double> shares = SplitList (work);
+  std::vector<double> counts = SplitList (workers);
+  double slowest = 0.0;
+  for (uint32_t i = 0; i < shares.size (); i++)
+    {
+      slowest = std::max (slowest, shares[i] / (i < counts.size () ? counts[i] : 1.0));
+    }
+
+  std::cout << "buffer,throughput,throughput_over_capacity,lost,rtt_p50,rtt_p99,"
+               "stage_utilization,stage_blocking" << std::endl;
+
+  std::istringstream list (bufferList);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RngSeedManager::SetRun (run);
+
+      NodeContainer hub;
+      hub.Create (1);
+      NodeContainer server;
+      server.Create (1);
+      NodeContainer clients;
+      clients.Create (nClients);
+
+      InternetStackHelper internet;
+      internet.Install (hub);
+      internet.Install (server);
+      internet.Install (clients);
+
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4StaticRoutingHelper staticRouting;
+      Ipv4Address serverAddress;
+      NodeContainer spokes (server, clients);
+      for (uint32_t i = 0; i < spokes.GetN (); i++)
+        {
+          NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+          Ipv4InterfaceContainer interfaces = address.Assign (devices);
+          address.NewNetwork ();
+          Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+          routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+          if (i == 0)
+            {
+              serverAddress = interfaces.GetAddress (1);
+            }
+        }
+
+      uint32_t packetSize = 100;
+      uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+      DataRate serviceRate ("10Mbps");
+      double mue = serviceRate.GetBitRate () / (requestSize * 8.0);
+      double capacity = mue / slowest;
+      DataRate clientRate ((uint64_t) (load * capacity / nClients * packetSize * 8));
+
+      // the same buffer between all the stages
+      std::string buffers = item;
+      for (uint32_t i = 2; i < shares.size (); i++)
+        {
+          buffers += ":" + item;
+        }
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+      echoServer.SetAttribute ("MaxQueueSize", UintegerValue (maxQueueSize));
+      echoServer.SetAttribute ("StageWork", StringValue (work));
+      echoServer.SetAttribute ("StageWorkers", StringValue (workers));
+      echoServer.SetAttribute ("StageDistributions", StringValue (distributions));
+      echoServer.SetAttribute ("StageBuffers", StringValue (buffers));
+      echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer serverApp = echoServer.Install (server);
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 1.0));
+      Ptr<UdpEchoServer> echoServerApp = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+
+      Ptr<EchoStatsCollector> collector = CreateObject<EchoStatsCollector> ();
+      uint64_t replies = 0;
+      uint64_t sent = 0;
+      for (uint32_t i = 0; i < nClients; i++)
+        {
+          UdpEchoClientHelper echoClient (serverAddress, port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+          clientApp.Start (Seconds ((double) i / nClients));
+          clientApp.Stop (Seconds (simTime + 1.0));
+          clientApp.Get (0)->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&CountReply, &replies));
+          clientApp.Get (0)->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&CountSent, &sent));
+          collector->AddClient (clientApp.Get (0));
+        }
+      collector->Start ();
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      std::ostringstream utilization;
+      std::ostringstream blocking;
+      for (uint32_t i = 0; i < echoServerApp->GetStageCount (); i++)
+        {
+          utilization << (i ? ":" : "") << echoServerApp->GetStageUtilization (i);
+          blocking << (i ? ":" : "") << echoServerApp->GetStageBlocking (i);
+        }
+      EchoSketch rtt = collector->GetSketch (ECHO_STATS_RTT);
+      double throughput = replies / simTime;
+      std::cout << item << "," << throughput << "," << throughput / capacity << ","
+                << sent - replies << "," << rtt.GetQuantile (0.50) << "," << rtt.GetQuantile (0.99) << ","
+                << utilization.str () << "," << blocking.str () << std::endl;
+
+      collector->Dispose ();
+      Simulator::Destroy ();
+    }
+  return 0;
+}
@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Self-stabilization of an overloaded server by client rate control.
+ *
+ * nClients clients start with an aggregate offered load of --load times
+ * the service rate mu of one server and adapt their send rates with each
+ * mode of the list (Fixed is the reference without control). Every
+ * --period the aggregate send rate, the reply throughput and the server
+ * queue length are sampled. The program prints one CSV line per mode:
+ * the time after which the throughput stays above (1 - tolerance) mu, the
+ * time after which the queue stays below --queueLimit (a time past
+ * simTime means never), the mean send rate, throughput (both over mu) and
+ * queue of the second half of the run and the RTT p99 of the whole run.
+ * With --series the samples are printed as well, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-ratecontrol --modes=Fixed,Aimd,Delay --load=2"
+ *   ./waf --run "scratch/udp-echo-ratecontrol --modes=Aimd --load=0.1 --series=1"
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-stats-collector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoRateControl");
+
+/**
+ * \brief the samples of a run
+ */
+struct RateSamples
+{
+  std::vector<Ptr<UdpEchoClient> > clients; //!< the clients
+  uint64_t replies; //!< replies received since the last sample
+  uint32_t queue; //!< current server queue length
+  Time period; //!< sample period
+  std::vector<double> sendRate; //!< aggregate send rate (requests/s)
+  std::vector<double> throughput; //!< replies/s
+  std::vector<uint32_t> queueLength; //!< server queue length
+};
+
+/**
+ * \brief count a reply
+ */
+static void
+CountReply (RateSamples *samples, Time /* rtt */)
+{
+  samples->replies++;
+}
+
+/**
+ * \brief follow the server queue length
+ */
+static void
+QueueChanged (RateSamples *samples, uint32_t /* oldValue */, uint32_t newValue)
+{
+  samples->queue = newValue;
+}
+
+/**
+ * \brief take a sample and schedule the next one
+ */
+static void
+Sample (RateSamples *samples, uint32_t payloadBits)
+{
+  double rate = 0.0;
+  for (uint32_t i = 0; i < samples->clients.size (); i++)
+    {
+      rate += samples->clients[i]->GetSendRate ().GetBitRate ();
+    }
+  // a client sends DataRate over its payload bits requests per second
+  samples->sendRate.push_back (rate / payloadBits);
+  samples->throughput.push_back (samples->replies / samples->period.GetSeconds ());
+  samples->queueLength.push_back (samples->queue);
+  samples->replies = 0;
+  Simulator::Schedule (samples->period, &Sample, samples, payloadBits);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  std::string modes = "Fixed,Aimd,Delay";
+  double load = 2.0;
+  double simTime = 60.0;
+  double period = 0.1;
+  double tolerance = 0.1;
+  uint32_t queueLimit = 20;
+  uint32_t maxQueueSize = 1000;
+  bool series = false;
+  uint32_t run = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("modes", "Comma separated RateControl modes (Fixed, Aimd, Delay)", modes);
+  cmd.AddValue ("load", "Initial aggregate offered load over the service rate", load);
+  cmd.AddValue ("simTime", "Simulated time per run (s)", simTime);
+  cmd.AddValue ("period", "Sample period (s)", period);
+  cmd.AddValue ("tolerance", "Throughput shortfall from mu still counted as converged", tolerance);
+  cmd.AddValue ("queueLimit", "Queue length below which the server counts as stable", queueLimit);
+  cmd.AddValue ("maxQueueSize", "Server buffer size (packets)", maxQueueSize);
+  cmd.AddValue ("series", "Print the samples too", series);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.Parse (argc, argv);
+
+  if (series)
+    {
+      std::cout << "mode,time,send_rate,throughput,queue" << std::endl;
+    }
+  std::ostringstream summary;
+  summary << "mode,throughput_converged_s,queue_stable_s,send_rate_over_mu,throughput_over_mu,"
+             "mean_queue,rtt_p99" << std::endl;
+
+  std::istringstream list (modes);
+  std::string mode;
+  while (std::getline (list, mode, ','))
+    {
+      RngSeedManager::SetRun (run);
+
+      NodeContainer hub;
+      hub.Create (1);
+      NodeContainer server;
+      server.Create (1);
+      NodeContainer clients;
+      clients.Create (nClients);
+
+      InternetStackHelper internet;
+      internet.Install (hub);
+      internet.Install (server);
+      internet.Install (clients);
+
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("100us"));
+
+      Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+      Ipv4StaticRoutingHelper staticRouting;
+      Ipv4Address serverAddress;
+      NodeContainer spokes (server, clients);
+      for (uint32_t i = 0; i < spokes.GetN (); i++)
+        {
+          NetDeviceContainer devices = p2p.Install (hub.Get (0), spokes.Get (i));
+          Ipv4InterfaceContainer interfaces = address.Assign (devices);
+          address.NewNetwork ();
+          Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spokes.Get (i)->GetObject<Ipv4> ());
+          routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+          if (i == 0)
+            {
+              serverAddress = interfaces.GetAddress (1);
+            }
+        }
+
+      uint32_t packetSize = 100;
+      uint32_t requestBits = (packetSize + CommHeader ().GetSerializedSize ()) * 8;
+      DataRate serviceRate ("10Mbps");
+      double mu = serviceRate.GetBitRate () / (double) requestBits;
+      // the client DataRate counts the payload only
+      DataRate clientRate ((uint64_t) (load * mu / nClients * packetSize * 8));
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+      echoServer.SetAttribute ("MaxQueueSize", UintegerValue (maxQueueSize));
+      echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer serverApp = echoServer.Install (server);
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 1.0));
+
+      RateSamples samples;
+      samples.replies = 0;
+      samples.queue = 0;
+      samples.period = Seconds (period);
+      serverApp.Get (0)->TraceConnectWithoutContext ("QueueLength", MakeBoundCallback (&QueueChanged, &samples));
+
+      Ptr<EchoStatsCollector> collector = CreateObject<EchoStatsCollector> ();
+      for (uint32_t i = 0; i < nClients; i++)
+        {
+          UdpEchoClientHelper echoClient (serverAddress, port);
+          echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+          echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+          echoClient.SetAttribute ("Id", UintegerValue (i));
+          echoClient.SetAttribute ("RateControl", StringValue (mode));
+          echoClient.SetAttribute ("AdditiveIncrease", DataRateValue (DataRate ((uint64_t) (mu * packetSize * 8 / nClients / 100))));
+          echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+          ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+          clientApp.Start (Seconds (0.0));
+          clientApp.Stop (Seconds (simTime + 1.0));
+
+          Ptr<Application> client = clientApp.Get (0);
+          samples.clients.push_back (DynamicCast<UdpEchoClient> (client));
+          client->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&CountReply, &samples));
+          collector->AddClient (client);
+        }
+      collector->Start ();
+      Simulator::Schedule (samples.period, &Sample, &samples, packetSize * 8);
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      uint32_t n = samples.throughput.size ();
+      int32_t lastLow = -1;
+      int32_t lastLong = -1;
+      double sendRate = 0.0;
+      double throughput = 0.0;
+      double queue = 0.0;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          double sent = samples.sendRate[i];
+          if (series)
+            {
+              std::cout << mode << "," << (i + 1) * period << "," << sent << "," <<
+                           samples.throughput[i] << "," << samples.queueLength[i] << std::endl;
+            }
+          if (samples.throughput[i] < (1.0 - tolerance) * mu)
+            {
+              lastLow = i;
+            }
+          if (samples.queueLength[i] >= queueLimit)
+            {
+              lastLong = i;
+            }
+          if (i >= n / 2)
+            {
+              sendRate += sent;
+              throughput += samples.throughput[i];
+              queue += samples.queueLength[i];
+            }
+        }
+      uint32_t tail = n - n / 2;
+      EchoSketch rtt = collector->GetSketch (ECHO_STATS_RTT);
+      summary << mode << "," << (lastLow + 2) * period << "," << (lastLong + 2) * period << ","
+              << (tail ? sendRate / tail / mu : 0.0) << "," << (tail ? throughput / tail / mu : 0.0) << ","
+              << (tail ? queue / tail : 0.0) << "," << rtt.GetQuantile (0.99) << std::endl;
+
+      collector->Dispose ();
+      Simulator::Destroy ();
+    }
+  std::cout << summary.str ();
+  return 0;
+}
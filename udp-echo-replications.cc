@@ -0,0 +1,414 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Parallel independent replications of an echo scenario.
+ *
+ * The ns-3 simulator is a process wide singleton, so every replication
+ * runs in its own forked process, up to "jobs" (by default the number of
+ * online CPUs) at a time. Replication r uses RNG run r and fixed stream
+ * numbers (AssignStreams: the server gets stream 0, client i stream i + 1),
+ * so the replications are independent and each one is reproducible alone.
+ *
+ * Every replication sends back, over a pipe, the mean client RTT and
+ * server sojourn time and their log-linear histograms. The driver prints
+ * the mean over the replications with its 95% confidence interval and the
+ * percentiles of the pooled histograms. With "precision", every
+ * replication stops as soon as the EchoStoppingRule finds its latency
+ * estimates precise enough (simTime becomes the maximum), e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-replications --replications=64 --nClients=20"
+ *   ./waf --run "scratch/udp-echo-replications --precision=0.02 --simTime=10000"
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "echo-stopping-rule.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoReplications");
+
+/**
+ * \brief a log-linear latency histogram (16 buckets per power of two of ns)
+ */
+struct LatencyHistogram
+{
+  static const uint32_t SUB_BITS = 4; //!< log2 of the buckets per power of two
+  static const uint32_t BUCKETS = (48 - SUB_BITS + 1) << SUB_BITS; //!< up to 2^48 ns
+
+  LatencyHistogram () : count (0), sum (0.0)
+  {
+    for (uint32_t i = 0; i < BUCKETS; i++)
+      {
+        counts[i] = 0;
+      }
+  }
+
+  void Record (Time t)
+  {
+    uint64_t v = std::max<int64_t> (t.GetNanoSeconds (), 0);
+    uint32_t i = v;
+    if (v >= (1u << SUB_BITS))
+      {
+        uint32_t shift = 63 - __builtin_clzll (v) - SUB_BITS;
+        i = ((shift + 1) << SUB_BITS) + ((v >> shift) & ((1u << SUB_BITS) - 1));
+      }
+    counts[std::min (i, BUCKETS - 1)]++;
+    count++;
+    sum += t.GetSeconds ();
+  }
+
+  void Merge (const LatencyHistogram &other)
+  {
+    for (uint32_t i = 0; i < BUCKETS; i++)
+      {
+        counts[i] += other.counts[i];
+      }
+    count += other.count;
+    sum += other.sum;
+  }
+
+  /**
+   * \return the middle of the bucket holding the quantile q (s)
+   */
+  double Quantile (double q) const
+  {
+    uint64_t rank = std::ceil (q * count);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++)
+      {
+        seen += counts[i];
+        if (seen != 0 && seen >= rank)
+          {
+            if (i < (1u << SUB_BITS))
+              {
+                return i / 1e9;
+              }
+            uint32_t shift = (i >> SUB_BITS) - 1;
+            uint64_t low = (uint64_t) ((1u << SUB_BITS) + (i & ((1u << SUB_BITS) - 1))) << shift;
+            return (low + ((1ull << shift) - 1) / 2.0) / 1e9;
+          }
+      }
+    return 0.0;
+  }
+
+  double Mean (void) const
+  {
+    return count ? sum / count : 0.0;
+  }
+
+  uint64_t counts[BUCKETS]; //!< samples per bucket
+  uint64_t count; //!< number of samples
+  double sum; //!< sum of the samples (s)
+};
+
+/**
+ * \brief the result of one replication, sent back to the driver as is
+ */
+struct ReplicationResult
+{
+  uint32_t run; //!< RNG run
+  double wallTime; //!< wall clock time of the replication (s)
+  double simTime; //!< simulated time of the replication (s)
+  LatencyHistogram rtt; //!< client RTTs
+  LatencyHistogram sojourn; //!< server sojourn times
+};
+
+/**
+ * \brief the scenario parameters
+ */
+struct Scenario
+{
+  uint32_t nClients; //!< number of clients
+  double simTime; //!< simulated time (s), the maximum one with a precision
+  double precision; //!< relative precision of the stopping rule (0 disables it)
+  double warmup; //!< discarded initial period (s)
+  uint32_t packetSize; //!< request size
+  std::string clientRate; //!< offered load of a client
+  std::string serviceRate; //!< service rate of the server
+};
+
+// the default pipe buffer (64 KiB) holds a whole result
+static_assert (sizeof (ReplicationResult) < 65536, "replication result larger than a pipe buffer");
+
+static Time g_warmup; //!< the warm-up of the running replication
+
+static void
+RecordRtt (LatencyHistogram *h, Time rtt)
+{
+  if (Simulator::Now () >= g_warmup)
+    {
+      h->Record (rtt);
+    }
+}
+
+/**
+ * \brief run one replication, in a child process
+ * \param scenario the scenario
+ * \param run the RNG run
+ * \param result the result
+ */
+static void
+RunReplication (const Scenario &scenario, uint32_t run, ReplicationResult *result)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  RngSeedManager::SetRun (run);
+  g_warmup = Seconds (scenario.warmup);
+  result->run = run;
+
+  // the clients are connected to the server directly, one /30 each
+  NodeContainer server;
+  server.Create (1);
+  NodeContainer clients;
+  clients.Create (scenario.nClients);
+  InternetStackHelper internet;
+  internet.Install (server);
+  internet.Install (clients);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+  std::vector<Ipv4Address> serverAddresses;
+  for (uint32_t i = 0; i < scenario.nClients; i++)
+    {
+      Ipv4InterfaceContainer interfaces = address.Assign (p2p.Install (server.Get (0), clients.Get (i)));
+      address.NewNetwork ();
+      serverAddresses.push_back (interfaces.GetAddress (0));
+    }
+
+  uint16_t port = 9;
+  Time stop = Seconds (scenario.simTime + 1.0);
+  UdpEchoServerHelper echoServer (port);
+  echoServer.SetAttribute ("ServiceRate", StringValue (scenario.serviceRate));
+  ApplicationContainer serverApp = echoServer.Install (server);
+  serverApp.Start (Seconds (0.0));
+  serverApp.Stop (stop);
+  Ptr<UdpEchoServer> echo = DynamicCast<UdpEchoServer> (serverApp.Get (0));
+  echo->AssignStreams (0);
+  echo->TraceConnectWithoutContext ("Sojourn", MakeBoundCallback (&RecordRtt, &result->sojourn));
+
+  for (uint32_t i = 0; i < scenario.nClients; i++)
+    {
+      UdpEchoClientHelper echoClient (serverAddresses[i], port);
+      echoClient.SetAttribute ("PacketSize", UintegerValue (scenario.packetSize));
+      echoClient.SetAttribute ("DataRate", StringValue (scenario.clientRate));
+      echoClient.SetAttribute ("Id", UintegerValue (i));
+      ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+      clientApp.Start (Seconds (0.0));
+      clientApp.Stop (stop);
+      Ptr<UdpEchoClient> client = DynamicCast<UdpEchoClient> (clientApp.Get (0));
+      client->AssignStreams (i + 1);
+      client->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&RecordRtt, &result->rtt));
+    }
+
+  // the applications outlive the simulation, so they do not print
+  Ptr<EchoStoppingRule> rule;
+  if (scenario.precision > 0)
+    {
+      rule = CreateObject<EchoStoppingRule> ();
+      rule->SetAttribute ("RelativePrecision", DoubleValue (scenario.precision));
+      rule->SetAttribute ("MaxTime", TimeValue (Seconds (scenario.simTime)));
+      rule->AddServer (echo);
+      for (uint32_t i = 0; i < clients.GetN (); i++)
+        {
+          rule->AddClient (clients.Get (i)->GetApplication (0));
+        }
+      rule->Start ();
+    }
+  else
+    {
+      Simulator::Stop (Seconds (scenario.simTime));
+    }
+  Simulator::Run ();
+  result->simTime = Simulator::Now ().GetSeconds ();
+  rule = 0;
+  Simulator::Destroy ();
+  result->wallTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+/**
+ * \brief a mean over the replications and its 95% confidence interval
+ */
+static void
+PrintMean (std::string metric, const std::vector<double> &values)
+{
+  double n = values.size ();
+  double mean = 0.0;
+  double var = 0.0;
+  for (uint32_t i = 0; i < values.size (); i++)
+    {
+      mean += values[i] / n;
+    }
+  for (uint32_t i = 0; i < values.size (); i++)
+    {
+      var += (values[i] - mean) * (values[i] - mean) / (n - 1);
+    }
+  double halfWidth = n > 1 ? EchoStoppingRule::StudentT975 (n - 1) * std::sqrt (var / n) : 0.0;
+  std::cout << metric << " mean: " << mean << " s +- " << halfWidth << " (95% CI over "
+            << values.size () << " replications)" << std::endl;
+}
+
+static void
+PrintPooled (std::string metric, const LatencyHistogram &h)
+{
+  std::cout << metric << " pooled: samples: " << h.count << " mean: " << h.Mean ()
+            << " p50: " << h.Quantile (0.5) << " p90: " << h.Quantile (0.9)
+            << " p99: " << h.Quantile (0.99) << " p99.9: " << h.Quantile (0.999) << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Scenario scenario;
+  scenario.nClients = 10;
+  scenario.simTime = 100.0;
+  scenario.precision = 0.0;
+  scenario.warmup = 10.0;
+  scenario.packetSize = 100;
+  scenario.clientRate = "80kbps";
+  scenario.serviceRate = "10Mbps";
+  uint32_t replications = 16;
+  uint32_t firstRun = 1;
+  long jobs = sysconf (_SC_NPROCESSORS_ONLN);
+
+  CommandLine cmd;
+  cmd.AddValue ("replications", "Number of independent replications", replications);
+  cmd.AddValue ("firstRun", "RNG run of the first replication", firstRun);
+  cmd.AddValue ("jobs", "Number of replications run in parallel", jobs);
+  cmd.AddValue ("nClients", "Number of echo clients", scenario.nClients);
+  cmd.AddValue ("simTime", "Simulated time of a replication (s)", scenario.simTime);
+  cmd.AddValue ("precision", "Stop a replication once its latency CIs are this tight, relative "
+                "(0: run simTime)", scenario.precision);
+  cmd.AddValue ("warmup", "Initial period excluded from the statistics (s)", scenario.warmup);
+  cmd.AddValue ("packetSize", "Request size (bytes)", scenario.packetSize);
+  cmd.AddValue ("clientRate", "Mean offered load of every client", scenario.clientRate);
+  cmd.AddValue ("serviceRate", "Service rate of the server", scenario.serviceRate);
+  cmd.Parse (argc, argv);
+  jobs = std::max (jobs, 1L);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  std::map<pid_t, int> running; // child -> read end of its pipe
+  std::vector<ReplicationResult *> results;
+  uint32_t next = 0;
+  while (next < replications || !running.empty ())
+    {
+      while (next < replications && running.size () < (size_t) jobs)
+        {
+          int fds[2];
+          if (pipe (fds) != 0)
+            {
+              NS_FATAL_ERROR ("pipe failed");
+            }
+          pid_t pid = fork ();
+          if (pid == 0)
+            {
+              close (fds[0]);
+              ReplicationResult *result = new ReplicationResult ();
+              RunReplication (scenario, firstRun + next, result);
+              const char *p = (const char *) result;
+              size_t left = sizeof (*result);
+              while (left != 0)
+                {
+                  ssize_t n = write (fds[1], p, left);
+                  if (n <= 0)
+                    {
+                      _exit (1);
+                    }
+                  p += n;
+                  left -= n;
+                }
+              _exit (0);
+            }
+          close (fds[1]);
+          running[pid] = fds[0];
+          next++;
+        }
+
+      // collect a finished replication. Its result fits in the pipe buffer,
+      // so the child could write it all and exit before it is read.
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (running.find (pid) == running.end ())
+        {
+          continue;
+        }
+      int fd = running[pid];
+      running.erase (pid);
+      ReplicationResult *result = new ReplicationResult ();
+      char *p = (char *) result;
+      size_t left = sizeof (*result);
+      while (left != 0)
+        {
+          ssize_t n = read (fd, p, left);
+          if (n <= 0)
+            {
+              break;
+            }
+          p += n;
+          left -= n;
+        }
+      close (fd);
+      if (left != 0 || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          std::cerr << "replication of process " << pid << " failed" << std::endl;
+          delete result;
+          continue;
+        }
+      results.push_back (result);
+    }
+  double wallTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  std::vector<double> rttMeans, sojournMeans;
+  LatencyHistogram rtt, sojourn;
+  double busyTime = 0.0;
+  double simTime = 0.0;
+  for (uint32_t i = 0; i < results.size (); i++)
+    {
+      rttMeans.push_back (results[i]->rtt.Mean ());
+      sojournMeans.push_back (results[i]->sojourn.Mean ());
+      rtt.Merge (results[i]->rtt);
+      sojourn.Merge (results[i]->sojourn);
+      busyTime += results[i]->wallTime;
+      simTime += results[i]->simTime / results.size ();
+      delete results[i];
+    }
+
+  PrintMean ("client rtt", rttMeans);
+  PrintPooled ("client rtt", rtt);
+  PrintMean ("server sojourn", sojournMeans);
+  PrintPooled ("server sojourn", sojourn);
+  std::cout << "replications: " << rttMeans.size () << " jobs: " << jobs << " wall time: " << wallTime
+            << " s speedup: " << (wallTime > 0 ? busyTime / wallTime : 0.0)
+            << " mean simulated time: " << simTime << " s" << std::endl;
+  return rttMeans.size () == replications ? 0 : 1;
+}
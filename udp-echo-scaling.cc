@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Scaling benchmark of the echo applications.
+ *
+ * A hub node is connected by point-to-point links to nServers echo servers
+ * and nClients echo clients (the clients are spread round robin over the
+ * servers). Static default routes are used, as global routing does not
+ * scale to 100k nodes. The simulation runs for simTime and the program
+ * prints one machine readable record (CSV or JSON) with the setup time,
+ * the run wall time, the number of simulator events, the events per wall
+ * clock second and the peak RSS, e.g.:
+ *
+ *   for n in 10 100 1000 10000 100000; do
+ *     ./waf --run "scratch/udp-echo-scaling --nClients=$n --header=$([ $n = 10 ] && echo 1 || echo 0)"
+ *   done > scaling.csv
+ *
+ * With --backgroundClients=N another N clients of the same rate are added
+ * as the fluid background load of the servers (BackgroundRate attribute),
+ * e.g., 100k users at the cost of the packet level probe clients:
+ *
+ *   ./waf --run "scratch/udp-echo-scaling --nClients=100 --backgroundClients=100000"
+ *
+ * With --snapshots=FILE every client and server is added to an
+ * EchoStatsCollector, which writes the per-second columnar snapshots to
+ * FILE and prints the global and per-group latency summaries to stderr.
+ *
+ * The applications do not print their own statistics ("PrintStats") and
+ * stop after the end of the simulation.
+ */
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/comm-header.h"
+#include "echo-stats-collector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoScaling");
+
+/**
+ * \brief get the wall clock time
+ * \return the time in seconds
+ */
+static double
+WallClock (void)
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/**
+ * \brief get the peak resident set size of the process
+ * \return the peak RSS in kilobytes
+ */
+static long
+PeakRss (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nClients = 10;
+  uint32_t nServers = 1;
+  uint32_t backgroundClients = 0;
+  double simTime = 10.0;
+  uint32_t packetSize = 100;
+  std::string clientRate = "1Mbps";
+  std::string linkRate = "1Gbps";
+  std::string linkDelay = "1ms";
+  uint32_t maxQueueSize = 1000;
+  uint32_t run = 1;
+  std::string format = "csv";
+  bool header = true;
+  std::string snapshots = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("nClients", "Number of echo clients", nClients);
+  cmd.AddValue ("nServers", "Number of echo servers", nServers);
+  cmd.AddValue ("backgroundClients", "Number of clients modelled as fluid load on the servers", backgroundClients);
+  cmd.AddValue ("simTime", "Simulated time (s)", simTime);
+  cmd.AddValue ("packetSize", "Request size (bytes)", packetSize);
+  cmd.AddValue ("clientRate", "Mean offered load of every client", clientRate);
+  cmd.AddValue ("linkRate", "Rate of the star links", linkRate);
+  cmd.AddValue ("linkDelay", "Delay of the star links", linkDelay);
+  cmd.AddValue ("maxQueueSize", "Server buffer size per class (0: unbounded)", maxQueueSize);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.AddValue ("format", "Output format: csv or json", format);
+  cmd.AddValue ("header", "Print the CSV header line", header);
+  cmd.AddValue ("snapshots", "Latency snapshot file of the stats collector (empty: no collector)", snapshots);
+  cmd.Parse (argc, argv);
+
+  RngSeedManager::SetRun (run);
+  nServers = std::max<uint32_t> (nServers, 1);
+
+  double setupStart = WallClock ();
+
+  NodeContainer hub;
+  hub.Create (1);
+  NodeContainer servers;
+  servers.Create (nServers);
+  NodeContainer clients;
+  clients.Create (nClients);
+
+  InternetStackHelper internet;
+  internet.Install (hub);
+  internet.Install (servers);
+  internet.Install (clients);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue (linkRate));
+  p2p.SetChannelAttribute ("Delay", StringValue (linkDelay));
+
+  // one /30 per link, 10.0.0.0/8 holds 4M of them
+  Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+  Ipv4StaticRoutingHelper staticRouting;
+  std::vector<Ipv4Address> serverAddresses;
+
+  NodeContainer spokes (servers, clients);
+  for (uint32_t i = 0; i < spokes.GetN (); i++)
+    {
+      Ptr<Node> spoke = spokes.Get (i);
+      NetDeviceContainer devices = p2p.Install (hub.Get (0), spoke);
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+      address.NewNetwork ();
+
+      Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting (spoke->GetObject<Ipv4> ());
+      routing->SetDefaultRoute (interfaces.GetAddress (0), 1);
+      if (i < nServers)
+        {
+          serverAddresses.push_back (interfaces.GetAddress (1));
+        }
+    }
+
+  // the applications stop after the simulation: see above
+  Time appStop = Seconds (simTime + 1.0);
+  uint16_t port = 9;
+
+  UdpEchoServerHelper echoServer (port);
+  echoServer.SetAttribute ("MaxQueueSize", UintegerValue (maxQueueSize));
+  // the background clients are spread evenly over the servers
+  uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+  double backgroundRate = (double) backgroundClients / nServers * 
+                          DataRate (clientRate).GetBitRate () / (packetSize * 8.0);
+  echoServer.SetAttribute ("BackgroundRate", DoubleValue (backgroundRate));
+  echoServer.SetAttribute ("BackgroundPacketSize", UintegerValue (requestSize));
+  echoServer.SetAttribute ("PrintStats", BooleanValue (false));
+  ApplicationContainer serverApps = echoServer.Install (servers);
+  serverApps.Start (Seconds (0.0));
+  serverApps.Stop (appStop);
+
+  ApplicationContainer clientApps;
+  for (uint32_t i = 0; i < nClients; i++)
+    {
+      UdpEchoClientHelper echoClient (serverAddresses[i % nServers], port);
+      echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+      echoClient.SetAttribute ("DataRate", StringValue (clientRate));
+      echoClient.SetAttribute ("Id", UintegerValue (i));
+      echoClient.SetAttribute ("PrintStats", BooleanValue (false));
+      ApplicationContainer clientApp = echoClient.Install (clients.Get (i));
+      clientApps.Add (clientApp);
+      // spread the first requests over the first second
+      clientApp.Start (Seconds ((double) i / nClients));
+      clientApp.Stop (appStop);
+    }
+
+  Ptr<EchoStatsCollector> collector;
+  if (!snapshots.empty ())
+    {
+      collector = CreateObject<EchoStatsCollector> ();
+      collector->SetAttribute ("FileName", StringValue (snapshots));
+      for (uint32_t i = 0; i < serverApps.GetN (); i++)
+        {
+          collector->AddServer (serverApps.Get (i));
+        }
+      for (uint32_t i = 0; i < clientApps.GetN (); i++)
+        {
+          collector->AddClient (clientApps.Get (i));
+        }
+      collector->Start ();
+    }
+
+  Simulator::Stop (Seconds (simTime));
+
+  double runStart = WallClock ();
+  Simulator::Run ();
+  double runEnd = WallClock ();
+  uint64_t events = Simulator::GetEventCount ();
+  if (collector)
+    {
+      collector->Print (std::cerr);
+      collector->Dispose ();
+    }
+  Simulator::Destroy ();
+
+  double setupTime = runStart - setupStart;
+  double wallTime = runEnd - runStart;
+  double eventRate = wallTime > 0 ? events / wallTime : 0.0;
+  long rss = PeakRss ();
+
+  if (format == "json")
+    {
+      std::cout << "{\"clients\": " << nClients
+                << ", \"background_clients\": " << backgroundClients
+                << ", \"servers\": " << nServers
+                << ", \"sim_time\": " << simTime
+                << ", \"setup_time\": " << setupTime
+                << ", \"wall_time\": " << wallTime
+                << ", \"events\": " << events
+                << ", \"events_per_sec\": " << eventRate
+                << ", \"peak_rss_kb\": " << rss << "}" << std::endl;
+    }
+  else
+    {
+      if (header)
+        {
+          std::cout << "clients,background_clients,servers,sim_time,setup_time,wall_time,events,events_per_sec,peak_rss_kb" << std::endl;
+        }
+      std::cout << nClients << "," << backgroundClients << "," << nServers << "," << simTime << "," << setupTime << ","
+                << wallTime << "," << events << "," << eventRate << "," << rss << std::endl;
+    }
+  return 0;
+}
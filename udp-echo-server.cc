@@ -29,11 +29,23 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
 
 #include "udp-echo-server.h"
 
 #include "ns3/eslr-module.h"
 #include "ns3/comm-header.h"
+#include "echo-trace.h"
 
 namespace ns3 {
 
@@ -65,6 +77,308 @@ UdpEchoServer::GetTypeId (void)
 									 Ipv4AddressValue (),
 									 MakeIpv4AddressAccessor (&UdpEchoServer::m_ispAddress),
 									 MakeIpv4AddressChecker ()) 									 									                   
+    .AddAttribute ("ISPPort",
+                   "Port of the ESLR routing process on the Default Gateway",
+                   UintegerValue (276),
+                   MakeUintegerAccessor (&UdpEchoServer::m_ispPort),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("AuthData",
+                   "Plain text authentication data of the server advertisements",
+                   UintegerValue (1234),
+                   MakeUintegerAccessor (&UdpEchoServer::m_authData),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("StatMinInterval",
+                   "Minimum interval between two server advertisements",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&UdpEchoServer::m_statMinInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("StatMaxInterval",
+                   "Maximum interval between two server advertisements",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&UdpEchoServer::m_statMaxInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("StatChangeThreshold",
+                   "Relative change of lambda or mue that triggers an early advertisement "
+                   "(for lambda, at least two standard errors of the measured change)",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&UdpEchoServer::m_statChangeThreshold),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("NumClasses",
+                   "Number of traffic classes, each of which has its own packet buffer",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&UdpEchoServer::m_numClasses),
+                   MakeUintegerChecker<uint32_t> (1, 256))
+    .AddAttribute ("Scheduling",
+                   "How the per-class packet buffers are served",
+                   EnumValue (UdpEchoServer::STRICT_PRIORITY),
+                   MakeEnumAccessor (&UdpEchoServer::m_scheduling),
+                   MakeEnumChecker (UdpEchoServer::STRICT_PRIORITY, "StrictPriority",
+                                    UdpEchoServer::WEIGHTED_FAIR, "WeightedFair"))
+    .AddAttribute ("ClassWeights",
+                   "Colon separated weights of the classes used in WeightedFair mode (e.g., 4:2:1). "
+                   "Classes without a weight get a weight of 1.",
+                   StringValue ("1"),
+                   MakeStringAccessor (&UdpEchoServer::m_classWeightsString),
+                   MakeStringChecker ())
+    .AddAttribute ("MaxQueueSize",
+                   "Maximum number of packets in each class buffer (0 means unlimited)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoServer::m_maxQueueSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BatchSize",
+                   "Maximum number of requests served by one service completion",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&UdpEchoServer::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BatchBytes",
+                   "Maximum number of bytes served by one service completion (0 means no byte budget)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoServer::m_batchBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BatchOverhead",
+                   "Fraction of the single request service time paid once per batch. "
+                   "A batch of n requests takes (overhead + (1 - overhead) * n) / mue on average",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&UdpEchoServer::m_batchOverhead),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ServiceRate",
+                   "Service rate of a channel; mue is this rate over the average request size",
+                   DataRateValue (DataRate ("10Mbps")),
+                   MakeDataRateAccessor (&UdpEchoServer::m_serviceDataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("ServiceDistribution",
+                   "Distribution of the service times",
+                   EnumValue (UdpEchoServer::EXPONENTIAL),
+                   MakeEnumAccessor (&UdpEchoServer::m_serviceDistribution),
+                   MakeEnumChecker (UdpEchoServer::EXPONENTIAL, "Exponential",
+                                    UdpEchoServer::DETERMINISTIC, "Deterministic"))
+    .AddAttribute ("Channels",
+                   "Number of channels serving the buffered requests in parallel",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&UdpEchoServer::m_numChannels),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PacingRate",
+                   "Rate of the token bucket shaping the replies (0 disables the pacing)",
+                   DataRateValue (DataRate ("0bps")),
+                   MakeDataRateAccessor (&UdpEchoServer::m_pacingRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("PacingBurst",
+                   "Depth of the token bucket shaping the replies in bytes",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&UdpEchoServer::m_pacingBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BackgroundRate",
+                   "Arrival rate (requests/s) of the background load modelled as fluid (0 disables it)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&UdpEchoServer::m_backgroundRate),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("BackgroundPacketSize",
+                   "Request size of the fluid background load in bytes",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&UdpEchoServer::m_backgroundPacketSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("FluidStep",
+                   "Maximum integration step of the fluid background queue",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&UdpEchoServer::m_fluidStep),
+                   MakeTimeChecker ())
+    .AddAttribute ("FanOut",
+                   "Number of backends a request is fanned out to (0 means all the backends)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoServer::m_fanOut),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Quorum",
+                   "Number of sub-replies completing a fanned out request (0 means all)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoServer::m_quorum),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FanOutTimeout",
+                   "Time after which a fanned out request is replied without the quorum (0 disables it)",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_fanOutTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxPending",
+                   "Number of fanned out requests which can be pending; more are dropped",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&UdpEchoServer::m_maxPending),
+                   MakeUintegerChecker<uint32_t> (1, 65536))
+    .AddAttribute ("SampleInterval",
+                   "Interval of the queue state samples (0 disables the sampling)",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_sampleInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxSamples",
+                   "Number of queue samples kept; beyond, every other sample is dropped and the interval doubled",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&UdpEchoServer::m_maxSamples),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("StageWork",
+                   "Colon separated shares of the service time of a request taken by the pipeline stages "
+                   "(e.g., 0.2:0.6:0.2); empty serves the requests on the channels",
+                   StringValue (""),
+                   MakeStringAccessor (&UdpEchoServer::m_stageWorkString),
+                   MakeStringChecker ())
+    .AddAttribute ("StageWorkers",
+                   "Colon separated numbers of workers of the pipeline stages; missing ones get 1",
+                   StringValue (""),
+                   MakeStringAccessor (&UdpEchoServer::m_stageWorkersString),
+                   MakeStringChecker ())
+    .AddAttribute ("StageBuffers",
+                   "Colon separated sizes of the buffers between the pipeline stages (one less than the stages, "
+                   "0 means unlimited); missing ones are unlimited",
+                   StringValue (""),
+                   MakeStringAccessor (&UdpEchoServer::m_stageBuffersString),
+                   MakeStringChecker ())
+    .AddAttribute ("StageDistributions",
+                   "Colon separated service distributions (Exponential, Deterministic) of the pipeline stages; "
+                   "missing ones follow ServiceDistribution",
+                   StringValue (""),
+                   MakeStringAccessor (&UdpEchoServer::m_stageDistributionsString),
+                   MakeStringChecker ())
+    .AddAttribute ("Autoscale",
+                   "What the autoscaler changes with the load",
+                   EnumValue (EchoAutoscaler::OFF),
+                   MakeEnumAccessor (&UdpEchoServer::m_autoscale),
+                   MakeEnumChecker (EchoAutoscaler::OFF, "Off",
+                                    EchoAutoscaler::CHANNELS, "Channels",
+                                    EchoAutoscaler::FREQUENCY, "Frequency"))
+    .AddAttribute ("AutoscaleMetric",
+                   "The load measure the autoscaler compares with the thresholds",
+                   EnumValue (EchoAutoscaler::UTILIZATION),
+                   MakeEnumAccessor (&UdpEchoServer::m_autoscaleMetric),
+                   MakeEnumChecker (EchoAutoscaler::UTILIZATION, "Utilization",
+                                    EchoAutoscaler::QUEUE_LENGTH, "QueueLength"))
+    .AddAttribute ("AutoscaleInterval",
+                   "Time between two evaluations of the autoscaler",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_autoscaleInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ScaleUpThreshold",
+                   "Smoothed load (utilization or waiting requests per channel) above which the capacity is increased",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&UdpEchoServer::m_scaleUpThreshold),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("ScaleDownThreshold",
+                   "Smoothed load below which the capacity is decreased",
+                   DoubleValue (0.3),
+                   MakeDoubleAccessor (&UdpEchoServer::m_scaleDownThreshold),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("AutoscaleSmoothing",
+                   "Weight of the last interval in the exponentially smoothed load (1: no smoothing)",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&UdpEchoServer::m_autoscaleSmoothing),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ScaleUpCooldown",
+                   "Minimum time from a scaling action to a scale up",
+                   TimeValue (Seconds (5.0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_scaleUpCooldown),
+                   MakeTimeChecker ())
+    .AddAttribute ("ScaleDownCooldown",
+                   "Minimum time from a scaling action to a scale down",
+                   TimeValue (Seconds (30.0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_scaleDownCooldown),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProvisioningDelay",
+                   "Time from the scale up decision to the added capacity",
+                   TimeValue (Seconds (10.0)),
+                   MakeTimeAccessor (&UdpEchoServer::m_provisioningDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinChannels",
+                   "Fewest channels the autoscaler keeps",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&UdpEchoServer::m_minChannels),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxChannels",
+                   "Most channels the autoscaler adds",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&UdpEchoServer::m_maxChannels),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("FrequencyStep",
+                   "Service rate multiplier change of a scaling action in Frequency mode",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&UdpEchoServer::m_frequencyStep),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("MinFrequency",
+                   "Lowest service rate multiplier in Frequency mode",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&UdpEchoServer::m_minFrequency),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("MaxFrequency",
+                   "Highest service rate multiplier in Frequency mode",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&UdpEchoServer::m_maxFrequency),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("CacheSize",
+                   "Number of keys the response cache holds (0 disables the cache)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&UdpEchoServer::m_cacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CachePolicy",
+                   "Eviction policy of the response cache",
+                   EnumValue (EchoCache::LRU),
+                   MakeEnumAccessor (&UdpEchoServer::m_cachePolicy),
+                   MakeEnumChecker (EchoCache::LRU, "Lru",
+                                    EchoCache::LFU, "Lfu"))
+    .AddAttribute ("CacheHitCost",
+                   "Service time of a cache hit over the one of a miss",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&UdpEchoServer::m_cacheHitCost),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ResponseSize",
+                   "Distribution of the reply payload sizes (Echo: the reply is the request)",
+                   EnumValue (UdpEchoServer::RESPONSE_ECHO),
+                   MakeEnumAccessor (&UdpEchoServer::m_responseSize),
+                   MakeEnumChecker (UdpEchoServer::RESPONSE_ECHO, "Echo",
+                                    UdpEchoServer::RESPONSE_CONSTANT, "Constant",
+                                    UdpEchoServer::RESPONSE_EXPONENTIAL, "Exponential",
+                                    UdpEchoServer::RESPONSE_PARETO, "Pareto"))
+    .AddAttribute ("ResponseSizeMean",
+                   "Mean reply payload size in bytes",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&UdpEchoServer::m_responseSizeMean),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ResponseSizeShape",
+                   "Shape (tail index) of the Pareto reply payload sizes",
+                   DoubleValue (1.5),
+                   MakeDoubleAccessor (&UdpEchoServer::m_responseSizeShape),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("Mtu",
+                   "Largest reply packet in bytes, CommHeader included; larger replies are fragmented",
+                   UintegerValue (1472),
+                   MakeUintegerAccessor (&UdpEchoServer::m_mtu),
+                   MakeUintegerChecker<uint32_t> (64))
+    .AddAttribute ("PrintStats",
+                   "Print the statistics of the server when it stops",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&UdpEchoServer::m_printStats),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("QueueLength",
+                     "Number of requests waiting in the class buffers",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_queuedPackets))
+    .AddTraceSource ("QueueBytes",
+                     "Number of bytes waiting in the class buffers",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_queuedBytes))
+    .AddTraceSource ("BusyChannels",
+                     "Number of channels serving a batch",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_busyChannels))
+    .AddTraceSource ("InService",
+                     "Number of requests being served",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_inServicePackets))
+    .AddTraceSource ("Wait",
+                     "Time a request waited in the buffer before its service started",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_waitTrace))
+    .AddTraceSource ("Sojourn",
+                     "Time from the arrival of a request to its reply",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_sojournTrace))
+    .AddTraceSource ("ReplyQueueLength",
+                     "Number of replies waiting for the pacer",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_replyQueueLength))
+    .AddTraceSource ("BackgroundBacklog",
+                     "Number of background requests in the fluid queue",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_fluidBacklog))
+    .AddTraceSource ("Capacity",
+                     "Service capacity: the active channels times the frequency",
+                     MakeTraceSourceAccessor (&UdpEchoServer::m_capacity))
   ;
   return tid;
 }
@@ -82,6 +396,69 @@ UdpEchoServer::UdpEchoServer ()
   m_sent = 0;
   m_received = 0;
   m_initialized = false;
+  m_printStats = true;
+  m_queuedPackets = 0;
+  m_queuedBytes = 0;
+  m_inServicePackets = 0;
+  m_maxSamples = 65536;
+  m_fanOut = 0;
+  m_quorum = 0;
+  m_maxPending = 1024;
+  m_numChannels = 1;
+  m_busyChannels = 0;
+  m_activeChannels = 1;
+  m_frequency = 1.0;
+  m_autoscale = EchoAutoscaler::OFF;
+  m_autoscaleMetric = EchoAutoscaler::UTILIZATION;
+  m_scaleUpThreshold = 0.8;
+  m_scaleDownThreshold = 0.3;
+  m_autoscaleSmoothing = 0.5;
+  m_minChannels = 1;
+  m_maxChannels = 8;
+  m_frequencyStep = 0.25;
+  m_minFrequency = 0.5;
+  m_maxFrequency = 2.0;
+  m_capacity = 1.0;
+  m_lastBusyArea = 0.0;
+  m_lastActiveArea = 0.0;
+  m_lastQueueArea = 0.0;
+  m_serviceDistribution = EXPONENTIAL;
+  m_lambdaReceived = 0;
+  m_lambdaArrivals = 0;
+  m_batchSize = 1;
+  m_batchBytes = 0;
+  m_batchOverhead = 0.0;
+  m_cacheSize = 0;
+  m_cachePolicy = EchoCache::LRU;
+  m_cacheHitCost = 0.1;
+  m_responseSize = RESPONSE_ECHO;
+  m_responseSizeMean = 1000;
+  m_responseSizeShape = 1.5;
+  m_mtu = 1472;
+  m_responses = 0;
+  m_responseBytes = 0;
+  m_fragmentsSent = 0;
+  m_rxBytes = 0;
+  m_txBytes = 0;
+  m_numClasses = 1;
+  m_scheduling = STRICT_PRIORITY;
+  m_nextClass = 0;
+  m_maxQueueSize = 0;
+  m_backgroundRate = 0.0;
+  m_backgroundPacketSize = 100;
+  m_fluidBacklog = 0.0;
+  m_fluidBacklogIntegral = 0.0;
+  m_fluidServed = 0.0;
+  m_pacingBurst = 1500;
+  m_tokens = 0.0;
+  m_replyQueueLength = 0;
+  m_pacedReplies = 0;
+  m_pacingDelaySum = 0.0;
+  m_pacingDelayMax = 0.0;
+  m_advertisedMue = 0.0;
+  m_advertisedLambda = 0.0;
+  m_statSent = 0;
+  m_statSuppressed = 0;
 }
 
 UdpEchoServer::~UdpEchoServer()
@@ -89,6 +466,15 @@ UdpEchoServer::~UdpEchoServer()
   NS_LOG_FUNCTION (this);
   m_socket = 0;
   m_socket6 = 0;
+  m_backendSocket = 0;
+}
+
+int64_t
+UdpEchoServer::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_rng->SetStream (stream);
+  return 1;
 }
 
 void
@@ -103,6 +489,58 @@ UdpEchoServer::StartApplication (void)
 {
   NS_LOG_FUNCTION (this);
 
+  m_serverBuffer.resize (m_numClasses);
+  m_classStats.resize (m_numClasses);
+  // channels the autoscaler may add are allocated up front
+  m_channels.resize (m_autoscale == EchoAutoscaler::CHANNELS ? std::max (m_numChannels, m_maxChannels) : m_numChannels);
+  m_activeChannels = m_numChannels;
+  m_frequency = 1.0;
+  m_capacity = m_activeChannels;
+  ParseClassWeights ();
+  m_pipeline.Configure (m_stageWorkString, m_stageWorkersString, m_stageBuffersString,
+                        m_stageDistributionsString, m_serviceDistribution == DETERMINISTIC);
+  m_pipeline.SetSource (MakeCallback (&UdpEchoServer::PipelineSource, this));
+  m_pipeline.SetServiceTime (MakeCallback (&UdpEchoServer::DrawServiceTime, this));
+  m_pipeline.SetSink (MakeCallback (&UdpEchoServer::PipelineSink, this));
+  // a zero step would never advance the fluid integration
+  NS_ABORT_MSG_IF (!m_fluidStep.IsStrictlyPositive (), "UdpEchoServer: FluidStep must be positive");
+  // the token bucket starts full
+  m_tokens = m_pacingBurst;
+  m_lastTokenUpdate = Simulator::Now ();
+  m_cache.Configure (m_cacheSize, m_cachePolicy);
+  m_lambdaTime = Simulator::Now ();
+  m_fluidTime = Simulator::Now ();
+  m_fluidStart = Simulator::Now ();
+  m_startTime = Simulator::Now ();
+  UpdateQueueAverages ();
+  EchoAutoscaler::Parameters scaling;
+  scaling.mode = m_autoscale;
+  scaling.scaleUpThreshold = m_scaleUpThreshold;
+  scaling.scaleDownThreshold = m_scaleDownThreshold;
+  scaling.smoothing = m_autoscaleSmoothing;
+  scaling.scaleUpCooldown = m_scaleUpCooldown;
+  scaling.scaleDownCooldown = m_scaleDownCooldown;
+  scaling.minChannels = m_minChannels;
+  scaling.maxChannels = m_channels.size ();
+  scaling.frequencyStep = m_frequencyStep;
+  scaling.minFrequency = m_minFrequency;
+  scaling.maxFrequency = m_maxFrequency;
+  m_autoscaler.Configure (scaling, m_activeChannels, Simulator::Now ());
+  if (m_autoscaler.IsEnabled ())
+    {
+      m_lastBusyArea = m_busyAverage.area;
+      m_lastActiveArea = m_activeAverage.area;
+      m_lastQueueArea = m_queueLengthAverage.area;
+      m_autoscaleEvent = Simulator::Schedule (m_autoscaleInterval, &UdpEchoServer::Autoscale, this);
+    }
+  if (m_sampleInterval.IsStrictlyPositive ())
+    {
+      m_samplePeriod = m_sampleInterval;
+      m_sampleStart = Simulator::Now ();
+      m_queueSamples.clear ();
+      SampleQueue ();
+    }
+
   if (m_socket == 0)
     {
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -147,6 +585,17 @@ UdpEchoServer::StartApplication (void)
 
   m_socket->SetRecvCallback (MakeCallback (&UdpEchoServer::HandleRead, this));
   m_socket6->SetRecvCallback (MakeCallback (&UdpEchoServer::HandleRead, this));
+
+  if (!m_backends.empty () && m_backendSocket == 0)
+    {
+      TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+      m_backendSocket = Socket::CreateSocket (GetNode (), tid);
+      m_backendSocket->Bind ();
+      m_backendSocket->SetRecvCallback (MakeCallback (&UdpEchoServer::HandleBackendRead, this));
+
+      m_pending.Configure (m_backends.size (), m_fanOut, m_quorum, m_maxPending);
+      m_fanOutTimeoutEvents.assign (m_maxPending, EventId ());
+    }
 }
 
 void 
@@ -164,6 +613,33 @@ UdpEchoServer::StopApplication ()
       m_socket6->Close ();
       m_socket6->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
     }
+
+  for (uint32_t c = 0; c < m_channels.size (); c++)
+    {
+      Simulator::Cancel (m_channels[c].completeEvent);
+    }
+  m_pipeline.Stop ();
+  Simulator::Cancel (m_nextPeriodicUpdate);
+  Simulator::Cancel (m_pacingEvent);
+  Simulator::Cancel (m_sampleEvent);
+  Simulator::Cancel (m_autoscaleEvent);
+  Simulator::Cancel (m_provisionEvent);
+  if (m_backendSocket != 0)
+    {
+      m_backendSocket->Close ();
+      m_backendSocket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      m_backendSocket = 0;
+    }
+  for (uint32_t i = 0; i < m_fanOutTimeoutEvents.size (); i++)
+    {
+      Simulator::Cancel (m_fanOutTimeoutEvents[i]);
+    }
+  UpdateQueueAverages ();
+  UpdateFluid ();
+  if (m_printStats)
+    {
+      PrintClassStats ();
+    }
 }
 
 void 
@@ -175,41 +651,53 @@ UdpEchoServer::HandleRead (Ptr<Socket> socket)
   Address from;
   while ((packet = socket->RecvFrom (from)))
     {
-      if (InetSocketAddress::IsMatchingType (from))
-      {
-        NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server received " << 
-                                   packet->GetSize () << " bytes from " <<
-                                   InetSocketAddress::ConvertFrom (from).GetIpv4 () << 
-                                   " port " <<
-                                   InetSocketAddress::ConvertFrom (from).GetPort ());
-      }
-      else if (Inet6SocketAddress::IsMatchingType (from))
-      {
-        NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server received " << 
-                                   packet->GetSize () << " bytes from " <<
-                                   Inet6SocketAddress::ConvertFrom (from).GetIpv6 () << 
-                                   " port " <<
-                                   Inet6SocketAddress::ConvertFrom (from).GetPort ());
-      }
-
       packet->RemoveAllPacketTags ();
       packet->RemoveAllByteTags ();
 
       m_avgPacketSize = ((m_avgPacketSize * m_received) + packet->GetSize ()) / (m_received +1);
       m_received ++;
+      m_rxBytes += packet->GetSize ();
+
+      // Requests of unknown classes are served with the lowest priority
+      CommHeader hdr;
+      packet->PeekHeader (hdr);
+      uint32_t trafficClass = std::min<uint32_t> (hdr.GetTrafficClass (), m_numClasses - 1);
+      ClassStats &stats = m_classStats[trafficClass];
+
+      if (m_maxQueueSize != 0 && m_serverBuffer[trafficClass].size () >= m_maxQueueSize)
+      {
+        NS_LOG_LOGIC ("Buffer of class " << trafficClass << " is full. Drop the packet");
+        ECHO_TRACE (ECHO_TRACE_SERVER_DROP, GetNode ()->GetId (), m_peers.Intern (from),
+                    packet->GetSize (), hdr.GetSequenceNumber ());
+        stats.dropped++;
+        continue;
+      }
 
       //NS_LOG_LOGIC ("Echoing packet");
       //socket->SendTo (packet, 0, from);
-      NS_LOG_INFO ("Buffering the packet");
+      uint32_t peer = m_peers.Intern (from);
+      ECHO_TRACE (ECHO_TRACE_SERVER_RX, GetNode ()->GetId (), peer,
+                  packet->GetSize (), hdr.GetSequenceNumber ());
             
-      m_serverQueueEntry.SetPacket (packet);
-      m_serverQueueEntry.SetAddress (from);
-      m_serverBuffer.push (m_serverQueueEntry);
+      m_serverBuffer[trafficClass].push (ServerQueueEntry (packet, peer));
+      m_queuedPackets++;
+      m_queuedBytes += packet->GetSize ();
+      UpdateQueueAverages ();
+      stats.enqueued++;
+      stats.maxQueueLength = std::max<uint32_t> (stats.maxQueueLength, m_serverBuffer[trafficClass].size ());
+      // the class buffers are the buffer of the first stage
+      m_pipeline.RecordSourceLength (m_queuedPackets);
       if (!m_initialized)
       {
-        ScheduleTransmit ();
         m_initialized = true;
+        UpdateLambda ();
         SendPeriodicStat ();
+        m_statSent++;
+        m_nextPeriodicUpdate = Simulator::Schedule (m_statMinInterval, &UdpEchoServer::CheckPeriodicStat, this);
+      }
+      if (m_busyChannels < m_channels.size ())
+      {
+        ScheduleTransmit ();
       }
     }
 }
@@ -219,77 +707,392 @@ UdpEchoServer::ScheduleTransmit (void)
 {
   NS_LOG_FUNCTION (this);
   
-  m_initialized = true;
+	m_serviceRate = m_serviceDataRate.GetBitRate (); // 10Mbps by default
+	m_Mue = m_serviceRate * m_frequency / (m_avgPacketSize * 8.0);	
+	
+  if (m_pipeline.IsEnabled ())
+  {
+    m_pipeline.Dispatch ();
+    return;
+  }
+  
+  // the channels beyond the active ones only finish their batches
+  for (uint32_t c = 0; c < m_activeChannels && m_queuedPackets != 0; c++)
+  {
+    if (m_channels[c].inService.empty ())
+    {
+      StartService (c);
+    }
+  }
+  if (m_queuedPackets == 0)
+  {
+    NS_LOG_LOGIC ("Server buffer is empty. " << m_channels.size () - m_busyChannels << " channels idle");
+  }
+}
+
+void
+UdpEchoServer::StartService (uint32_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
   
-	m_serviceRate = 10000000.0; //--> 10Mbps  //100000000.0; //--> 100Mbps
-	double tempTime;
-	double randValue;
 	Time t_reSchedule;
-	
-	randValue = m_rng->GetValue (0.0, 1.0);
-	
-	m_Mue = m_serviceRate / (m_avgPacketSize * 8.0);	
-	tempTime = (-1/m_Mue) *(log (randValue));
-	t_reSchedule = Seconds (tempTime);
-	
-	//Cutoff calling a heavy function to speedup the execution.
-  if (!m_serverBuffer.empty ())
+  std::vector<ServerQueueEntry> &inService = m_channels[channel].inService;
+  
+  // Take up to m_batchSize requests (or the requests fitting in the byte 
+  // budget) in to the service. At least one request is always served.
+  uint32_t batchBytes = 0;
+  while (m_queuedPackets != 0 && inService.size () < m_batchSize)
+  {
+    uint32_t trafficClass = SelectClass ();
+    std::queue<ServerQueueEntry> &buffer = m_serverBuffer[trafficClass];
+    uint32_t size = buffer.front ().GetPacket ()->GetSize ();
+    
+    if (m_batchBytes != 0 && !inService.empty () && batchBytes + size > m_batchBytes)
+    {
+      // give back the round robin credit taken for this class
+      if (m_scheduling == WEIGHTED_FAIR)
+      {
+        m_classCredits[trafficClass]++;
+        m_nextClass = trafficClass;
+      }
+      break;
+    }
+    
+    batchBytes += size;
+    m_waitTrace (Simulator::Now () - buffer.front ().GetEnqueueTime ());
+    inService.push_back (buffer.front ());
+    buffer.pop ();
+    m_queuedPackets--;
+    m_queuedBytes -= size;
+  }
+  
+  // The mean service time of a batch of n requests is 
+  // (overhead + (1 - overhead) * n) / mue, i.e., the per wakeup overhead
+  // is paid once per batch. A cache hit counts as CacheHitCost of a request.
+  double work = inService.size ();
+  if (m_cache.IsEnabled ())
   {
-    Reply ();
+    work = 0.0;
+    for (std::vector<ServerQueueEntry>::const_iterator it = inService.begin (); it != inService.end (); ++it)
+    {
+      work += CacheLookup (*it);
+    }
   }
-  m_sendEvent = Simulator::Schedule (t_reSchedule, &UdpEchoServer::ScheduleTransmit, this);    
+  double batchCost = m_batchOverhead + (1.0 - m_batchOverhead) * work;
+  
+	t_reSchedule = DrawServiceTime (batchCost, m_serviceDistribution == DETERMINISTIC);
+	
+  m_busyChannels++;
+  m_inServicePackets += inService.size ();
+  UpdateQueueAverages ();
+  m_channels[channel].completeEvent = Simulator::Schedule (t_reSchedule, &UdpEchoServer::ServiceComplete, this, channel);    
 }
 
 void
-UdpEchoServer::Reply(void)
+UdpEchoServer::ServiceComplete (uint32_t channel)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << channel);
   
-  if (m_serverBuffer.empty ())
+  // the replies of a batch leave back-to-back
+  std::vector<ServerQueueEntry> &inService = m_channels[channel].inService;
+  for (std::vector<ServerQueueEntry>::const_iterator it = inService.begin (); it != inService.end (); ++it)
   {
-    NS_LOG_LOGIC ("Server buffer is empty. Return!");
-    return;
+    Complete (*it);
   }
+  m_inServicePackets -= inService.size ();
+  inService.clear ();
+  m_busyChannels--;
+  UpdateQueueAverages ();
+  
+  ScheduleTransmit ();
+}
+
+Time
+UdpEchoServer::DrawServiceTime (double cost, bool deterministic)
+{
+  // the fluid background load takes its share of the capacity
+  UpdateFluid ();
+  cost /= 1.0 - GetBackgroundShare ();
+  if (deterministic)
+  {
+    return Seconds (cost / m_Mue);
+  }
+  return Seconds ((-cost / m_Mue) * log (m_rng->GetValue (0.0, 1.0)));
+}
+
+void
+UdpEchoServer::Complete (const ServerQueueEntry &entry)
+{
+  CacheFill (entry);
+  if (m_backends.empty ())
+  {
+    Reply (entry);
+  }
+  else
+  {
+    FanOut (entry);
+  }
+}
+
+Ptr<Packet>
+UdpEchoServer::CreateReply (const ServerQueueEntry &entry)
+{
+  NS_LOG_FUNCTION (this);
   
   Ptr<Packet> packet;
-  Address to;
   CommHeader oldHdr, newHdr;
   
-  packet = m_serverBuffer.front ().GetPacket ()->Copy ();
-  to = m_serverBuffer.front ().GetAddress ();
-  
-  m_serverBuffer.pop ();
+  packet = entry.GetPacket ()->Copy ();
   
   // Remove the communication header
   packet->RemoveHeader (oldHdr);
   
+  ClassStats &stats = m_classStats[std::min<uint32_t> (oldHdr.GetTrafficClass (), m_numClasses - 1)];
+  stats.served++;
+  Time sojourn = Simulator::Now () - entry.GetEnqueueTime ();
+  stats.sojourn.Add (sojourn.GetSeconds ());
+  m_sojournTrace (sojourn);
+  
   // set the new header values
   newHdr.SetSentTime (oldHdr.GetSentTime ());
   newHdr.SetPacketType (CommHeader::REP_PACKET);
   newHdr.SetPacketAnalyzed (CommHeader::PACKET_ANALYZED);
+  newHdr.SetTrafficClass (oldHdr.GetTrafficClass ());
+  newHdr.SetSequenceNumber (oldHdr.GetSequenceNumber ());
+  newHdr.SetKey (oldHdr.GetKey ());
   
   // add the new communication header
   packet->AddHeader (newHdr);  
-  m_socket->SendTo (packet, 0, to);
+  return packet;
+}
+
+void
+UdpEchoServer::Reply(const ServerQueueEntry &entry)
+{
+  NS_LOG_FUNCTION (this);
   
-  if (InetSocketAddress::IsMatchingType (to))
+  Ptr<Packet> packet = CreateReply (entry);
+  if (m_responseSize == RESPONSE_ECHO)
   {
-    NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server sent " << 
-                               packet->GetSize () << 
-                               " bytes to " <<
-                               InetSocketAddress::ConvertFrom (to).GetIpv4 () << 
-                               " port " <<
-                               InetSocketAddress::ConvertFrom (to).GetPort ());
+    SendReply (packet, entry.GetPeer ());
+    return;
+  }
+  
+  // The reply payload is sized by its own distribution. Every fragment 
+  // carries the reply header, so the client can time its first and last 
+  // byte against the send time of the request.
+  CommHeader hdr;
+  packet->RemoveHeader (hdr);
+  uint32_t size = NextResponseSize ();
+  uint32_t payload = m_mtu - hdr.GetSerializedSize ();
+  uint32_t count = std::min<uint32_t> (std::max<uint32_t> ((size + payload - 1) / payload, 1), 65535);
+  size = std::min (size, count * payload);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Ptr<Packet> fragment = Create<Packet> (std::min (payload, size - i * payload));
+    hdr.SetFragmentIndex (i);
+    hdr.SetFragmentCount (count);
+    fragment->AddHeader (hdr);
+    SendReply (fragment, entry.GetPeer ());
   }
-  else if (Inet6SocketAddress::IsMatchingType (to))
+  m_responses++;
+  m_responseBytes += size;
+  m_fragmentsSent += count;
+}
+
+uint32_t
+UdpEchoServer::NextResponseSize (void)
+{
+  double u = m_rng->GetValue (0.0, 1.0);
+  switch (m_responseSize)
+  {
+  case RESPONSE_EXPONENTIAL:
+    return (uint32_t) (-(double) m_responseSizeMean * log (1.0 - u));
+  case RESPONSE_PARETO:
+    {
+      // the scale giving the mean: x_m = mean (shape - 1) / shape
+      double scale = m_responseSizeMean * (m_responseSizeShape - 1.0) / m_responseSizeShape;
+      return (uint32_t) std::min (scale / std::pow (1.0 - u, 1.0 / m_responseSizeShape), 4e9);
+    }
+  default:
+    return m_responseSizeMean;
+  }
+}
+
+void
+UdpEchoServer::SendReply (Ptr<Packet> packet, uint32_t peer)
+{
+  NS_LOG_FUNCTION (this << packet << peer);
+  
+  if (m_pacingRate.GetBitRate () == 0)
+  {
+    Transmit (packet, peer);
+    return;
+  }
+  
+  ReplyQueueEntry reply;
+  reply.packet = packet;
+  reply.peer = peer;
+  reply.enqueueTime = Simulator::Now ();
+  m_replyQueue.push (reply);
+  m_replyQueueLength = m_replyQueue.size ();
+  
+  if (!m_pacingEvent.IsRunning ())
   {
-    NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server sent " << 
-                               packet->GetSize () << 
-                               " bytes to " <<
-                               Inet6SocketAddress::ConvertFrom (to).GetIpv6 () << 
-                               " port " <<
-                               Inet6SocketAddress::ConvertFrom (to).GetPort ());
-  }  
+    DrainReplyQueue ();
+  }
+}
+
+void
+UdpEchoServer::AddBackend (Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  NS_ABORT_MSG_IF (!InetSocketAddress::IsMatchingType (address), 
+                   "UdpEchoServer: a backend is an InetSocketAddress");
+  m_backends.push_back (address);
+}
+
+const EchoSketch &
+UdpEchoServer::GetSubRequestRtt (void) const
+{
+  return m_pending.GetSubRequestRtt ();
+}
+
+const EchoSketch &
+UdpEchoServer::GetFanOutLatency (void) const
+{
+  return m_pending.GetLatency ();
+}
+
+uint32_t
+UdpEchoServer::GetFanOutTimeouts (void) const
+{
+  return m_pending.GetTimeouts ();
+}
+
+void
+UdpEchoServer::FanOut (const ServerQueueEntry &entry)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t index, tag, first;
+  if (!m_pending.Start (entry, Simulator::Now (), index, tag, first))
+  {
+    NS_LOG_LOGIC ("The pending table is full. Drop the request");
+    return;
+  }
+  
+  // the sub-requests carry the payload size, the class and the key of the request
+  CommHeader requestHdr;
+  entry.GetPacket ()->PeekHeader (requestHdr);
+  CommHeader hdr;
+  hdr.SetSentTime (Simulator::Now ());
+  hdr.SetPacketType (CommHeader::REQ_PACKET);
+  hdr.SetPacketAnalyzed (CommHeader::PACKET_NOTANALYZED);
+  hdr.SetTrafficClass (requestHdr.GetTrafficClass ());
+  hdr.SetSequenceNumber (tag);
+  hdr.SetKey (requestHdr.GetKey ());
+  Ptr<Packet> subRequest = Create<Packet> (entry.GetPacket ()->GetSize () - hdr.GetSerializedSize ());
+  subRequest->AddHeader (hdr);
+  
+  for (uint32_t i = 0; i < m_pending.GetFanOut (); i++)
+  {
+    m_backendSocket->SendTo (subRequest->Copy (), 0, m_backends[(first + i) % m_backends.size ()]);
+  }
+  
+  if (m_fanOutTimeout.IsStrictlyPositive ())
+  {
+    m_fanOutTimeoutEvents[index] = Simulator::Schedule (m_fanOutTimeout, &UdpEchoServer::CompleteFanOut, this, index, true);
+  }
+}
+
+void
+UdpEchoServer::HandleBackendRead (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      CommHeader hdr;
+      packet->RemoveHeader (hdr);
+      if (hdr.GetFragmentIndex () != 0)
+      {
+        // a backend with a ResponseSize replies in fragments; a sub-reply
+        // counts once, with its first fragment
+        continue;
+      }
+      uint32_t index;
+      if (m_pending.Receive (hdr.GetSequenceNumber (), Simulator::Now () - hdr.GetSentTime (), index))
+      {
+        CompleteFanOut (index, false);
+      }
+    }
+}
+
+void
+UdpEchoServer::CompleteFanOut (uint32_t index, bool timedOut)
+{
+  NS_LOG_FUNCTION (this << index << timedOut);
+
+  Simulator::Cancel (m_fanOutTimeoutEvents[index]);
+  // the sojourn of the reply includes the fan-out
+  Reply (m_pending.Complete (index, Simulator::Now (), timedOut));
+}
+
+void
+UdpEchoServer::DrainReplyQueue (void)
+{
+  NS_LOG_FUNCTION (this);
+  
+  // refill the token bucket
+  Time now = Simulator::Now ();
+  m_tokens += (now - m_lastTokenUpdate).GetSeconds () * m_pacingRate.GetBitRate () / 8.0;
+  m_tokens = std::min (m_tokens, (double) m_pacingBurst);
+  m_lastTokenUpdate = now;
+  
+  while (!m_replyQueue.empty ())
+  {
+    ReplyQueueEntry &reply = m_replyQueue.front ();
+    
+    // a reply larger than the bucket leaves once the bucket is full
+    double needed = std::min ((double) reply.packet->GetSize (), (double) m_pacingBurst);
+    if (m_tokens < needed)
+    {
+      Time wait = GetPacingWait (needed - m_tokens, m_pacingRate);
+      m_pacingEvent = Simulator::Schedule (wait, &UdpEchoServer::DrainReplyQueue, this);
+      return;
+    }
+    m_tokens -= reply.packet->GetSize ();
+    
+    Time delay = now - reply.enqueueTime;
+    m_pacedReplies++;
+    m_pacingDelaySum += delay.GetSeconds ();
+    m_pacingDelayMax = std::max (m_pacingDelayMax, delay.GetSeconds ());
+    
+    Transmit (reply.packet, reply.peer);
+    m_replyQueue.pop ();
+    m_replyQueueLength = m_replyQueue.size ();
+  }
+}
+
+void
+UdpEchoServer::Transmit (Ptr<Packet> packet, uint32_t peer)
+{
+  NS_LOG_FUNCTION (this << packet << peer);
+  
+  const Address &to = m_peers.Get (peer);
+  m_socket->SendTo (packet, 0, to);
+  m_txBytes += packet->GetSize ();
+  
+  if (EchoTrace::IsEnabled ())
+  {
+    CommHeader hdr;
+    packet->PeekHeader (hdr);
+    EchoTrace::Record (ECHO_TRACE_SERVER_TX, GetNode ()->GetId (), peer,
+                       packet->GetSize (), hdr.GetSequenceNumber ());
+  }
   m_sent++;
 }
 
@@ -309,11 +1112,15 @@ UdpEchoServer::SendPeriodicStat(void)
   hdr.SetRuCommand (eslr::NO);
   hdr.SetRoutingTableRequestType (eslr::NON);
   hdr.SetAuthType (eslr::PLAIN_TEXT); 
-  hdr.SetAuthData (1234); 
+  hdr.SetAuthData (m_authData); 
+  
+  m_advertisedMue = GetMue ();
+  m_advertisedLambda = GetLambda ();
+  m_lastStatTime = Simulator::Now ();
   
   eslr::SRCHeader srcHeader;
-  srcHeader.SetMue (uint32_t (GetMue ()));
-  srcHeader.SetLambda (uint32_t (GetLambda ()));
+  srcHeader.SetMue (uint32_t (m_advertisedMue));
+  srcHeader.SetLambda (uint32_t (m_advertisedLambda));
   
   srcHeader.SetServerAddress (m_localAddress);
   srcHeader.SetNetMask (m_netMask);
@@ -322,9 +1129,703 @@ UdpEchoServer::SendPeriodicStat(void)
   
   p->AddHeader (hdr);
   
-  m_socket->SendTo (p, 0, InetSocketAddress (m_ispAddress, 276));   
+  m_socket->SendTo (p, 0, InetSocketAddress (m_ispAddress, m_ispPort));   
+}
+
+/**
+ * \brief get the relative change of a value
+ * \param oldValue the advertised value
+ * \param newValue the current value
+ * \return |new - old| / old, or 1 if only the old value is zero
+ */
+static double
+RelativeChange (double oldValue, double newValue)
+{
+  if (oldValue == 0.0)
+  {
+    return (newValue == 0.0) ? 0.0 : 1.0;
+  }
+  return std::fabs (newValue - oldValue) / oldValue;
+}
+
+void
+UdpEchoServer::UpdateLambda (void)
+{
+  NS_LOG_FUNCTION (this);
+  
+  // the fluid queue was served with the capacity left by the old lambda
+  UpdateFluid ();
+  
+  Time elapsed = Simulator::Now () - m_lambdaTime;
+  if (elapsed.IsStrictlyPositive ())
+  {
+    m_lambdaArrivals = m_received - m_lambdaReceived;
+    m_Lambda = m_lambdaArrivals / elapsed.GetSeconds ();
+  }
+  m_lambdaReceived = m_received;
+  m_lambdaTime = Simulator::Now ();
+}
+
+void
+UdpEchoServer::CheckPeriodicStat(void)
+{
+  NS_LOG_FUNCTION (this);
+  
+  UpdateLambda ();
+  
+  // A lambda measured over n Poisson arrivals has a relative standard error
+  // of 1 / sqrt (n), so the difference of two such samples moves by more
+  // than the threshold at modest rates. A change within two standard errors
+  // of that difference is noise.
+  double lambdaThreshold = m_statChangeThreshold;
+  if (m_lambdaArrivals > 0 && GetLambda () > 0.0)
+  {
+    double noise = 2.0 * std::sqrt (2.0 / m_lambdaArrivals) * m_Lambda / GetLambda ();
+    lambdaThreshold = std::max (lambdaThreshold, noise);
+  }
+  
+  // Advertise early if lambda or mue moved, and at least every max interval. 
+  // Otherwise the advertisement is suppressed.
+  if (Simulator::Now () - m_lastStatTime >= m_statMaxInterval ||
+      RelativeChange (m_advertisedLambda, GetLambda ()) > lambdaThreshold ||
+      RelativeChange (m_advertisedMue, GetMue ()) > m_statChangeThreshold)
+  {
+    SendPeriodicStat ();
+    m_statSent++;
+  }
+  else
+  {
+    NS_LOG_LOGIC ("Server statistics are stable. Suppress the advertisement");
+    m_statSuppressed++;
+  }
+  
+  m_nextPeriodicUpdate = Simulator::Schedule (m_statMinInterval, &UdpEchoServer::CheckPeriodicStat, this);  
+}
+
+void
+UdpEchoServer::SetBackgroundRate (double rate)
+{
+  NS_LOG_FUNCTION (this << rate);
+  NS_ABORT_MSG_IF (rate < 0.0, "UdpEchoServer: negative background rate");
+  
+  UpdateFluid ();
+  m_backgroundRate = rate;
+}
+
+double
+UdpEchoServer::GetBackgroundBacklog (void)
+{
+  NS_LOG_FUNCTION (this);
+  
+  UpdateFluid ();
+  return m_fluidBacklog;
+}
+
+void
+UdpEchoServer::UpdateFluid (void)
+{
+  NS_LOG_FUNCTION (this);
+  
+  Time now = Simulator::Now ();
+  if (m_backgroundRate == 0.0 && m_fluidBacklog == 0.0)
+  {
+    m_fluidTime = now;
+    return;
+  }
+  
+  // The fluid is served with the capacity the packet level requests leave,
+  // but never with less than 1% of the capacity.
+  double capacity = (double) m_serviceDataRate.GetBitRate () * GetCapacity ();
+  double foreground = m_Lambda * m_avgPacketSize * 8.0;
+  double mue = std::max (capacity - foreground, 0.01 * capacity) / (m_backgroundPacketSize * 8.0);
+  
+  // Backward Euler steps of dx/dt = lambda - mue x / (1 + x), stable for
+  // any step. x' = x + h (lambda - mue x' / (1 + x')) is the positive root 
+  // of x'^2 + (1 + h mue - a) x' - a = 0 with a = x + h lambda.
+  double x = m_fluidBacklog;
+  double remaining = (now - m_fluidTime).GetSeconds ();
+  double step = m_fluidStep.GetSeconds ();
+  while (remaining > 0.0)
+  {
+    double h = std::min (step, remaining);
+    double a = x + h * m_backgroundRate;
+    double b = 1.0 + h * mue - a;
+    double next = (-b + std::sqrt (b * b + 4.0 * a)) / 2.0;
+    m_fluidServed += a - next;
+    m_fluidBacklogIntegral += h * next;
+    x = next;
+    remaining -= h;
+  }
+  m_fluidBacklog = x;
+  m_fluidTime = now;
+}
+
+double
+UdpEchoServer::GetBackgroundShare (void)
+{
+  double x = m_fluidBacklog;
+  if (x == 0.0)
+  {
+    return 0.0;
+  }
+  
+  // the fluid is served at mue x / (1 + x) requests/s
+  double capacity = (double) m_serviceDataRate.GetBitRate () * GetCapacity ();
+  double foreground = m_Lambda * m_avgPacketSize * 8.0;
+  double fluidCapacity = std::max (capacity - foreground, 0.01 * capacity);
+  return std::min (fluidCapacity * x / (1.0 + x) / capacity, 0.99);
+}
+
+void
+UdpEchoServer::UpdateQueueAverages (void)
+{
+  Time now = Simulator::Now ();
+  m_queueLengthAverage.Update (now, m_queuedPackets);
+  m_queueBytesAverage.Update (now, m_queuedBytes);
+  m_inServiceAverage.Update (now, m_inServicePackets);
+  m_busyAverage.Update (now, m_busyChannels);
+  m_activeAverage.Update (now, m_activeChannels);
+  m_capacityAverage.Update (now, m_capacity);
+}
+
+double
+UdpEchoServer::GetTimeAverage (const EchoTimeAverage &average)
+{
+  return average.Get (m_startTime, Simulator::Now ());
+}
+
+double
+UdpEchoServer::GetMeanQueueLength (void)
+{
+  return GetTimeAverage (m_queueLengthAverage);
+}
+
+double
+UdpEchoServer::GetMeanQueueBytes (void)
+{
+  return GetTimeAverage (m_queueBytesAverage);
+}
+
+double
+UdpEchoServer::GetMeanInService (void)
+{
+  return GetTimeAverage (m_inServiceAverage);
+}
+
+double
+UdpEchoServer::GetUtilization (void)
+{
+  double active = GetTimeAverage (m_activeAverage);
+  return active > 0.0 ? GetTimeAverage (m_busyAverage) / active : 0.0;
+}
+
+double
+UdpEchoServer::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+double
+UdpEchoServer::GetMeanCapacity (void)
+{
+  return GetTimeAverage (m_capacityAverage);
+}
+
+uint32_t
+UdpEchoServer::GetScaleUps (void) const
+{
+  return m_autoscaler.GetScaleUps ();
+}
+
+uint32_t
+UdpEchoServer::GetScaleDowns (void) const
+{
+  return m_autoscaler.GetScaleDowns ();
+}
+
+void
+UdpEchoServer::Autoscale (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // the load of the interval from the integrals of the time averages
+  UpdateQueueAverages ();
+  double interval = m_autoscaleInterval.GetSeconds ();
+  double active = (m_activeAverage.area - m_lastActiveArea) / interval;
+  double load;
+  if (m_autoscaleMetric == EchoAutoscaler::UTILIZATION)
+    {
+      load = (m_busyAverage.area - m_lastBusyArea) / interval / active;
+    }
+  else
+    {
+      load = (m_queueLengthAverage.area - m_lastQueueArea) / interval / active;
+    }
+  m_lastBusyArea = m_busyAverage.area;
+  m_lastActiveArea = m_activeAverage.area;
+  m_lastQueueArea = m_queueLengthAverage.area;
+  EchoAutoscaler::Action action = m_autoscaler.Evaluate (load, Simulator::Now ());
+  NS_LOG_LOGIC ("load " << load << " smoothed " << m_autoscaler.GetSmoothedLoad () << " capacity " << m_capacity);
+
+  if (action == EchoAutoscaler::PROVISION)
+    {
+      m_provisionEvent = Simulator::Schedule (m_provisioningDelay, &UdpEchoServer::ScaleUp, this);
+    }
+  else if (action == EchoAutoscaler::SCALE_DOWN)
+    {
+      SetCapacity (m_autoscaler.GetChannels (), m_autoscaler.GetFrequency ());
+    }
+  m_autoscaleEvent = Simulator::Schedule (m_autoscaleInterval, &UdpEchoServer::Autoscale, this);
+}
+
+void
+UdpEchoServer::ScaleUp (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_autoscaler.ScaleUp ();
+  SetCapacity (m_autoscaler.GetChannels (), m_autoscaler.GetFrequency ());
+  // the new capacity starts on the waiting requests at once
+  if (m_queuedPackets != 0)
+    {
+      ScheduleTransmit ();
+    }
+}
+
+void
+UdpEchoServer::SetCapacity (uint32_t channels, double frequency)
+{
+  NS_LOG_FUNCTION (this << channels << frequency);
+
+  // the fluid and the averages are accounted with the old capacity
+  UpdateFluid ();
+  UpdateQueueAverages ();
+  m_activeChannels = channels;
+  m_frequency = frequency;
+  m_capacity = channels * frequency;
+  if (m_avgPacketSize > 0.0)
+    {
+      m_Mue = m_serviceDataRate.GetBitRate () * m_frequency / (m_avgPacketSize * 8.0);
+    }
+  UpdateQueueAverages ();
+}
+
+void
+UdpEchoServer::SampleQueue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_queueSamples.size () >= m_maxSamples)
+    {
+      // keep the even samples, i.e., the whole run at half the resolution
+      for (uint32_t i = 0; 2 * i < m_queueSamples.size (); i++)
+        {
+          m_queueSamples[i] = m_queueSamples[2 * i];
+        }
+      m_queueSamples.resize ((m_queueSamples.size () + 1) / 2);
+      m_samplePeriod = m_samplePeriod + m_samplePeriod;
+      // the current time is not on the coarser grid if the count was odd
+      Time next = m_sampleStart + Time ((int64_t) (m_samplePeriod.GetTimeStep () * m_queueSamples.size ()));
+      if (Simulator::Now () < next)
+        {
+          m_sampleEvent = Simulator::Schedule (next - Simulator::Now (), &UdpEchoServer::SampleQueue, this);
+          return;
+        }
+    }
+
+  QueueSample sample;
+  sample.packets = m_queuedPackets;
+  sample.bytes = m_queuedBytes;
+  sample.busyChannels = m_busyChannels;
+  sample.inService = m_inServicePackets;
+  m_queueSamples.push_back (sample);
+  m_sampleEvent = Simulator::Schedule (m_samplePeriod, &UdpEchoServer::SampleQueue, this);
+}
+
+const std::vector<UdpEchoServer::QueueSample> &
+UdpEchoServer::GetQueueSamples (void) const
+{
+  return m_queueSamples;
+}
+
+Time
+UdpEchoServer::GetSampleStart (void) const
+{
+  return m_sampleStart;
+}
+
+Time
+UdpEchoServer::GetSampleInterval (void) const
+{
+  return m_samplePeriod;
+}
+
+uint32_t
+UdpEchoServer::SelectClass (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_queuedPackets != 0);
+
+  if (m_scheduling == STRICT_PRIORITY)
+  {
+    for (uint32_t c = 0; c < m_numClasses; c++)
+    {
+      if (!m_serverBuffer[c].empty ())
+      {
+        return c;
+      }
+    }
+  }
+  else
+  {
+    // Weighted round robin: a class is served up to its weight in packets
+    // per round. Once every backlogged class used up its credits, a new
+    // round is started.
+    for (uint32_t round = 0; round < 2; round++)
+    {
+      for (uint32_t i = 0; i < m_numClasses; i++)
+      {
+        uint32_t c = (m_nextClass + i) % m_numClasses;
+        if (!m_serverBuffer[c].empty () && m_classCredits[c] != 0)
+        {
+          m_classCredits[c]--;
+          m_nextClass = (m_classCredits[c] != 0) ? c : (c + 1) % m_numClasses;
+          return c;
+        }
+      }
+      m_classCredits = m_classWeights;
+    }
+  }
+  NS_FATAL_ERROR ("No backlogged class found");
+  return 0;
+}
+
+void
+UdpEchoServer::ParseClassWeights (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_classWeights.assign (m_numClasses, 1);
+
+  std::istringstream iss (m_classWeightsString);
+  std::string token;
+  uint32_t c = 0;
+  while (std::getline (iss, token, ':') && c < m_numClasses)
+  {
+    uint32_t weight = std::atoi (token.c_str ());
+    NS_ABORT_MSG_IF (weight == 0, "UdpEchoServer: class weights must be positive integers");
+    m_classWeights[c++] = weight;
+  }
+  m_classCredits = m_classWeights;
+  m_nextClass = 0;
+}
+
+bool
+UdpEchoServer::PipelineSource (ServerQueueEntry &entry, double &cost)
+{
+  if (m_queuedPackets == 0)
+  {
+    return false;
+  }
+  std::queue<ServerQueueEntry> &buffer = m_serverBuffer[SelectClass ()];
+  entry = buffer.front ();
+  buffer.pop ();
+  m_queuedPackets--;
+  m_queuedBytes -= entry.GetPacket ()->GetSize ();
+  m_inServicePackets++;
+  UpdateQueueAverages ();
+  m_waitTrace (Simulator::Now () - entry.GetEnqueueTime ());
+  cost = CacheLookup (entry);
+  return true;
+}
+
+void
+UdpEchoServer::PipelineSink (const ServerQueueEntry &entry)
+{
+  m_inServicePackets--;
+  UpdateQueueAverages ();
+  Complete (entry);
+}
+
+uint32_t
+UdpEchoServer::GetStageCount (void) const
+{
+  return m_pipeline.GetStageCount ();
+}
+
+double
+UdpEchoServer::GetStageUtilization (uint32_t stage)
+{
+  NS_ASSERT (stage < m_pipeline.GetStageCount ());
+  return m_pipeline.GetUtilization (stage);
+}
+
+double
+UdpEchoServer::GetStageBlocking (uint32_t stage)
+{
+  NS_ASSERT (stage < m_pipeline.GetStageCount ());
+  return m_pipeline.GetBlocking (stage);
+}
+
+void
+UdpEchoServer::PrintStageStats (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // The capacity of a stage is its workers over its mean service time. The
+  // bottleneck has the lowest capacity and the highest utilization; the
+  // stages before it spend their time blocked.
+  uint32_t bottleneck = 0;
+  double bottleneckUtilization = 0.0;
+  for (uint32_t i = 0; i < m_pipeline.GetStageCount (); i++)
+  {
+    const EchoPipeline::Stage &st = m_pipeline.GetStage (i);
+    uint32_t workers = st.workers.size ();
+    double utilization = GetStageUtilization (i);
+    if (utilization > bottleneckUtilization)
+    {
+      bottleneck = i;
+      bottleneckUtilization = utilization;
+    }
+    std::cout << "server " << GetNode ()->GetId () << " stage " << i << 
+                 ": workers: " << workers << 
+                 " work: " << st.work << 
+                 " capacity: " << workers * m_Mue / st.work << 
+                 " served: " << st.served << 
+                 " buffer: " << (i == 0 ? m_maxQueueSize : st.queueSize) << 
+                 " mean queue: " << (i == 0 ? GetMeanQueueLength () : m_pipeline.GetMeanQueueLength (i)) << 
+                 " max queue: " << st.maxQueueLength << 
+                 " utilization: " << utilization << 
+                 " blocked: " << GetStageBlocking (i) << 
+                 " latency p50/p99: " << st.latency.GetQuantile (0.50) << 
+                 " " << st.latency.GetQuantile (0.99) << std::endl;
+  }
+  std::cout << "server " << GetNode ()->GetId () << " pipeline bottleneck: stage " << bottleneck << 
+               " utilization: " << bottleneckUtilization << std::endl;
+}
+
+uint64_t
+UdpEchoServer::GetRxBytes (void) const
+{
+  return m_rxBytes;
+}
+
+uint64_t
+UdpEchoServer::GetTxBytes (void) const
+{
+  return m_txBytes;
+}
+
+double
+UdpEchoServer::GetFragmentsPerReply (void) const
+{
+  return m_responses ? (double) m_fragmentsSent / m_responses : 0.0;
+}
+
+uint32_t
+UdpEchoServer::GetPacedReplies (void) const
+{
+  return m_pacedReplies;
+}
+
+uint32_t
+UdpEchoServer::GetReplyQueueLength (void) const
+{
+  return m_replyQueue.size ();
+}
+
+Time
+UdpEchoServer::GetPacingWait (double deficit, DataRate rate)
+{
+  double ns = std::ceil (deficit * 8e9 / rate.GetBitRate ());
+  return NanoSeconds ((uint64_t) std::max (ns, 1.0));
+}
+
+const EchoCache &
+UdpEchoServer::GetCache (void) const
+{
+  return m_cache;
+}
+
+double
+UdpEchoServer::GetCacheHitRatio (uint32_t trafficClass) const
+{
+  NS_ASSERT (trafficClass < m_classStats.size ());
+  const ClassStats &stats = m_classStats[trafficClass];
+  uint32_t lookups = stats.cacheHits + stats.cacheMisses;
+  return lookups ? (double) stats.cacheHits / lookups : 0.0;
+}
+
+double
+UdpEchoServer::GetEffectiveCapacity (void)
+{
+  double hitRatio = m_cache.GetHitRatio ();
+  return GetMue () / (hitRatio * m_cacheHitCost + 1.0 - hitRatio);
+}
+
+double
+UdpEchoServer::CacheLookup (const ServerQueueEntry &entry)
+{
+  if (!m_cache.IsEnabled ())
+  {
+    return 1.0;
+  }
+  CommHeader hdr;
+  entry.GetPacket ()->PeekHeader (hdr);
+  if (hdr.GetKey () == 0)
+  {
+    return 1.0;
+  }
+  ClassStats &stats = m_classStats[std::min<uint32_t> (hdr.GetTrafficClass (), m_numClasses - 1)];
+  if (m_cache.Lookup (hdr.GetKey ()))
+  {
+    stats.cacheHits++;
+    return m_cacheHitCost;
+  }
+  stats.cacheMisses++;
+  return 1.0;
+}
+
+void
+UdpEchoServer::CacheFill (const ServerQueueEntry &entry)
+{
+  if (!m_cache.IsEnabled ())
+  {
+    return;
+  }
+  CommHeader hdr;
+  entry.GetPacket ()->PeekHeader (hdr);
+  if (hdr.GetKey () != 0)
+  {
+    m_cache.Insert (hdr.GetKey ());
+  }
+}
+
+void
+UdpEchoServer::PrintClassStats (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t c = 0; c < m_classStats.size (); c++)
+  {
+    ClassStats &stats = m_classStats[c];
+    std::cout << "server " << GetNode ()->GetId () << " class " << c << 
+                 ": enqueued: " << stats.enqueued << 
+                 " served: " << stats.served << 
+                 " dropped: " << stats.dropped << 
+                 " backlog: " << m_serverBuffer[c].size () << 
+                 " max queue: " << stats.maxQueueLength << 
+                 " sojourn p50/p90/p99: " << stats.sojourn.GetQuantile (0.50) << 
+                 " " << stats.sojourn.GetQuantile (0.90) << 
+                 " " << stats.sojourn.GetQuantile (0.99) << std::endl;
+  }
+  
+  if (m_cache.IsEnabled ())
+  {
+    std::cout << "server " << GetNode ()->GetId () << " cache: " <<
+                 (m_cachePolicy == EchoCache::LFU ? "lfu" : "lru") << 
+                 " size: " << m_cache.GetSize () << "/" << m_cache.GetCapacity () << 
+                 " hits: " << m_cache.GetHits () << 
+                 " misses: " << m_cache.GetMisses () << 
+                 " evictions: " << m_cache.GetEvictions () << 
+                 " hit ratio: " << m_cache.GetHitRatio () << 
+                 " class hit ratios:";
+    for (uint32_t c = 0; c < m_classStats.size (); c++)
+    {
+      std::cout << " " << GetCacheHitRatio (c);
+    }
+    double hitRatio = m_cache.GetHitRatio ();
+    std::cout << " effective capacity: " << GetEffectiveCapacity () << 
+                 " speedup: " << 1.0 / (hitRatio * m_cacheHitCost + 1.0 - hitRatio) << std::endl;
+  }
+  
+  if (m_responseSize != RESPONSE_ECHO)
+  {
+    std::cout << "server " << GetNode ()->GetId () << " responses: " << m_responses << 
+                 " mean size: " << (m_responses ? (double) m_responseBytes / m_responses : 0.0) << 
+                 " fragments: " << m_fragmentsSent << 
+                 " per reply: " << GetFragmentsPerReply () << 
+                 " rx bytes: " << m_rxBytes << 
+                 " tx bytes: " << m_txBytes << 
+                 " egress/ingress: " << (m_rxBytes ? (double) m_txBytes / m_rxBytes : 0.0) << std::endl;
+  }
+  
+  if (m_pacingRate.GetBitRate () != 0)
+  {
+    std::cout << "server " << GetNode ()->GetId () << " pacing: " <<
+                 "paced: " << m_pacedReplies << 
+                 " backlog: " << m_replyQueue.size () << 
+                 " mean delay: " << (m_pacedReplies ? m_pacingDelaySum / m_pacedReplies : 0.0) << 
+                 " max delay: " << m_pacingDelayMax << std::endl;
+  }
+  
+  double fluidTime = (m_fluidTime - m_fluidStart).GetSeconds ();
+  if (m_fluidServed != 0.0 && fluidTime > 0.0)
+  {
+    // Little's law gives the mean delay of the fluid requests
+    double meanBacklog = m_fluidBacklogIntegral / fluidTime;
+    double throughput = m_fluidServed / fluidTime;
+    std::cout << "server " << GetNode ()->GetId () << " background: " <<
+                 "rate: " << m_backgroundRate << 
+                 " served: " << m_fluidServed << 
+                 " backlog: " << m_fluidBacklog << 
+                 " mean backlog: " << meanBacklog << 
+                 " mean delay: " << meanBacklog / throughput << 
+                 " utilization: " << throughput * m_backgroundPacketSize * 8.0 / 
+                                     ((double) m_serviceDataRate.GetBitRate () * GetMeanCapacity ()) << std::endl;
+  }
+  
+  if (!m_backends.empty ())
+  {
+    // The tail amplification is the fan-out p99 over the sub-request p99.
+    // With independent backends, the p99 of a quorum of K sub-requests is
+    // the QuorumQuantile of the sub-requests (0.99^(1/K) for K of K).
+    uint32_t fanOut = m_pending.GetFanOut ();
+    uint32_t quorum = m_pending.GetQuorum ();
+    const EchoSketch &subRtt = m_pending.GetSubRequestRtt ();
+    const EchoSketch &latency = m_pending.GetLatency ();
+    double subP99 = subRtt.GetQuantile (0.99);
+    std::cout << "server " << GetNode ()->GetId () << " fan-out: " << fanOut <<
+                 " completed: " << m_pending.GetCompleted () << 
+                 " timeouts: " << m_pending.GetTimeouts () << 
+                 " dropped: " << m_pending.GetDropped () << 
+                 " late sub-replies: " << m_pending.GetLateSubReplies () << 
+                 " sub-request p50/p99: " << subRtt.GetQuantile (0.50) << 
+                 " " << subP99 << 
+                 " fan-out p50/p99/p99.9: " << latency.GetQuantile (0.50) << 
+                 " " << latency.GetQuantile (0.99) << 
+                 " " << latency.GetQuantile (0.999) << 
+                 " p99 amplification: " << (subP99 > 0 ? latency.GetQuantile (0.99) / subP99 : 0.0) << 
+                 " quorum: " << quorum << 
+                 " independent p99: " << subRtt.GetQuantile (EchoFanOut::QuorumQuantile (0.99, quorum, fanOut)) << std::endl;
+  }
+  
+  if (m_pipeline.IsEnabled ())
+  {
+    PrintStageStats ();
+  }
+  
+  if (m_autoscaler.IsEnabled ())
+  {
+    std::cout << "server " << GetNode ()->GetId () << " autoscale: " <<
+                 "capacity: " << m_capacity << 
+                 " channels: " << m_activeChannels << 
+                 " frequency: " << m_frequency << 
+                 " mean capacity: " << GetMeanCapacity () << 
+                 " scale ups: " << m_autoscaler.GetScaleUps () << 
+                 " scale downs: " << m_autoscaler.GetScaleDowns () << 
+                 " smoothed load: " << m_autoscaler.GetSmoothedLoad () << std::endl;
+  }
+  
+  std::cout << "server " << GetNode ()->GetId () << " queue: " <<
+               "mean length: " << GetMeanQueueLength () << 
+               " mean bytes: " << GetMeanQueueBytes () << 
+               " mean in service: " << GetMeanInService () << 
+               " utilization: " << GetUtilization () << std::endl;
   
-  m_nextPeriodicUpdate = Simulator::Schedule (Seconds (10), &UdpEchoServer::SendPeriodicStat, this);  
+  std::cout << "server " << GetNode ()->GetId () << " advertisements: " <<
+               "sent: " << m_statSent << 
+               " suppressed: " << m_statSuppressed << std::endl;
 }
 
 } // Namespace ns3
@@ -19,14 +19,27 @@
 #ifndef UDP_ECHO_SERVER_H
 #define UDP_ECHO_SERVER_H
 
+#include <deque>
 #include <queue>
+#include <vector>
+#include <string>
 
 #include "ns3/application.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/address.h"
+#include "ns3/data-rate.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+#include "ns3/nstime.h"
 
 #include "server-packet-queue.h"
+#include "echo-sketch.h"
+#include "echo-cache.h"
+#include "echo-time-average.h"
+#include "echo-autoscaler.h"
+#include "echo-fanout.h"
+#include "echo-pipeline.h"
 #include "ns3/random-variable-stream.h" 
 
 namespace ns3 {
@@ -44,10 +57,97 @@ class Packet;
  * \brief A Udp Echo server
  *
  * Every packet received is sent back.
+ *
+ * Requests are buffered in one FIFO queue per traffic class (carried in
+ * the CommHeader) and the queues are served either in strict priority
+ * order or by weighted round robin, by one or more parallel channels with
+ * exponential or constant service times.
+ *
+ * A background client population can be modelled as fluid load instead of
+ * packets (BackgroundRate attribute). Its backlog x follows the pointwise
+ * stationary fluid flow approximation dx/dt = lambda - mue x / (1 + x),
+ * where mue is the capacity the packet level requests leave. The fluid
+ * takes its share of the capacity, so the packet level requests are served
+ * slower and see the delay the background load induces.
+ *
+ * With backends added (AddBackend), the server is an aggregator: a served
+ * request is fanned out as sub-requests to "FanOut" backends and replied
+ * once "Quorum" of them answered, or at "FanOutTimeout". The pending
+ * requests are kept in a preallocated table of "MaxPending" slots (an
+ * EchoFanOut).
+ *
+ * With "Autoscale" set, the capacity follows the load: every
+ * "AutoscaleInterval" the utilization (or the queue length per channel)
+ * of the interval is smoothed, and above "ScaleUpThreshold" a channel is
+ * added (or the frequency raised by a "FrequencyStep") once the
+ * "ProvisioningDelay" elapsed; below "ScaleDownThreshold" one is removed
+ * at once (the decisions are an EchoAutoscaler). The cooldowns keep the scaling actions apart. A removed
+ * channel finishes its batch first, and a new frequency applies to the
+ * batches started after the change.
+ *
+ * With "StageWork" set, a request goes through a tandem pipeline instead
+ * of the channels (e.g., parse, compute, respond): stage i takes its share
+ * of the service time of the request, has its own workers and service
+ * distribution, and a bounded buffer in front of it. A worker whose next
+ * stage is full keeps its request (blocking after service) until a slot
+ * frees up, so a slow stage backs up the stages before it (an
+ * EchoPipeline fed by the class buffers).
+ *
+ * With "CacheSize" set, the server keeps the responses of that many keys
+ * (carried in the CommHeader, see the KeyDistribution attribute of
+ * UdpEchoClient) with LRU or LFU eviction. A request whose key is cached
+ * at the start of its service costs "CacheHitCost" of the service time of
+ * a miss (in every pipeline stage); a served miss caches its key.
+ *
+ * By default a reply is the request sent back. With "ResponseSize" set,
+ * the reply payload size is drawn from its own distribution instead, and
+ * a reply larger than "Mtu" is split in to fragments which all carry the
+ * CommHeader of the request (its send time) with their index and count.
  */
 class UdpEchoServer : public Application 
 {
+  friend class UdpEchoBenchmark;
 public:
+  /**
+   * \brief How the per-class packet buffers are served
+   */
+  enum SchedulingMode
+  {
+    STRICT_PRIORITY, //!< always serve the lowest numbered non-empty class
+    WEIGHTED_FAIR, //!< weighted round robin over the non-empty classes
+  };
+
+  /**
+   * \brief The distribution of the service times
+   */
+  enum ServiceDistribution
+  {
+    EXPONENTIAL, //!< exponential service times (M/M/c)
+    DETERMINISTIC, //!< constant service times (M/D/c)
+  };
+
+  /**
+   * \brief The distribution of the reply payload sizes
+   */
+  enum ResponseSizeDistribution
+  {
+    RESPONSE_ECHO, //!< the reply is the request
+    RESPONSE_CONSTANT, //!< ResponseSizeMean bytes
+    RESPONSE_EXPONENTIAL, //!< exponential with mean ResponseSizeMean
+    RESPONSE_PARETO, //!< Pareto with mean ResponseSizeMean and shape ResponseSizeShape
+  };
+
+  /**
+   * \brief a sample of the queue state
+   */
+  struct QueueSample
+  {
+    uint32_t packets; //!< requests waiting in the class buffers
+    uint32_t bytes; //!< bytes waiting in the class buffers
+    uint32_t busyChannels; //!< channels serving a batch
+    uint32_t inService; //!< requests being served
+  };
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -56,6 +156,179 @@ public:
   UdpEchoServer ();
   virtual ~UdpEchoServer ();
 
+  /**
+   * \brief Assign a fixed random variable stream number to the random 
+   * variables used by this application
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \brief change the arrival rate of the fluid background load
+   * \param rate the arrival rate (requests/s), 0 switches the fluid arrivals off
+   */
+  void SetBackgroundRate (double rate);
+
+  /**
+   * \return the number of background requests in the fluid queue
+   */
+  double GetBackgroundBacklog (void);
+
+  /**
+   * \brief add a backend the requests are fanned out to
+   * \param address the InetSocketAddress of a UdpEchoServer
+   */
+  void AddBackend (Address address);
+
+  /**
+   * \return the RTTs of the sub-requests to the backends (s)
+   */
+  const EchoSketch &GetSubRequestRtt (void) const;
+
+  /**
+   * \return the times from the fan-out to the completion of the requests (s)
+   */
+  const EchoSketch &GetFanOutLatency (void) const;
+
+  /**
+   * \return the number of requests completed at the timeout, without the
+   * quorum
+   */
+  uint32_t GetFanOutTimeouts (void) const;
+
+  /**
+   * \brief get the queue state samples. Sample i was taken at the start
+   * time plus i sample intervals.
+   * \return the samples
+   */
+  const std::vector<QueueSample> &GetQueueSamples (void) const;
+
+  /**
+   * \return the time the first queue sample was taken
+   */
+  Time GetSampleStart (void) const;
+
+  /**
+   * \return the interval between two queue samples; it starts at
+   * SampleInterval and doubles every time the samples are decimated
+   */
+  Time GetSampleInterval (void) const;
+
+  /**
+   * \return the time average of the number of waiting requests since the start
+   */
+  double GetMeanQueueLength (void);
+
+  /**
+   * \return the time average of the waiting bytes since the start
+   */
+  double GetMeanQueueBytes (void);
+
+  /**
+   * \return the time average of the requests in service since the start
+   */
+  double GetMeanInService (void);
+
+  /**
+   * \return the time average of the fraction of busy channels since the start
+   */
+  double GetUtilization (void);
+
+  /**
+   * \return the service capacity, in channels at the nominal ServiceRate
+   * (the active channels times the frequency)
+   */
+  double GetCapacity (void) const;
+
+  /**
+   * \return the time average of the capacity since the start
+   */
+  double GetMeanCapacity (void);
+
+  /**
+   * \return the number of pipeline stages (0 if the channels serve the requests)
+   */
+  uint32_t GetStageCount (void) const;
+
+  /**
+   * \param stage the stage index
+   * \return the time average of the fraction of the workers of the stage
+   * serving a request
+   */
+  double GetStageUtilization (uint32_t stage);
+
+  /**
+   * \param stage the stage index
+   * \return the time average of the fraction of the workers of the stage
+   * blocked by the next stage
+   */
+  double GetStageBlocking (uint32_t stage);
+
+  /**
+   * \return the number of scale ups of the autoscaler
+   */
+  uint32_t GetScaleUps (void) const;
+
+  /**
+   * \return the number of scale downs of the autoscaler
+   */
+  uint32_t GetScaleDowns (void) const;
+
+  /**
+   * \return the response cache
+   */
+  const EchoCache &GetCache (void) const;
+
+  /**
+   * \param trafficClass the traffic class
+   * \return the cache hits over the lookups of the requests of the class
+   */
+  double GetCacheHitRatio (uint32_t trafficClass) const;
+
+  /**
+   * \return the requests per second the active channels serve at the
+   * observed hit ratio, mue / (h CacheHitCost + 1 - h), without the batch
+   * overhead
+   */
+  double GetEffectiveCapacity (void);
+
+  /**
+   * \return the bytes of the received requests
+   */
+  uint64_t GetRxBytes (void) const;
+
+  /**
+   * \return the bytes of the sent replies (all the fragments)
+   */
+  uint64_t GetTxBytes (void) const;
+
+  /**
+   * \return the mean number of packets of the replies sized by the
+   * ResponseSize distribution
+   */
+  double GetFragmentsPerReply (void) const;
+
+  /**
+   * \return the number of replies sent by the pacer
+   */
+  uint32_t GetPacedReplies (void) const;
+
+  /**
+   * \return the number of replies waiting for the pacer
+   */
+  uint32_t GetReplyQueueLength (void) const;
+
+  /**
+   * \brief get the time a token bucket takes to refill a deficit, rounded
+   * up to a whole ns and at least 1 ns: a shorter wait would round to 0 and
+   * reschedule the pacer at the same instant without refilling anything
+   * \param deficit the missing tokens in bytes
+   * \param rate the rate of the token bucket
+   * \return the wait
+   */
+  static Time GetPacingWait (double deficit, DataRate rate);
+
 protected:
   virtual void DoDispose (void);
 
@@ -75,58 +348,409 @@ private:
   void HandleRead (Ptr<Socket> socket);
 
   /**
-   * \brief Schedule the next packet transmission
+   * \brief start serving the buffered requests on the idle channels.
+   * A channel stays idle if the buffer is empty.
    */
   void ScheduleTransmit (void);  
+
+  /**
+   * \brief take the next batch of requests from the buffer in to the 
+   * service of a channel and schedule its completion
+   * \param channel the idle channel
+   */
+  void StartService (uint32_t channel);
+  
+  /**
+   * \brief reply the requests of the completed batch and serve the next one
+   * \param channel the channel which completed its batch
+   */
+  void ServiceComplete (uint32_t channel);
   
   /**
-   * \brief pick a packet from the buffer and reply the packet back to the sender
+   * \brief turn a served request in to its reply (swap the CommHeader)
+   * and account for it in the class statistics
+   * \param entry the served queue entry
+   * \return the reply packet
+   */
+  Ptr<Packet> CreateReply (const ServerQueueEntry &entry);
+
+  /**
+   * \brief reply a served packet back to the sender
+   * \param entry the served queue entry
    */  
-  void Reply(void);
+  void Reply(const ServerQueueEntry &entry);
+
+  /**
+   * \brief send a reply packet now, or queue it for the pacer
+   * \param packet the reply packet (or fragment)
+   * \param peer the index of the client in the peer table
+   */
+  void SendReply (Ptr<Packet> packet, uint32_t peer);
+
+  /**
+   * \brief draw the payload size of the next reply
+   * \return the size in bytes
+   */
+  uint32_t NextResponseSize (void);
+
+  /**
+   * \brief send the sub-requests of a served request to the backends, or
+   * drop the request if the pending table is full
+   * \param entry the served queue entry
+   */
+  void FanOut (const ServerQueueEntry &entry);
+
+  /**
+   * \brief Handle the reception of sub-replies from the backends
+   * \param socket the backend socket
+   */
+  void HandleBackendRead (Ptr<Socket> socket);
+
+  /**
+   * \brief reply a fanned out request and free its slot
+   * \param slot the index of the slot
+   * \param timedOut the quorum was not reached in time
+   */
+  void CompleteFanOut (uint32_t slot, bool timedOut);
+
+  /**
+   * \brief send the paced replies the token bucket allows and schedule 
+   * the next attempt if the replies have to wait for tokens
+   */
+  void DrainReplyQueue (void);
+
+  /**
+   * \brief send a reply packet to the client
+   * \param packet the reply packet
+   * \param peer the index of the client in the peer table
+   */
+  void Transmit (Ptr<Packet> packet, uint32_t peer);
   
   /**
-   * \brief get the up-to-date average arrival rate (pps)
+   * \brief measure the arrival rate over the requests received since the 
+   * previous update
+   */
+  void UpdateLambda (void);
+
+  /**
+   * \brief integrate the fluid background queue up to now
+   */
+  void UpdateFluid (void);
+
+  /**
+   * \brief get the fraction of the capacity the fluid background load is 
+   * currently served with. Call UpdateFluid first.
+   */
+  double GetBackgroundShare (void);
+
+  /**
+   * \brief get the average arrival rate (pps) of the last update interval,
+   * including the fluid background load
    */    
   double GetLambda (void)
   {
-    return ( m_Lambda = (m_received/Simulator::Now ().GetSeconds ()));
+    return m_Lambda + m_backgroundRate;
   }
   
   /**
-   * \brief get the average service rate (pps)
+   * \brief get the average service rate (pps) of all the channels
    */    
   double GetMue (void)
   {
-    return m_Mue; 
+    return m_Mue * m_activeChannels; 
   }
 
   /**
-   * \brief send the statistics of the server periodically
+   * \brief send the statistics of the server to the gateway
    */   
   void SendPeriodicStat(void);
 
+  /**
+   * \brief advertise the statistics of the server if they changed by more 
+   * than the threshold or the maximum interval elapsed. Called every 
+   * minimum interval.
+   */
+  void CheckPeriodicStat(void);
+
+  /**
+   * \brief select the traffic class to be served next
+   * \return the class index, the buffer of which is not empty
+   */
+  uint32_t SelectClass (void);
+
+  /**
+   * \brief parse the colon separated class weights (e.g., "4:2:1")
+   */
+  void ParseClassWeights (void);
+
+  /**
+   * \brief print the per-class statistics
+   */
+  void PrintClassStats (void);
+
+  /**
+   * \brief look the key of a request up in the cache at the start of its
+   * service
+   * \param entry the request
+   * \return the service time of the request over the one of a miss
+   */
+  double CacheLookup (const ServerQueueEntry &entry);
+
+  /**
+   * \brief cache the key of a served request
+   * \param entry the request
+   */
+  void CacheFill (const ServerQueueEntry &entry);
+
+  /**
+   * \brief account the queue state up to now in the time averages.
+   * Called after every change of the queue state.
+   */
+  void UpdateQueueAverages (void);
+
+  /**
+   * \brief record a queue sample and schedule the next one; halve the
+   * samples and double the interval when MaxSamples is reached
+   */
+  void SampleQueue (void);
+
+  /**
+   * \brief pass the load of the last interval to the autoscaler, apply
+   * its decision and schedule the next evaluation
+   */
+  void Autoscale (void);
+
+  /**
+   * \brief add the capacity provisioned by a scale up
+   */
+  void ScaleUp (void);
+
+  /**
+   * \brief change the active channels and the frequency
+   * \param channels the number of active channels
+   * \param frequency the service rate multiplier
+   */
+  void SetCapacity (uint32_t channels, double frequency);
+
+  /**
+   * \brief take the next request out of the class buffers in to the
+   * first pipeline stage
+   * \param entry the request
+   * \param cost the service time of the request over the one of a miss
+   * \return false if the buffers are empty
+   */
+  bool PipelineSource (ServerQueueEntry &entry, double &cost);
+
+  /**
+   * \brief a request left the last pipeline stage
+   * \param entry the request
+   */
+  void PipelineSink (const ServerQueueEntry &entry);
+
+  /**
+   * \brief cache a served request, then reply it or fan it out to the
+   * backends
+   * \param entry the served queue entry
+   */
+  void Complete (const ServerQueueEntry &entry);
+
+  /**
+   * \brief draw the service time of a work of the given cost, slowed down
+   * by the share of the fluid background load
+   * \param cost the work in requests of the nominal service rate
+   * \param deterministic constant instead of exponential service times
+   * \return the service time
+   */
+  Time DrawServiceTime (double cost, bool deterministic);
+
+  /**
+   * \brief print the per-stage statistics
+   */
+  void PrintStageStats (void);
+
+  /**
+   * \brief get a time average since the start of the application
+   */
+  double GetTimeAverage (const EchoTimeAverage &average);
+
+  /**
+   * \brief per traffic class counters
+   */
+  struct ClassStats
+  {
+    ClassStats () : enqueued (0), served (0), dropped (0), maxQueueLength (0), 
+                    cacheHits (0), cacheMisses (0) {}
+    uint32_t enqueued; //!< packets added to the class buffer
+    uint32_t served; //!< packets replied
+    uint32_t dropped; //!< packets dropped as the class buffer was full
+    uint32_t maxQueueLength; //!< the longest observed class buffer
+    uint32_t cacheHits; //!< requests served from the cache
+    uint32_t cacheMisses; //!< keyed requests not in the cache
+    EchoSketch sojourn; //!< queueing + service times (s)
+  };
+
   uint16_t m_port; //!< Port on which we listen for incoming packets.
   Ptr<Socket> m_socket; //!< IPv4 Socket
   Ptr<Socket> m_socket6; //!< IPv6 Socket
   Address m_local; //!< local multicast address
   
-  std::queue < ServerQueueEntry > m_serverBuffer; //!< server packet buffer (a FIFO queue)
-  ServerQueueEntry m_serverQueueEntry; //!< queue entry 
+  std::vector<std::queue < ServerQueueEntry > > m_serverBuffer; //!< server packet buffers (a FIFO queue per traffic class)
+  ServerPeerTable m_peers; //!< interned addresses of the clients
+  TracedValue<uint32_t> m_queuedPackets; //!< number of packets in all the class buffers
+  TracedValue<uint32_t> m_queuedBytes; //!< number of bytes in all the class buffers
+  TracedValue<uint32_t> m_inServicePackets; //!< number of requests being served by all the channels
+  EchoTimeAverage m_queueLengthAverage; //!< time average of m_queuedPackets
+  EchoTimeAverage m_queueBytesAverage; //!< time average of m_queuedBytes
+  EchoTimeAverage m_inServiceAverage; //!< time average of m_inServicePackets
+  EchoTimeAverage m_busyAverage; //!< time average of m_busyChannels
+  Time m_startTime; //!< time the application started
+  Time m_sampleInterval; //!< interval of the queue samples (0 disables the sampling)
+  uint32_t m_maxSamples; //!< number of queue samples kept before they are decimated
+  Time m_samplePeriod; //!< current interval of the queue samples, doubled by every decimation
+  std::vector<QueueSample> m_queueSamples; //!< the queue samples
+  Time m_sampleStart; //!< time of the first queue sample
+  EventId m_sampleEvent; //!< Event to take the next queue sample
+
+  uint32_t m_numClasses; //!< number of traffic classes
+  SchedulingMode m_scheduling; //!< how the class buffers are served
+  std::string m_classWeightsString; //!< colon separated weights of the classes
+  std::vector<uint32_t> m_classWeights; //!< weights of the classes (weighted fair mode)
+  std::vector<uint32_t> m_classCredits; //!< remaining round robin credits of the classes
+  uint32_t m_nextClass; //!< class the round robin resumes from
+  uint32_t m_maxQueueSize; //!< per-class buffer limit in packets (0 means unlimited)
+  std::vector<ClassStats> m_classStats; //!< per-class statistics
   
   Ptr<UniformRandomVariable> m_rng; //!< Rng stream.
   double m_Mue; //!< the Mue of the server
   double m_Lambda; //!< the Lambda of the server
   double m_serviceRate; //!< service rate of the server
+  DataRate m_serviceDataRate; //!< service rate of a channel
+  ServiceDistribution m_serviceDistribution; //!< distribution of the service times
+  uint32_t m_lambdaReceived; //!< m_received at the last lambda update
+  uint32_t m_lambdaArrivals; //!< requests the last lambda was measured over
+  Time m_lambdaTime; //!< time of the last lambda update
+  TracedCallback<Time> m_waitTrace; //!< time a request waited before its service started
+  TracedCallback<Time> m_sojournTrace; //!< time from the arrival to the reply of a request
   double m_avgPacketSize; //!< the average packet of received pacekts
+
+  double m_backgroundRate; //!< arrival rate of the fluid background load (requests/s)
+  uint32_t m_backgroundPacketSize; //!< request size of the fluid background load (bytes)
+  Time m_fluidStep; //!< maximum integration step of the fluid queue
+  TracedValue<double> m_fluidBacklog; //!< background requests in the fluid queue
+  Time m_fluidTime; //!< time the fluid queue was integrated up to
+  Time m_fluidStart; //!< time the fluid integration started
+  double m_fluidBacklogIntegral; //!< integral of the fluid backlog over time (requests * s)
+  double m_fluidServed; //!< background requests served by the fluid queue
+  /**
+   * \brief a reply waiting for the pacer
+   */
+  struct ReplyQueueEntry
+  {
+    Ptr<Packet> packet; //!< the reply packet
+    uint32_t peer; //!< index of the client in the peer table
+    Time enqueueTime; //!< time the reply was ready
+  };
+
+  DataRate m_pacingRate; //!< rate of the reply token bucket (0 disables the pacing)
+  uint32_t m_pacingBurst; //!< depth of the reply token bucket in bytes
+  double m_tokens; //!< available tokens in bytes
+  Time m_lastTokenUpdate; //!< last time the token bucket was refilled
+  std::queue<ReplyQueueEntry> m_replyQueue; //!< replies waiting for the pacer
+  TracedValue<uint32_t> m_replyQueueLength; //!< number of replies waiting for the pacer
+  EventId m_pacingEvent; //!< Event to send the next paced reply
+  uint32_t m_pacedReplies; //!< number of replies sent by the pacer
+  double m_pacingDelaySum; //!< sum of the pacing delays (s)
+  double m_pacingDelayMax; //!< maximum pacing delay (s)
+
+  ResponseSizeDistribution m_responseSize; //!< distribution of the reply payload sizes
+  uint32_t m_responseSizeMean; //!< mean reply payload size (bytes)
+  double m_responseSizeShape; //!< shape of the Pareto reply payload sizes
+  uint32_t m_mtu; //!< largest reply packet, CommHeader included (bytes)
+  uint32_t m_responses; //!< replies sized by the distribution
+  uint64_t m_responseBytes; //!< payload bytes of those replies
+  uint32_t m_fragmentsSent; //!< reply packets of those replies
+  uint64_t m_rxBytes; //!< bytes of the received requests
+  uint64_t m_txBytes; //!< bytes of the sent reply packets
+
   uint32_t m_sent; //!< Counter for sent packets
   uint32_t m_received; //!< Counter for received packets
-  EventId m_sendEvent; //!< Event to send the next packet 
-  EventId m_nextPeriodicUpdate; //!< Event to send the server advertisements
+  bool m_printStats; //!< print the statistics when the application stops
+  EventId m_nextPeriodicUpdate; //!< Event to check whether to send the server advertisements
   bool m_initialized; //!< initialized the reply scheduling process 
+  /**
+   * \brief a service channel (server thread)
+   */
+  struct Channel
+  {
+    std::vector<ServerQueueEntry> inService; //!< the batch being served, empty when idle
+    EventId completeEvent; //!< Event to complete the current service
+  };
+  uint32_t m_numChannels; //!< number of parallel service channels
+  std::vector<Channel> m_channels; //!< the service channels
+  TracedValue<uint32_t> m_busyChannels; //!< number of channels serving a batch
+  std::string m_stageWorkString; //!< colon separated shares of the service time of the stages
+  std::string m_stageWorkersString; //!< colon separated workers of the stages
+  std::string m_stageBuffersString; //!< colon separated buffers between the stages
+  std::string m_stageDistributionsString; //!< colon separated service distributions of the stages
+  EchoPipeline m_pipeline; //!< the pipeline, disabled if the channels serve the requests
+
+  uint32_t m_activeChannels; //!< number of channels new batches are started on
+  double m_frequency; //!< service rate multiplier of the channels
+
+  EchoAutoscaler::Mode m_autoscale; //!< what the autoscaler changes
+  EchoAutoscaler::Metric m_autoscaleMetric; //!< the load measure of the autoscaler
+  Time m_autoscaleInterval; //!< period of the autoscaler evaluations
+  double m_scaleUpThreshold; //!< smoothed load above which the capacity is increased
+  double m_scaleDownThreshold; //!< smoothed load below which the capacity is decreased
+  double m_autoscaleSmoothing; //!< weight of the last interval in the smoothed load
+  Time m_scaleUpCooldown; //!< minimum time from a scaling action to a scale up
+  Time m_scaleDownCooldown; //!< minimum time from a scaling action to a scale down
+  Time m_provisioningDelay; //!< time a scale up takes to provide its capacity
+  uint32_t m_minChannels; //!< fewest active channels
+  uint32_t m_maxChannels; //!< most active channels
+  double m_frequencyStep; //!< frequency change of a scaling action
+  double m_minFrequency; //!< lowest frequency
+  double m_maxFrequency; //!< highest frequency
+  TracedValue<double> m_capacity; //!< active channels times the frequency
+  EchoTimeAverage m_activeAverage; //!< time average of m_activeChannels
+  EchoTimeAverage m_capacityAverage; //!< time average of m_capacity
+  double m_lastBusyArea; //!< busy channel integral at the last evaluation
+  double m_lastActiveArea; //!< active channel integral at the last evaluation
+  double m_lastQueueArea; //!< queue length integral at the last evaluation
+  EventId m_autoscaleEvent; //!< Event of the next autoscaler evaluation
+  EventId m_provisionEvent; //!< Event to add the provisioned capacity
+  EchoAutoscaler m_autoscaler; //!< the scaling decisions
+  uint32_t m_batchSize; //!< maximum number of requests served per service completion
+  uint32_t m_batchBytes; //!< maximum number of bytes served per service completion (0 means no limit)
+  double m_batchOverhead; //!< fraction of the service time paid once per batch
+
+  uint32_t m_cacheSize; //!< number of cached keys (0 disables the cache)
+  EchoCache::Policy m_cachePolicy; //!< eviction policy of the cache
+  double m_cacheHitCost; //!< service time of a hit over the one of a miss
+  EchoCache m_cache; //!< the response cache
   
+  std::vector<Address> m_backends; //!< the backends of the aggregator
+  uint32_t m_fanOut; //!< sub-requests per request (0 means all the backends)
+  uint32_t m_quorum; //!< sub-replies completing a request (0 means all)
+  Time m_fanOutTimeout; //!< time after which a request is replied without the quorum (0 disables it)
+  uint32_t m_maxPending; //!< number of slots of the pending table
+  Ptr<Socket> m_backendSocket; //!< socket the sub-requests are sent from
+  EchoFanOut m_pending; //!< the pending table
+  std::vector<EventId> m_fanOutTimeoutEvents; //!< Events to complete the pending requests without the quorum, per slot
+
   Ipv4Address m_localAddress; //!< IP address of the server
   Ipv4Mask m_netMask; //!< Net mask of the server
   Ipv4Address m_ispAddress; //!< Ip address of the Default gateway (ISP's router interface)
+  uint16_t m_ispPort; //!< Port of the ESLR routing process on the Default gateway
+  uint32_t m_authData; //!< authentication data of the server advertisements
+  Time m_statMinInterval; //!< minimum interval between two advertisements
+  Time m_statMaxInterval; //!< maximum interval between two advertisements
+  double m_statChangeThreshold; //!< relative change triggering an early advertisement
+  double m_advertisedMue; //!< the last advertised Mue
+  double m_advertisedLambda; //!< the last advertised Lambda
+  Time m_lastStatTime; //!< time of the last advertisement
+  uint32_t m_statSent; //!< number of advertisements sent
+  uint32_t m_statSuppressed; //!< number of suppressed advertisements
 };
 
 } // namespace ns3
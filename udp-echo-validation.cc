@@ -0,0 +1,410 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Analytical validation of the echo server queue.
+ *
+ * A Poisson client (exponential inter-send times) feeds one server over a
+ * fast link, so the server is an M/M/c queue, or M/D/c with deterministic
+ * service times. For every utilization of the sweep the program measures,
+ * after a warm-up period, the mean number of waiting requests (time
+ * average of the QueueLength trace), the mean waiting time (Wait trace)
+ * and the mean sojourn time (Sojourn trace) with batch means 95%
+ * confidence intervals, and compares them with the formulas below. The
+ * server utilization (time average of the busy channels) is compared
+ * with rho.
+ *
+ *   M/M/1  Lq = rho^2 / (1 - rho), Wq = rho / (mu - lambda), W = 1 / (mu - lambda),
+ *          and the sojourn quantiles -ln (1 - q) / (mu - lambda)
+ *   M/D/1  Lq = rho^2 / (2 (1 - rho)), Wq = rho / (2 mu (1 - rho)), W = Wq + 1 / mu
+ *   M/M/c  Lq = C (c, a) rho / (1 - rho) (Erlang C), Wq = Lq / lambda, W = Wq + 1 / mu
+ *
+ * With --background=f (M/M/1 only) the fraction f of the load is offered
+ * as the fluid background load of the server and only the rest as packets.
+ * The packet level requests are then served with the capacity the fluid
+ * leaves, mue - f lambda, and their sojourn time is still exponential with
+ * rate mue - lambda; only the sojourn checks are done as the waiting time
+ * of the packets alone differs from the FIFO one.
+ *
+ * A check passes if the analytical value is inside the confidence interval
+ * or within the relative tolerance. One CSV line is printed per check and
+ * the exit status is 1 if any check failed, e.g.:
+ *
+ *   ./waf --run "scratch/udp-echo-validation --model=mm1 --rho=0.3,0.5,0.7,0.9"
+ *   ./waf --run "scratch/udp-echo-validation --model=mmc --channels=4"
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/comm-header.h"
+#include "echo-stopping-rule.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("UdpEchoValidation");
+
+/**
+ * \brief a mean and the half width of its 95% confidence interval
+ */
+struct Estimate
+{
+  double mean; //!< the mean
+  double halfWidth; //!< the confidence interval half width
+};
+
+/**
+ * \brief estimate a mean from batch means
+ * \param batches the batch means
+ * \return the mean and its confidence interval
+ */
+static Estimate
+BatchMeans (const std::vector<double> &batches)
+{
+  Estimate e = {0.0, 0.0};
+  uint32_t n = batches.size ();
+  if (n == 0)
+    {
+      return e;
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      e.mean += batches[i];
+    }
+  e.mean /= n;
+  if (n < 2)
+    {
+      return e;
+    }
+  double var = 0.0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      var += (batches[i] - e.mean) * (batches[i] - e.mean);
+    }
+  var /= (n - 1);
+  e.halfWidth = EchoStoppingRule::StudentT975 (n - 1) * std::sqrt (var / n);
+  return e;
+}
+
+/**
+ * \brief collects the server traces after the warm-up period
+ */
+class QueueObserver
+{
+public:
+  QueueObserver (Time warmup, Time end, uint32_t batches)
+    : m_warmup (warmup),
+      m_end (end),
+      m_lastChange (Seconds (0)),
+      m_queueLength (0),
+      m_area (batches, 0.0)
+  {
+  }
+
+  void Wait (Time wait)
+  {
+    if (Simulator::Now () >= m_warmup)
+      {
+        m_wait.push_back (wait.GetSeconds ());
+      }
+  }
+
+  void Sojourn (Time sojourn)
+  {
+    if (Simulator::Now () >= m_warmup)
+      {
+        m_sojourn.push_back (sojourn.GetSeconds ());
+      }
+  }
+
+  void QueueLength (uint32_t /* oldValue */, uint32_t newValue)
+  {
+    Accumulate (Simulator::Now ());
+    m_queueLength = newValue;
+  }
+
+  /**
+   * \brief get the time average of the queue length
+   */
+  Estimate GetQueueLength (void)
+  {
+    Accumulate (m_end);
+    double window = Time ((m_end - m_warmup).GetTimeStep () / (int64_t) m_area.size ()).GetSeconds ();
+    std::vector<double> batches;
+    for (uint32_t b = 0; b < m_area.size (); b++)
+      {
+        batches.push_back (m_area[b] / window);
+      }
+    return BatchMeans (batches);
+  }
+
+  Estimate GetWait (void) const
+  {
+    return BatchMeans (Batch (m_wait));
+  }
+
+  Estimate GetSojourn (void) const
+  {
+    return BatchMeans (Batch (m_sojourn));
+  }
+
+  /**
+   * \brief get a quantile of the sojourn times
+   */
+  double GetSojournQuantile (double q)
+  {
+    if (m_sojourn.empty ())
+      {
+        return 0.0;
+      }
+    std::vector<double> sorted (m_sojourn);
+    uint32_t k = std::min<uint32_t> (q * sorted.size (), sorted.size () - 1);
+    std::nth_element (sorted.begin (), sorted.begin () + k, sorted.end ());
+    return sorted[k];
+  }
+
+private:
+  /**
+   * \brief add the area under the queue length since the last change to
+   * the batch windows it overlaps
+   */
+  void Accumulate (Time now)
+  {
+    // in time steps, so that the window boundaries are exact
+    int64_t from = std::max (m_lastChange, m_warmup).GetTimeStep ();
+    int64_t to = std::min (now, m_end).GetTimeStep ();
+    int64_t start = m_warmup.GetTimeStep ();
+    int64_t window = std::max<int64_t> ((m_end - m_warmup).GetTimeStep () / m_area.size (), 1);
+    while (from < to)
+      {
+        uint32_t b = std::min<int64_t> ((from - start) / window, m_area.size () - 1);
+        int64_t windowEnd = (b == m_area.size () - 1) ? to : std::min (start + (b + 1) * window, to);
+        m_area[b] += Time (windowEnd - from).GetSeconds () * m_queueLength;
+        from = windowEnd;
+      }
+    m_lastChange = now;
+  }
+
+  /**
+   * \brief split samples in to batch means
+   */
+  std::vector<double> Batch (const std::vector<double> &samples) const
+  {
+    std::vector<double> batches;
+    uint32_t size = samples.size () / m_area.size ();
+    for (uint32_t b = 0; size != 0 && b < m_area.size (); b++)
+      {
+        double sum = 0.0;
+        for (uint32_t i = b * size; i < (b + 1) * size; i++)
+          {
+            sum += samples[i];
+          }
+        batches.push_back (sum / size);
+      }
+    return batches;
+  }
+
+  Time m_warmup; //!< end of the warm-up period
+  Time m_end; //!< end of the simulation
+  Time m_lastChange; //!< last queue length change
+  uint32_t m_queueLength; //!< current queue length
+  std::vector<double> m_area; //!< queue length integral per batch window
+  std::vector<double> m_wait; //!< waiting times (s)
+  std::vector<double> m_sojourn; //!< sojourn times (s)
+};
+
+/**
+ * \brief get the Erlang C probability of waiting
+ * \param c the number of channels
+ * \param a the offered load lambda / mue
+ */
+static double
+ErlangC (uint32_t c, double a)
+{
+  double term = 1.0;
+  double sum = 0.0;
+  for (uint32_t k = 0; k < c; k++)
+    {
+      sum += term;
+      term *= a / (k + 1);
+    }
+  double last = term / (1.0 - a / c);
+  return last / (sum + last);
+}
+
+static bool g_failed = false; //!< a check failed
+
+/**
+ * \brief print a check
+ */
+static void
+Check (std::string model, uint32_t channels, double rho, std::string metric,
+       Estimate simulated, double analytical, double tolerance)
+{
+  double relError = analytical != 0.0 ? std::fabs (simulated.mean - analytical) / analytical : 0.0;
+  bool ok = std::fabs (simulated.mean - analytical) <= simulated.halfWidth || relError <= tolerance;
+  g_failed = g_failed || !ok;
+  std::cout << model << "," << channels << "," << rho << "," << metric << ","
+            << simulated.mean << "," << simulated.halfWidth << "," << analytical << ","
+            << relError << "," << (ok ? "ok" : "FAIL") << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string model = "mm1";
+  uint32_t channels = 1;
+  std::string rhoList = "0.3,0.5,0.7,0.9";
+  double mue = 1000.0;
+  uint32_t packetSize = 100;
+  double simTime = 500.0;
+  double warmup = 50.0;
+  uint32_t batches = 20;
+  double tolerance = 0.05;
+  uint32_t run = 1;
+  double background = 0.0;
+
+  CommandLine cmd;
+  cmd.AddValue ("model", "Queue model: mm1, md1 or mmc", model);
+  cmd.AddValue ("channels", "Number of server channels (mmc)", channels);
+  cmd.AddValue ("rho", "Comma separated utilizations", rhoList);
+  cmd.AddValue ("mue", "Service rate of a channel (requests/s)", mue);
+  cmd.AddValue ("packetSize", "Request payload size (bytes)", packetSize);
+  cmd.AddValue ("simTime", "Simulated time per utilization (s)", simTime);
+  cmd.AddValue ("warmup", "Warm-up period discarded from the statistics (s)", warmup);
+  cmd.AddValue ("batches", "Number of batches of the confidence intervals", batches);
+  cmd.AddValue ("tolerance", "Accepted relative error outside the confidence interval", tolerance);
+  cmd.AddValue ("run", "RNG run number", run);
+  cmd.AddValue ("background", "Fraction of the load offered as fluid background load (mm1)", background);
+  cmd.Parse (argc, argv);
+
+  if (model != "mmc")
+    {
+      channels = 1;
+    }
+  if (model != "mm1")
+    {
+      background = 0.0;
+    }
+  background = std::min (std::max (background, 0.0), 0.99);
+  bool deterministic = (model == "md1");
+  RngSeedManager::SetRun (run);
+
+  // mue is the service rate over the request size as the server sees it
+  uint32_t requestSize = packetSize + CommHeader ().GetSerializedSize ();
+  DataRate serviceRate ((uint64_t) (mue * requestSize * 8));
+  mue = serviceRate.GetBitRate () / (requestSize * 8.0);
+
+  std::cout << "model,channels,rho,metric,simulated,ci_half_width,analytical,rel_error,status" << std::endl;
+
+  std::istringstream rhos (rhoList);
+  std::string item;
+  while (std::getline (rhos, item, ','))
+    {
+      double rho = atof (item.c_str ());
+      DataRate clientRate ((uint64_t) ((1 - background) * rho * channels * mue * packetSize * 8));
+      double backgroundRate = background * rho * channels * mue;
+      double lambda = clientRate.GetBitRate () / (packetSize * 8.0) + backgroundRate;
+      rho = lambda / (channels * mue);
+
+      NodeContainer nodes;
+      nodes.Create (2);
+      InternetStackHelper internet;
+      internet.Install (nodes);
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("100Gbps"));
+      p2p.SetChannelAttribute ("Delay", StringValue ("0s"));
+      NetDeviceContainer devices = p2p.Install (nodes);
+      Ipv4AddressHelper address ("10.1.1.0", "255.255.255.0");
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+      uint16_t port = 9;
+      UdpEchoServerHelper echoServer (port);
+      echoServer.SetAttribute ("ServiceRate", DataRateValue (serviceRate));
+      echoServer.SetAttribute ("ServiceDistribution", StringValue (deterministic ? "Deterministic" : "Exponential"));
+      echoServer.SetAttribute ("Channels", UintegerValue (channels));
+      echoServer.SetAttribute ("BackgroundRate", DoubleValue (backgroundRate));
+      echoServer.SetAttribute ("BackgroundPacketSize", UintegerValue (requestSize));
+      ApplicationContainer serverApp = echoServer.Install (nodes.Get (1));
+      serverApp.Start (Seconds (0.0));
+      serverApp.Stop (Seconds (simTime + 1.0));
+
+      UdpEchoClientHelper echoClient (interfaces.GetAddress (1), port);
+      echoClient.SetAttribute ("PacketSize", UintegerValue (packetSize));
+      echoClient.SetAttribute ("DataRate", DataRateValue (clientRate));
+      ApplicationContainer clientApp = echoClient.Install (nodes.Get (0));
+      clientApp.Start (Seconds (0.0));
+      clientApp.Stop (Seconds (simTime + 1.0));
+
+      QueueObserver observer (Seconds (warmup), Seconds (simTime), batches);
+      Ptr<Application> server = serverApp.Get (0);
+      server->TraceConnectWithoutContext ("QueueLength", MakeCallback (&QueueObserver::QueueLength, &observer));
+      server->TraceConnectWithoutContext ("Wait", MakeCallback (&QueueObserver::Wait, &observer));
+      server->TraceConnectWithoutContext ("Sojourn", MakeCallback (&QueueObserver::Sojourn, &observer));
+
+      Simulator::Stop (Seconds (simTime));
+      Simulator::Run ();
+
+      double lq, wq, w;
+      if (model == "md1")
+        {
+          lq = rho * rho / (2 * (1 - rho));
+          wq = rho / (2 * mue * (1 - rho));
+        }
+      else
+        {
+          lq = ErlangC (channels, lambda / mue) * rho / (1 - rho);
+          wq = lq / lambda;
+        }
+      w = wq + 1 / mue;
+
+      if (background == 0.0)
+        {
+          Check (model, channels, rho, "queue_length", observer.GetQueueLength (), lq, tolerance);
+          Check (model, channels, rho, "wait", observer.GetWait (), wq, tolerance);
+          // the time average of the busy channels since the start
+          Estimate utilization = {DynamicCast<UdpEchoServer> (server)->GetUtilization (), 0.0};
+          Check (model, channels, rho, "utilization", utilization, rho, tolerance);
+        }
+      Check (model, channels, rho, "sojourn", observer.GetSojourn (), w, tolerance);
+      if (model == "mm1")
+        {
+          // the M/M/1 sojourn time is exponential with rate mue - lambda
+          double quantiles[] = {0.5, 0.9, 0.99};
+          for (uint32_t i = 0; i < 3; i++)
+            {
+              std::ostringstream metric;
+              metric << "sojourn_p" << quantiles[i] * 100;
+              Estimate e = {observer.GetSojournQuantile (quantiles[i]), 0.0};
+              Check (model, channels, rho, metric.str (), e,
+                     -std::log (1 - quantiles[i]) / (mue - lambda), tolerance);
+            }
+        }
+      Simulator::Destroy ();
+    }
+  return g_failed ? 1 : 0;
+}